@@ -0,0 +1,906 @@
+/*
+* Copyright (c) 2020 Sprint
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/// @file
+/// @brief Diameter benchmark for the freeDiameter wrapper classes.
+/// @details Three modes are supported:
+///   - server: answers every CCR with a CCA and every ULR with a ULA.
+///   - client: sends a CCR/ULR mix to a server at a fixed rate and reports
+///     the throughput, the latency percentiles and the number of
+///     allocations per message.
+///   - local: builds, answers and releases the same message mix in
+///     process without sending anything on the network.
+///
+///   The optional --extractor, --json and --stats switches add the
+///   FDExtractor, the fdJsonGetJSON()/fdJsonAddAvps() and the
+///   EStatistics::DiameterHook processing to every message.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <math.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "epc/epctools.h"
+#include "epc/efd.h"
+#include "epc/efdjson.h"
+#include "epc/estats.h"
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// every C++ allocation made by the process is counted so that the number of
+// allocations per message can be reported, allocations made by freeDiameter
+// itself (malloc) are not included
+static std::atomic<ULongLong> allocCount( 0 );
+
+pVoid operator new( size_t sz )
+{
+   allocCount.fetch_add( 1, std::memory_order_relaxed );
+   pVoid p = malloc( sz ? sz : 1 );
+   if ( !p )
+      throw std::bad_alloc();
+   return p;
+}
+
+pVoid operator new[]( size_t sz )
+{
+   return operator new( sz );
+}
+
+Void operator delete( pVoid p ) noexcept
+{
+   free( p );
+}
+
+Void operator delete[]( pVoid p ) noexcept
+{
+   free( p );
+}
+
+static ULongLong monotonicNanoseconds()
+{
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return (ULongLong)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static Void jsonError( const char *msg )
+{
+   std::cerr << "JSON error - " << msg << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class DccaDictionary
+{
+public:
+   DccaDictionary()
+      : app( "Diameter Credit Control Application" ),
+        ccr( "Credit-Control-Request" ),
+        cca( "Credit-Control-Answer" ),
+        sessionId( "Session-Id" ),
+        destinationRealm( "Destination-Realm" ),
+        authApplicationId( "Auth-Application-Id" ),
+        serviceContextId( "Service-Context-Id" ),
+        ccRequestType( "CC-Request-Type" ),
+        ccRequestNumber( "CC-Request-Number" ),
+        subscriptionId( "Subscription-Id" ),
+        subscriptionIdType( "Subscription-Id-Type" ),
+        subscriptionIdData( "Subscription-Id-Data" ),
+        resultCode( "Result-Code" )
+   {
+   }
+
+   FDDictionaryEntryApplication app;
+   FDDictionaryEntryCommand ccr;
+   FDDictionaryEntryCommand cca;
+   FDDictionaryEntryAVP sessionId;
+   FDDictionaryEntryAVP destinationRealm;
+   FDDictionaryEntryAVP authApplicationId;
+   FDDictionaryEntryAVP serviceContextId;
+   FDDictionaryEntryAVP ccRequestType;
+   FDDictionaryEntryAVP ccRequestNumber;
+   FDDictionaryEntryAVP subscriptionId;
+   FDDictionaryEntryAVP subscriptionIdType;
+   FDDictionaryEntryAVP subscriptionIdData;
+   FDDictionaryEntryAVP resultCode;
+};
+
+class S6aDictionary
+{
+public:
+   S6aDictionary()
+      : app( "3GPP S6a/S6d" ),
+        ulr( "Update-Location-Request" ),
+        ula( "Update-Location-Answer" ),
+        userName( "User-Name" ),
+        authSessionState( "Auth-Session-State" ),
+        ratType( "RAT-Type", true ),
+        ulrFlags( "ULR-Flags", true ),
+        ulaFlags( "ULA-Flags", true ),
+        visitedPlmnId( "Visited-PLMN-Id", true )
+   {
+   }
+
+   FDDictionaryEntryApplication app;
+   FDDictionaryEntryCommand ulr;
+   FDDictionaryEntryCommand ula;
+   FDDictionaryEntryAVP userName;
+   FDDictionaryEntryAVP authSessionState;
+   FDDictionaryEntryAVP ratType;
+   FDDictionaryEntryAVP ulrFlags;
+   FDDictionaryEntryAVP ulaFlags;
+   FDDictionaryEntryAVP visitedPlmnId;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class SubscriptionIdExtractor : public FDExtractor
+{
+public:
+   SubscriptionIdExtractor( FDExtractor &parent, DccaDictionary &dict )
+      : FDExtractor( parent, dict.subscriptionId ),
+        subscription_id_type( *this, dict.subscriptionIdType ),
+        subscription_id_data( *this, dict.subscriptionIdData )
+   {
+      add( subscription_id_type );
+      add( subscription_id_data );
+   }
+
+   FDExtractorAvp subscription_id_type;
+   FDExtractorAvp subscription_id_data;
+};
+
+class CcrExtractor : public FDExtractor
+{
+public:
+   CcrExtractor( DccaDictionary &dict )
+      : session_id( *this, dict.sessionId ),
+        cc_request_type( *this, dict.ccRequestType ),
+        cc_request_number( *this, dict.ccRequestNumber ),
+        service_context_id( *this, dict.serviceContextId ),
+        subscription_id( *this, dict )
+   {
+      add( session_id );
+      add( cc_request_type );
+      add( cc_request_number );
+      add( service_context_id );
+      add( subscription_id );
+   }
+
+   FDExtractorAvp session_id;
+   FDExtractorAvp cc_request_type;
+   FDExtractorAvp cc_request_number;
+   FDExtractorAvp service_context_id;
+   SubscriptionIdExtractor subscription_id;
+};
+
+class UlrExtractor : public FDExtractor
+{
+public:
+   UlrExtractor( DccaDictionary &dcca, S6aDictionary &s6a )
+      : session_id( *this, dcca.sessionId ),
+        user_name( *this, s6a.userName ),
+        rat_type( *this, s6a.ratType ),
+        ulr_flags( *this, s6a.ulrFlags ),
+        visited_plmn_id( *this, s6a.visitedPlmnId )
+   {
+      add( session_id );
+      add( user_name );
+      add( rat_type );
+      add( ulr_flags );
+      add( visited_plmn_id );
+   }
+
+   FDExtractorAvp session_id;
+   FDExtractorAvp user_name;
+   FDExtractorAvp rat_type;
+   FDExtractorAvp ulr_flags;
+   FDExtractorAvp visited_plmn_id;
+};
+
+class AnswerExtractor : public FDExtractor
+{
+public:
+   AnswerExtractor( DccaDictionary &dict )
+      : session_id( *this, dict.sessionId ),
+        result_code( *this, dict.resultCode )
+   {
+      add( session_id );
+      add( result_code );
+   }
+
+   FDExtractorAvp session_id;
+   FDExtractorAvp result_code;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class Bench
+{
+public:
+   Bench()
+      : m_dcca( NULL ),
+        m_s6a( NULL ),
+        m_extractor( False ),
+        m_json( False ),
+        m_stats( False ),
+        m_ulrPercent( 0 ),
+        m_sent( 0 ),
+        m_completed( 0 ),
+        m_errors( 0 ),
+        m_rejected( 0 ),
+        m_outstanding( 0 )
+   {
+      memset( &m_statsPeer, 0, sizeof(m_statsPeer) );
+      m_statsPeer.info.pi_diamid = (DiamId_t)"bench.peer";
+      m_statsPeer.info.pi_diamidlen = strlen( m_statsPeer.info.pi_diamid );
+   }
+
+   ~Bench()
+   {
+      if ( m_s6a )
+         delete m_s6a;
+      if ( m_dcca )
+         delete m_dcca;
+   }
+
+   Void init( const EGetOpt &opt );
+
+   DccaDictionary &dcca() { return *m_dcca; }
+   S6aDictionary &s6a() { return *m_s6a; }
+   Bool hasS6a() { return m_s6a != NULL; }
+
+   Bool isUlr( ULongLong seq ) { return m_s6a && (Int)(seq % 100) < m_ulrPercent; }
+
+   FDMessageRequest *buildRequest( ULongLong seq, FDMessageRequest *req );
+   Void buildAnswer( FDMessageRequest *req, FDMessageAnswer &ans );
+   Void inspectRequest( FDMessageRequest *req );
+   Bool inspectAnswer( FDMessageAnswer &ans );
+   Void processStats( enum fd_hook_type type, FDMessage &msg );
+
+   Void reset( size_t capacity );
+   Void sent() { m_sent.fetch_add( 1, std::memory_order_relaxed ); m_outstanding.fetch_add( 1, std::memory_order_relaxed ); }
+   Void rejected() { m_rejected.fetch_add( 1, std::memory_order_relaxed ); m_outstanding.fetch_sub( 1, std::memory_order_release ); }
+   Void failed() { m_errors.fetch_add( 1, std::memory_order_relaxed ); m_outstanding.fetch_sub( 1, std::memory_order_release ); }
+   Void completed( ULongLong nsec, Bool success );
+   Long getOutstanding() { return m_outstanding.load( std::memory_order_acquire ); }
+   ULongLong getCompleted() { return m_completed.load( std::memory_order_relaxed ); }
+
+   Void report( cpStr mode, Double seconds, ULongLong allocs );
+
+private:
+   static ULongLong percentile( const std::vector<ULongLong> &sorted, Double pct );
+
+   DccaDictionary *m_dcca;
+   S6aDictionary *m_s6a;
+   Bool m_extractor;
+   Bool m_json;
+   Bool m_stats;
+   Int m_ulrPercent;
+   EString m_destRealm;
+   FDJsonTemplate m_ccrTemplate;
+   FDJsonTemplate m_ulrTemplate;
+   EStatistics::DiameterHook m_statsHook;
+   struct peer_hdr m_statsPeer;
+
+   std::atomic<ULongLong> m_sent;
+   std::atomic<ULongLong> m_completed;
+   std::atomic<ULongLong> m_errors;
+   std::atomic<ULongLong> m_rejected;
+   std::atomic<Long> m_outstanding;
+   std::vector<ULongLong> m_samples;
+};
+
+static const char *ccrJson =
+   "{\"Service-Context-Id\":\"32251@3gpp.org\","
+   "\"CC-Request-Type\":1,"
+   "\"CC-Request-Number\":0,"
+   "\"Subscription-Id\":[{\"Subscription-Id-Type\":1,\"Subscription-Id-Data\":\"001010123456789\"}]}";
+
+static const char *ulrJson =
+   "{\"User-Name\":\"001010123456789\","
+   "\"Auth-Session-State\":1,"
+   "\"RAT-Type\":1004,"
+   "\"ULR-Flags\":34,"
+   "\"Visited-PLMN-Id\":\"00f110\"}";
+
+Void Bench::init( const EGetOpt &opt )
+{
+   m_extractor = opt.getCmdLine( "-x,--extractor", false );
+   m_json = opt.getCmdLine( "-j,--json", false );
+   m_stats = opt.getCmdLine( "-s,--stats", false );
+   m_ulrPercent = (Int)opt.getCmdLine( "-u,--ulr", 50L );
+   m_destRealm = opt.getCmdLine( "-R,--realm", "localdomain" );
+
+   m_dcca = new DccaDictionary();
+
+   if ( m_ulrPercent > 0 )
+   {
+      try
+      {
+         m_s6a = new S6aDictionary();
+      }
+      catch ( FDException &e )
+      {
+         std::cerr << "S6a dictionary not loaded, only CCR/CCA will be sent - " << e.what() << std::endl;
+         m_s6a = NULL;
+      }
+   }
+
+   if ( m_json )
+   {
+      m_ccrTemplate.compile( ccrJson, jsonError );
+      if ( m_s6a )
+         m_ulrTemplate.compile( ulrJson, jsonError );
+   }
+
+   if ( m_stats )
+   {
+      EStatistics::addInterface( m_dcca->app.getId(), EStatistics::ProtocolType::diameter, "Gy" );
+      if ( m_s6a )
+         EStatistics::addInterface( m_s6a->app.getId(), EStatistics::ProtocolType::diameter, "S6a" );
+   }
+}
+
+FDMessageRequest *Bench::buildRequest( ULongLong seq, FDMessageRequest *req )
+{
+   Char sid[64];
+   snprintf( sid, sizeof(sid), "bench.localdomain;%llu;%llu", (unsigned long long)( seq >> 32 ), (unsigned long long)( seq & 0xffffffffULL ) );
+
+   req->add( m_dcca->sessionId, sid );
+   req->addOrigin();
+   req->add( m_dcca->destinationRealm, m_destRealm );
+
+   if ( isUlr( seq ) )
+   {
+      if ( m_json )
+         fdJsonAddAvps( m_ulrTemplate, ulrJson, req->getMsg(), jsonError );
+      else
+      {
+         req->add( m_s6a->userName, "001010123456789" );
+         req->add( m_s6a->authSessionState, 1 );
+         req->add( m_s6a->ratType, 1004 );
+         req->add( m_s6a->ulrFlags, (uint32_t)34 );
+         req->add( m_s6a->visitedPlmnId, (const uint8_t*)"\x00\xf1\x10", 3 );
+      }
+   }
+   else
+   {
+      req->add( m_dcca->authApplicationId, m_dcca->app.getId() );
+      if ( m_json )
+         fdJsonAddAvps( m_ccrTemplate, ccrJson, req->getMsg(), jsonError );
+      else
+      {
+         req->add( m_dcca->serviceContextId, "32251@3gpp.org" );
+         req->add( m_dcca->ccRequestType, 1 );
+         req->add( m_dcca->ccRequestNumber, (uint32_t)0 );
+         FDAvp subid( m_dcca->subscriptionId );
+         subid.add( m_dcca->subscriptionIdType, (int32_t)1 );
+         subid.add( m_dcca->subscriptionIdData, "001010123456789" );
+         req->add( subid );
+      }
+   }
+
+   return req;
+}
+
+Void Bench::buildAnswer( FDMessageRequest *req, FDMessageAnswer &ans )
+{
+   ans.addOrigin();
+   ans.add( m_dcca->resultCode, (uint32_t)2001 );
+
+   if ( req->getCommand() == &m_dcca->ccr )
+   {
+      int32_t type = 1;
+      uint32_t number = 0;
+      req->tryGet( m_dcca->ccRequestType, type );
+      req->tryGet( m_dcca->ccRequestNumber, number );
+      ans.add( m_dcca->authApplicationId, m_dcca->app.getId() );
+      ans.add( m_dcca->ccRequestType, type );
+      ans.add( m_dcca->ccRequestNumber, number );
+   }
+   else
+   {
+      ans.add( m_s6a->authSessionState, 1 );
+      ans.add( m_s6a->ulaFlags, (uint32_t)1 );
+   }
+}
+
+Void Bench::inspectRequest( FDMessageRequest *req )
+{
+   if ( m_extractor )
+   {
+      // the extractors are retained per thread and reset for each message
+      static thread_local CcrExtractor *ccr = NULL;
+      static thread_local UlrExtractor *ulr = NULL;
+
+      FDExtractor *ex;
+      if ( req->getCommand() == &m_dcca->ccr )
+      {
+         if ( !ccr )
+            ccr = new CcrExtractor( *m_dcca );
+         ex = ccr;
+      }
+      else
+      {
+         if ( !ulr )
+            ulr = new UlrExtractor( *m_dcca, *m_s6a );
+         ex = ulr;
+      }
+
+      ex->reset();
+      ex->setReference( *req );
+      ex->resolveAll();
+   }
+
+   if ( m_json )
+   {
+      std::string json;
+      req->getJson( json );
+   }
+}
+
+Bool Bench::inspectAnswer( FDMessageAnswer &ans )
+{
+   uint32_t rc = 0;
+
+   if ( m_extractor )
+   {
+      static thread_local AnswerExtractor *ex = NULL;
+      if ( !ex )
+         ex = new AnswerExtractor( *m_dcca );
+
+      ex->reset();
+      ex->setReference( ans );
+      ex->resolveAll();
+      ex->result_code.get( rc );
+   }
+   else
+   {
+      ans.tryGet( m_dcca->resultCode, rc );
+   }
+
+   if ( m_json )
+   {
+      std::string json;
+      ans.getJson( json );
+   }
+
+   return rc == 2001;
+}
+
+Void Bench::processStats( enum fd_hook_type type, FDMessage &msg )
+{
+   if ( m_stats )
+      m_statsHook.process( type, msg.getMsg(), &m_statsPeer, NULL, NULL );
+}
+
+Void Bench::reset( size_t capacity )
+{
+   m_samples.assign( capacity, 0 );
+   m_sent = 0;
+   m_completed = 0;
+   m_errors = 0;
+   m_rejected = 0;
+   m_outstanding = 0;
+}
+
+Void Bench::completed( ULongLong nsec, Bool success )
+{
+   ULongLong idx = m_completed.fetch_add( 1, std::memory_order_relaxed );
+   if ( idx < m_samples.size() )
+      m_samples[idx] = nsec;
+   if ( !success )
+      m_errors.fetch_add( 1, std::memory_order_relaxed );
+   m_outstanding.fetch_sub( 1, std::memory_order_release );
+}
+
+ULongLong Bench::percentile( const std::vector<ULongLong> &sorted, Double pct )
+{
+   if ( sorted.empty() )
+      return 0;
+
+   size_t idx = (size_t)ceil( pct / 100.0 * sorted.size() );
+   if ( idx > sorted.size() )
+      idx = sorted.size();
+   return sorted[idx ? idx - 1 : 0];
+}
+
+Void Bench::report( cpStr mode, Double seconds, ULongLong allocs )
+{
+   ULongLong sent = m_sent.load();
+   ULongLong completed = m_completed.load();
+
+   std::vector<ULongLong> sorted( m_samples.begin(), m_samples.begin() + std::min( (size_t)completed, m_samples.size() ) );
+   std::sort( sorted.begin(), sorted.end() );
+
+   printf( "mode          %s%s%s%s\n", mode,
+      m_extractor ? " +extractor" : "", m_json ? " +json" : "", m_stats ? " +stats" : "" );
+   printf( "sent          %llu\n", (unsigned long long)sent );
+   printf( "completed     %llu\n", (unsigned long long)completed );
+   printf( "errors        %llu\n", (unsigned long long)m_errors.load() );
+   printf( "rejected      %llu\n", (unsigned long long)m_rejected.load() );
+   printf( "elapsed       %.3f sec\n", seconds );
+   printf( "throughput    %.0f msg/sec\n", seconds > 0.0 ? completed / seconds : 0.0 );
+   printf( "latency p50   %.1f usec\n", percentile( sorted, 50.0 ) / 1000.0 );
+   printf( "latency p99   %.1f usec\n", percentile( sorted, 99.0 ) / 1000.0 );
+   printf( "latency p99.9 %.1f usec\n", percentile( sorted, 99.9 ) / 1000.0 );
+   printf( "latency max   %.1f usec\n", sorted.empty() ? 0.0 : sorted.back() / 1000.0 );
+   printf( "allocations   %.2f per message\n", sent ? (Double)allocs / sent : 0.0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+class BenchRequest : public FDMessageRequest
+{
+public:
+   BenchRequest( Bench &bench, FDDictionaryEntryCommand *cde, ULongLong scheduled )
+      : FDMessageRequest( cde ),
+        m_bench( bench ),
+        m_scheduled( scheduled )
+   {
+   }
+
+   Void processAnswer( FDMessageAnswer &ans )
+   {
+      m_bench.processStats( HOOK_MESSAGE_RECEIVED, ans );
+      Bool success = m_bench.inspectAnswer( ans );
+      // latency is measured from the scheduled send time so that a stalled
+      // sender does not hide the queueing delay
+      m_bench.completed( monotonicNanoseconds() - m_scheduled, success );
+   }
+
+private:
+   Bench &m_bench;
+   ULongLong m_scheduled;
+};
+
+class BenchHandler : public FDCommandRequest
+{
+public:
+   BenchHandler( Bench &bench, FDDictionaryEntryCommand &de )
+      : FDCommandRequest( de ),
+        m_bench( bench )
+   {
+   }
+   virtual ~BenchHandler()
+   {
+   }
+
+   Int process( FDMessageRequest *req )
+   {
+      ULongLong start = monotonicNanoseconds();
+
+      m_bench.sent();
+      m_bench.processStats( HOOK_MESSAGE_RECEIVED, *req );
+      m_bench.inspectRequest( req );
+
+      // the answer destructor releases the request
+      FDMessageAnswer ans( req );
+      m_bench.buildAnswer( req, ans );
+      m_bench.processStats( HOOK_MESSAGE_SENDING, ans );
+      ans.send();
+
+      m_bench.completed( monotonicNanoseconds() - start, True );
+      return 0;
+   }
+
+private:
+   Bench &m_bench;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+static Void runServer( const EGetOpt &opt, Bench &bench, FDEngine &engine )
+{
+   ULongLong seconds = opt.getCmdLine( "-d,--duration", 0UL );
+
+   FDApplication dcca( &bench.dcca().app );
+   BenchHandler ccr( bench, bench.dcca().ccr );
+   dcca.registerHandler( ccr );
+   engine.advertiseSupport( bench.dcca().app, 1, 0 );
+
+   FDApplication *s6a = NULL;
+   BenchHandler *ulr = NULL;
+   if ( bench.hasS6a() )
+   {
+      s6a = new FDApplication( &bench.s6a().app );
+      ulr = new BenchHandler( bench, bench.s6a().ulr );
+      s6a->registerHandler( *ulr );
+      engine.advertiseSupport( bench.s6a().app, 1, 0 );
+   }
+
+   engine.start();
+
+   // report once a second until interrupted or the duration expires
+   sigset_t sigset;
+   sigemptyset( &sigset );
+   sigaddset( &sigset, SIGINT );
+   sigaddset( &sigset, SIGTERM );
+   struct timespec ts = { 1, 0 };
+
+   bench.reset( 1 << 20 );
+   ULongLong allocs = allocCount.load();
+   ULongLong start = monotonicNanoseconds();
+   ULongLong last = 0;
+
+   for ( ULongLong elapsed = 0; seconds == 0 || elapsed < seconds; elapsed++ )
+   {
+      if ( sigtimedwait( &sigset, NULL, &ts ) > 0 )
+         break;
+      ULongLong cnt = bench.getCompleted();
+      printf( "%llu msg/sec\n", (unsigned long long)( cnt - last ) );
+      fflush( stdout );
+      last = cnt;
+   }
+
+   Double elapsed = ( monotonicNanoseconds() - start ) / 1e9;
+   bench.report( "server", elapsed, allocCount.load() - allocs );
+
+   engine.uninit();
+
+   if ( ulr )
+      delete ulr;
+   if ( s6a )
+      delete s6a;
+}
+
+static Void runClient( const EGetOpt &opt, Bench &bench, FDEngine &engine )
+{
+   ULongLong rate = opt.getCmdLine( "-r,--rate", 1000UL );
+   ULongLong seconds = opt.getCmdLine( "-d,--duration", 10UL );
+   cpStr peerid = opt.getCmdLine( "-p,--peer", "server.localdomain" );
+   ULongLong wait = opt.getCmdLine( "-w,--wait", 10UL );
+
+   engine.advertiseSupport( bench.dcca().app, 1, 0 );
+   if ( bench.hasS6a() )
+      engine.advertiseSupport( bench.s6a().app, 1, 0 );
+   engine.start();
+
+   FDPeer peer( peerid );
+   for ( ULongLong i = 0; !peer.isOpen(); i++ )
+   {
+      if ( i >= wait * 10 )
+      {
+         std::cerr << "peer " << peerid << " did not open" << std::endl;
+         engine.uninit();
+         return;
+      }
+      EThreadBasic::sleep( 100 );
+   }
+
+   ULongLong total = rate * seconds;
+   ULongLong interval = 1000000000ULL / ( rate ? rate : 1 );
+
+   bench.reset( total );
+   ULongLong allocs = allocCount.load();
+   ULongLong start = monotonicNanoseconds();
+   ULongLong next = start;
+
+   for ( ULongLong seq = 0; seq < total; seq++, next += interval )
+   {
+      struct timespec ts = { (time_t)( next / 1000000000ULL ), (long)( next % 1000000000ULL ) };
+      while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL ) == EINTR )
+         ;
+
+      FDDictionaryEntryCommand *cmd = bench.isUlr( seq ) ? &bench.s6a().ulr : &bench.dcca().ccr;
+      BenchRequest *req = new BenchRequest( bench, cmd, next );
+
+      // requests that are never sent are counted without a latency sample
+      bench.sent();
+      try
+      {
+         bench.buildRequest( seq, req );
+         bench.processStats( HOOK_MESSAGE_SENDING, *req );
+         req->send();
+      }
+      catch ( FDThrottleException &e )
+      {
+         bench.rejected();
+         delete req;
+      }
+      catch ( FDException &e )
+      {
+         std::cerr << e.what() << std::endl;
+         bench.failed();
+         delete req;
+      }
+   }
+
+   // allow the outstanding answers to arrive
+   for ( Int i = 0; i < 50 && bench.getOutstanding() > 0; i++ )
+      EThreadBasic::sleep( 100 );
+
+   Double elapsed = ( monotonicNanoseconds() - start ) / 1e9;
+   bench.report( "client", elapsed, allocCount.load() - allocs );
+
+   engine.uninit();
+}
+
+static Void runLocal( const EGetOpt &opt, Bench &bench )
+{
+   ULongLong count = opt.getCmdLine( "-n,--count", 100000UL );
+
+   bench.reset( count );
+   ULongLong allocs = allocCount.load();
+   ULongLong start = monotonicNanoseconds();
+
+   for ( ULongLong seq = 0; seq < count; seq++ )
+   {
+      ULongLong begin = monotonicNanoseconds();
+
+      FDDictionaryEntryCommand *cmd = bench.isUlr( seq ) ? &bench.s6a().ulr : &bench.dcca().ccr;
+      FDMessageRequest *req = new FDMessageRequest( cmd );
+      bench.sent();
+      bench.buildRequest( seq, req );
+      bench.processStats( HOOK_MESSAGE_SENDING, *req );
+
+      // echo the request the same way the server does
+      bench.processStats( HOOK_MESSAGE_RECEIVED, *req );
+      bench.inspectRequest( req );
+
+      Bool success;
+      {
+         // the answer destructor releases the request
+         FDMessageAnswer ans( req );
+         bench.buildAnswer( req, ans );
+         bench.processStats( HOOK_MESSAGE_SENDING, ans );
+         bench.processStats( HOOK_MESSAGE_RECEIVED, ans );
+         success = bench.inspectAnswer( ans );
+      }
+
+      bench.completed( monotonicNanoseconds() - begin, success );
+   }
+
+   Double elapsed = ( monotonicNanoseconds() - start ) / 1e9;
+   bench.report( "local", elapsed, allocCount.load() - allocs );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+Void usage()
+{
+   std::cout <<
+      "USAGE:  epcbench [--help] [--file optionfile] --mode server|client|local --fdcfg fdconfigfile\n"
+      "                 [--rate msgpersec] [--duration seconds] [--count messages] [--ulr percent]\n"
+      "                 [--peer diameterid] [--realm destrealm] [--wait seconds]\n"
+      "                 [--extractor] [--json] [--stats]\n";
+}
+
+int main( int argc, char *argv[] )
+{
+   EGetOpt::Option options[] = {
+       {"-h", "--help", EGetOpt::no_argument, EGetOpt::dtNone},
+       {"-f", "--file", EGetOpt::required_argument, EGetOpt::dtString},
+       {"-m", "--mode", EGetOpt::required_argument, EGetOpt::dtString},
+       {"-c", "--fdcfg", EGetOpt::required_argument, EGetOpt::dtString},
+       {"-r", "--rate", EGetOpt::required_argument, EGetOpt::dtUInt64},
+       {"-d", "--duration", EGetOpt::required_argument, EGetOpt::dtUInt64},
+       {"-n", "--count", EGetOpt::required_argument, EGetOpt::dtUInt64},
+       {"-u", "--ulr", EGetOpt::required_argument, EGetOpt::dtInt32},
+       {"-p", "--peer", EGetOpt::required_argument, EGetOpt::dtString},
+       {"-R", "--realm", EGetOpt::required_argument, EGetOpt::dtString},
+       {"-w", "--wait", EGetOpt::required_argument, EGetOpt::dtUInt64},
+       {"-x", "--extractor", EGetOpt::no_argument, EGetOpt::dtBool},
+       {"-j", "--json", EGetOpt::no_argument, EGetOpt::dtBool},
+       {"-s", "--stats", EGetOpt::no_argument, EGetOpt::dtBool},
+       {"", "", EGetOpt::no_argument, EGetOpt::dtNone},
+   };
+
+   EGetOpt opt;
+   EString optFile;
+
+   try
+   {
+      opt.loadCmdLine( argc, argv, options );
+      if ( opt.getCmdLine( "-h,--help", false ) )
+      {
+         usage();
+         exit( 0 );
+      }
+
+      optFile.format( "%s.json", argv[0] );
+      opt.loadFile( optFile.c_str() );
+
+      optFile = opt.getCmdLine( "-f,--file", "" );
+      if ( !optFile.empty() )
+         opt.loadFile( optFile.c_str() );
+   }
+   catch ( const EGetOptError_FileParsing &e )
+   {
+      std::cerr << e.Name() << " - " << e.what() << '\n';
+      exit( 0 );
+   }
+   catch ( const std::exception &e )
+   {
+      std::cerr << e.what() << '\n';
+      exit( 0 );
+   }
+
+   EString mode = opt.getCmdLine( "-m,--mode", "local" );
+   EString fdcfg = opt.getCmdLine( "-c,--fdcfg", "" );
+
+   if ( mode != "server" && mode != "client" && mode != "local" )
+   {
+      usage();
+      exit( 0 );
+   }
+
+   try
+   {
+      {
+         sigset_t sigset;
+
+         /* mask SIGALRM in all threads by default */
+         sigemptyset( &sigset );
+         sigaddset( &sigset, SIGRTMIN + 2 );
+         sigaddset( &sigset, SIGRTMIN + 3 );
+         sigaddset( &sigset, SIGUSR1 );
+         sigaddset( &sigset, SIGINT );
+         sigaddset( &sigset, SIGTERM );
+         sigprocmask( SIG_BLOCK, &sigset, NULL );
+      }
+
+      EpcTools::Initialize( opt );
+
+      {
+         // freeDiameter is a process wide singleton, so the loopback test
+         // is run as two processes, a server and a client
+         FDEngine engine( fdcfg );
+         engine.init();
+
+         Bench bench;
+         bench.init( opt );
+
+         if ( mode == "server" )
+            runServer( opt, bench, engine );
+         else if ( mode == "client" )
+            runClient( opt, bench, engine );
+         else
+         {
+            runLocal( opt, bench );
+            engine.uninit();
+         }
+      }
+
+      EpcTools::UnInitialize();
+   }
+   catch ( EError &e )
+   {
+      std::cerr << (cpStr)e << std::endl;
+   }
+   catch ( FDException &e )
+   {
+      std::cerr << e.what() << std::endl;
+   }
+
+   return 0;
+}
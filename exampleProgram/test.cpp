@@ -993,21 +993,7 @@ public:
 
    ~testmessage() {}
 
-   virtual Void getLength(ULong &length)
-   {
-      EQueueMessage::getLength(length);
-      elementLength(m_data, length);
-   }
-   virtual Void serialize(pVoid pBuffer, ULong &nOffset)
-   {
-      EQueueMessage::serialize(pBuffer, nOffset);
-      pack(m_data, pBuffer, nOffset);
-   }
-   virtual Void unserialize(pVoid pBuffer, ULong &nOffset)
-   {
-      EQueueMessage::unserialize(pBuffer, nOffset);
-      unpack(m_data, pBuffer, nOffset);
-   }
+   EPC_MESSAGE_FIELDS(EQueueMessage, m_data)
 
    Char m_data[128];
 };
@@ -21,12 +21,16 @@
 /// @file
 /// @brief Defines classes related to the DNS cache.
 
+#include <atomic>
 #include <list>
 #include <map>
+#include <unordered_map>
+#include <vector>
 #include <ares.h>
 
 #include "dnsquery.h"
 #include "eatomic.h"
+#include "ehistogram.h"
 #include "esynch.h"
 #include "etevent.h"
 
@@ -110,17 +114,22 @@ namespace DNS
       ares_channel getChannel() { return m_channel; }
 
       Void beginQuery( QueryPtr &q );
-      Void endQuery();
+      Void endQuery( QueryPtr &q, int status );
 
    private:
+      // the number of outstanding query counters, a power of 2
+      static const Int InFlightSlots = 1024;
+
       QueryProcessor();
       Void init();
+      std::atomic<Int> &getInFlightSlot( QueryPtr &q );
 
       Cache &m_cache;
       QueryProcessorThread m_qpt;
       ares_channel m_channel;
       std::map<const char *,NamedServer> m_servers;
       EMutexPrivate m_mutex;
+      std::atomic<Int> m_inflight[InFlightSlots];
    };
 
    /////////////////////////////////////////////////////////////////////////////
@@ -180,6 +189,119 @@ namespace DNS
    /////////////////////////////////////////////////////////////////////////////
    /////////////////////////////////////////////////////////////////////////////
 
+   /// @brief Lock-free counters that describe the behavior of a DNS cache.
+   /// @details One CacheMetrics object is maintained for each named server ID
+   ///   (DNS::Cache instance).  The resolver latency histogram records the
+   ///   time, in microseconds, from when a query is submitted to c-ares
+   ///   until the response has been received.
+   class CacheMetrics
+   {
+   public:
+      /// @brief Default constructor.
+      CacheMetrics() { reset(); }
+
+      /// @brief Resets all of the counters to zero.
+      /// @details The in-flight and refresh backlog gauges are not reset.
+      Void reset()
+      {
+         m_queries = 0;
+         m_hits = 0;
+         m_misses = 0;
+         m_duplicatemisses = 0;
+         m_refreshes = 0;
+         m_completed = 0;
+         m_errors = 0;
+         m_timeouts = 0;
+         m_latency.reset();
+      }
+
+      /// @brief Retrieves the number of queries requested from the cache.
+      /// @return the number of queries requested from the cache.
+      ULongLong getQueries() const { return m_queries; }
+      /// @brief Retrieves the number of queries satisfied from the cache.
+      /// @return the number of queries satisfied from the cache.
+      ULongLong getHits() const { return m_hits; }
+      /// @brief Retrieves the number of queries that were not found in the cache or had expired.
+      /// @return the number of queries that were not found in the cache or had expired.
+      ULongLong getMisses() const { return m_misses; }
+      /// @brief Retrieves the number of cache misses that were submitted while an
+      ///   identical query was already in progress.
+      /// @return the number of duplicate cache misses.
+      ULongLong getDuplicateMisses() const { return m_duplicatemisses; }
+      /// @brief Retrieves the number of queries that bypassed the cache (refreshes).
+      /// @return the number of queries that bypassed the cache.
+      ULongLong getRefreshes() const { return m_refreshes; }
+      /// @brief Retrieves the number of queries completed by the resolver.
+      /// @return the number of queries completed by the resolver.
+      ULongLong getCompleted() const { return m_completed; }
+      /// @brief Retrieves the number of resolver queries that failed.
+      /// @return the number of resolver queries that failed.
+      ULongLong getErrors() const { return m_errors; }
+      /// @brief Retrieves the number of resolver queries that failed due to a timeout.
+      /// @return the number of resolver queries that failed due to a timeout.
+      ULongLong getTimeouts() const { return m_timeouts; }
+      /// @brief Retrieves the number of queries currently outstanding with the resolver.
+      /// @return the number of queries currently outstanding with the resolver.
+      Long getInFlight() const { return m_inflight; }
+      /// @brief Retrieves the number of refresh queries waiting to be submitted.
+      /// @return the number of refresh queries waiting to be submitted.
+      Long getRefreshBacklog() const { return m_refreshbacklog; }
+      /// @brief Retrieves the percentage of queries that were satisfied from the cache.
+      /// @return the percentage of queries that were satisfied from the cache.
+      Double getHitRatio() const
+      {
+         ULongLong q = m_hits + m_misses;
+         return q ? (Double)m_hits * 100.0 / (Double)q : 0.0;
+      }
+      /// @brief Retrieves the resolver latency histogram (microseconds).
+      /// @return a reference to the resolver latency histogram.
+      const EHistogram &getResolverLatency() const { return m_latency; }
+
+      /// @brief Serializes the metrics as a JSON object.
+      /// @param json updated with the JSON representation of the metrics.
+      /// @param nsid the named server ID to include in the JSON object.
+      /// @return a reference to the json parameter.
+      EString &toJson(EString &json, namedserverid_t nsid) const;
+
+      /// @cond DOXYGEN_EXCLUDE
+      Void incQueries() { m_queries.fetch_add(1, std::memory_order_relaxed); }
+      Void incHits() { m_hits.fetch_add(1, std::memory_order_relaxed); }
+      Void incMisses() { m_misses.fetch_add(1, std::memory_order_relaxed); }
+      Void incDuplicateMisses() { m_duplicatemisses.fetch_add(1, std::memory_order_relaxed); }
+      Void incRefreshes() { m_refreshes.fetch_add(1, std::memory_order_relaxed); }
+      Void incErrors() { m_errors.fetch_add(1, std::memory_order_relaxed); }
+      Void incTimeouts() { m_timeouts.fetch_add(1, std::memory_order_relaxed); }
+      Void incInFlight() { ++m_inflight; }
+      Void queryCompleted(ULongLong usec)
+      {
+         --m_inflight;
+         m_completed.fetch_add(1, std::memory_order_relaxed);
+         m_latency.record(usec);
+      }
+      Void setRefreshBacklog(Long backlog) { m_refreshbacklog = backlog; }
+      Void decRefreshBacklog() { --m_refreshbacklog; }
+      /// @endcond
+
+   private:
+      CacheMetrics(const CacheMetrics &);
+      CacheMetrics &operator=(const CacheMetrics &);
+
+      std::atomic<ULongLong> m_queries;
+      std::atomic<ULongLong> m_hits;
+      std::atomic<ULongLong> m_misses;
+      std::atomic<ULongLong> m_duplicatemisses;
+      std::atomic<ULongLong> m_refreshes;
+      std::atomic<ULongLong> m_completed;
+      std::atomic<ULongLong> m_errors;
+      std::atomic<ULongLong> m_timeouts;
+      std::atomic<Long> m_inflight{0};
+      std::atomic<Long> m_refreshbacklog{0};
+      EHistogram m_latency;
+   };
+
+   /////////////////////////////////////////////////////////////////////////////
+   /////////////////////////////////////////////////////////////////////////////
+
    /// @brief Defines the functionality associated with a DNS cache
    class Cache
    {
@@ -252,6 +374,32 @@ namespace DNS
       /// @param data a Void pointer that will be passed to the callback function when the query is complete.
       /// @param ignorecache directs the query to optionally ignore any results in the local DNS cache.
       Void query( ns_type rtype, const std::string &domain, CachedDNSQueryCallback cb, const Void *data=NULL, Bool ignorecache=false );
+      /// @brief Performs a DNS query synchronously using a pre-calculated domain hash.
+      /// @details The local DNS cache lookup does not allocate any memory,
+      ///   allowing the domain to be built in a caller supplied buffer.
+      /// @param rtype the named server type of the query.
+      /// @param domain the domain name of the query (does not need to be NULL terminated).
+      /// @param len the length of the domain name.
+      /// @param hash the hash of the domain name calculated by getDomainHash().
+      /// @param cacheHit updated with an indication if the result came from the local DNS cache.
+      /// @param ignorecache directs the query to optionally ignore any results in the local DNS cache.
+      /// @return a QueryPtr with the DNS query results.
+      QueryPtr query( ns_type rtype, const char *domain, size_t len, ULong hash, Bool &cacheHit, Bool ignorecache=false );
+      /// @brief Performs a DNS query asynchronously using a pre-calculated domain hash.
+      /// @param rtype the named server type of the query.
+      /// @param domain the domain name of the query (does not need to be NULL terminated).
+      /// @param len the length of the domain name.
+      /// @param hash the hash of the domain name calculated by getDomainHash().
+      /// @param cb a callback function pointer that will be called when the query is complete.
+      /// @param data a Void pointer that will be passed to the callback function when the query is complete.
+      /// @param ignorecache directs the query to optionally ignore any results in the local DNS cache.
+      Void query( ns_type rtype, const char *domain, size_t len, ULong hash, CachedDNSQueryCallback cb, const Void *data=NULL, Bool ignorecache=false );
+
+      /// @brief Calculates the hash of a domain name for use with the pre-hashed query methods.
+      /// @param domain the domain name.
+      /// @param len the length of the domain name.
+      /// @return the hash value of the domain name.
+      static ULong getDomainHash( const char *domain, size_t len );
 
       /// @brief Executes the DNS queries at startup from the suppoied file.
       /// @param qfn the DNS query file name to load.
@@ -276,14 +424,26 @@ namespace DNS
       /// @return the previous the number of new queries (not saved).
       long resetNewQueryCount() { return atomic_swap(m_newquerycnt, 0); }
 
+      /// @brief Retrieves the metrics associated with this DNS cache.
+      /// @return a reference to the metrics associated with this DNS cache.
+      CacheMetrics &getMetrics() { return m_metrics; }
+      /// @brief Serializes the metrics for all DNS cache instances as a JSON array.
+      /// @details Intended to be returned by an application supplied
+      ///   EManagementHandler.
+      /// @param json updated with the JSON representation of the metrics.
+      /// @return a reference to the json parameter.
+      static EString &getMetricsJson(EString &json);
+
    protected:
       /// @cond DOXYGEN_EXCLUDE
       Void updateCache( QueryPtr q );
       QueryPtr lookupQuery( ns_type rtype, const std::string &domain );
       QueryPtr lookupQuery( QueryCacheKey &qck );
+      QueryPtr lookupQuery( ns_type rtype, const char *domain, size_t len, ULong hash );
 
       Void identifyExpired( std::list<QueryCacheKey> &keys, int percent );
       Void getCacheKeys( std::list<QueryCacheKey> &keys );
+      Void countQuery( Bool cacheHit, Bool ignorecache );
       /// @endcond
 
    private:
@@ -296,9 +456,11 @@ namespace DNS
       QueryProcessor m_qp;
       CacheRefresher m_refresher;
       QueryCache m_cache;
+      std::unordered_map<ULong,std::vector<QueryPtr>> m_hashindex;
       namedserverid_t m_nsid;
       ERWLock m_cacherwlock;
       long m_newquerycnt;
+      CacheMetrics m_metrics;
    };
 }
 
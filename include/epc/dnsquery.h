@@ -29,6 +29,7 @@
 
 #include "estring.h"
 #include "esynch.h"
+#include "etimer.h"
 #include "dnsrecord.h"
 
 namespace DNS
@@ -305,6 +306,8 @@ namespace DNS
 
       const Void *getData() { return m_data; }
       const Void *setData(const Void *data) { return m_data = data; }
+
+      ETimer &getTimer() { return m_timer; }
       /// @endcond
 
    private:
@@ -325,6 +328,8 @@ namespace DNS
 
       Bool m_err;
       EString m_errmsg;
+
+      ETimer m_timer;
    };
 }
 
@@ -86,6 +86,20 @@
 ///         FDMessageRequest internals will delete the associated
 ///         FDMessageRequest object.
 ///
+/// ### RECEIVING AN ANSWER ON AN EVENT THREAD
+///    By default, processAnswer() is called on a freeDiameter routing
+///    thread.  To have the answer processed by an EThreadEvent thread
+///    instead, the thread owns an FDAnswerRouter.
+///
+///    1. Initialize the FDAnswerRouter with the thread and a user
+///         event message ID by calling FDAnswerRouter::init().
+///    2. Add a message map entry for the event message ID that calls
+///         FDAnswerRouter::processAnswers().
+///    3. Send the request using send( router ).  The answer is queued
+///         to the router and processAnswer() is called in the context
+///         of the thread.  Answers that arrive before the thread
+///         processes the event are delivered by the same event.
+///
 /// ## RECEIVING A REQUEST AND SENDING AN ANSWER
 ///
 ///   Unlike sending a request and receiving an answer where the
@@ -144,10 +158,12 @@
 #include <arpa/inet.h>
 #include <time.h>
 
+#include <atomic>
 #include <stdexcept>
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
 
 #include "freeDiameter/freeDiameter-host.h"
 #include "freeDiameter/libfdcore.h"
@@ -157,6 +173,8 @@
 #include "estring.h"
 #include "etime.h"
 #include "etimer.h"
+#include "etevent.h"
+#include "esynch.h"
 #include "eutil.h"
 
 /// @brief Exception base class used within the freeDiameter wrapper classes.
@@ -191,6 +209,44 @@ private:
    T *mbuf;
 };
 
+/// @brief A size class allocator for the freeDiameter wrapper objects.
+/// @details Released blocks are kept on a per-thread free list for each size
+///   class, so allocating and releasing a block does not take a lock.  When a
+///   thread's free list grows beyond CacheLimit blocks, a batch of blocks is
+///   moved to a shared depot where other threads can reuse them.  This keeps
+///   objects created on one thread and released on another, a request
+///   created by the application and released by the answer, from falling
+///   back to the heap.  Blocks larger than MaxBlockSize are allocated from
+///   the heap.
+class FDObjectPool
+{
+public:
+   /// @brief The size class granularity in bytes.
+   static const size_t Granularity = 64;
+   /// @brief The largest block that will be pooled.
+   static const size_t MaxBlockSize = 1024;
+   /// @brief The number of blocks that move between a thread and the depot.
+   static const Int BatchSize = 64;
+   /// @brief The maximum number of blocks cached by a thread per size class.
+   static const Int CacheLimit = 2 * BatchSize;
+
+   /// @brief Allocates a block of memory.
+   /// @param sz the size of the block.
+   /// @return the block of memory.
+   /// @throws std::bad_alloc
+   static pVoid allocate( size_t sz );
+   /// @brief Releases a block of memory allocated by allocate().
+   /// @param p the block of memory to release.
+   static Void release( pVoid p );
+};
+
+/// @brief Declares class specific new and delete operators that allocate
+///   the object from FDObjectPool.
+#define DECLARE_FD_POOLED_OBJECT()                                         \
+public:                                                                    \
+   static pVoid operator new( size_t sz ) { return FDObjectPool::allocate( sz ); } \
+   static Void operator delete( pVoid p ) { FDObjectPool::release( p ); }
+
 class FDDictionaryEntryApplication;
 class FDDictionaryEntryVendor;
 
@@ -405,6 +461,8 @@ enum DiameterDataType
 /// @brief A dictionary entry object associated with an AVP.
 class FDDictionaryEntryAVP : public FDDictionaryEntry
 {
+   DECLARE_FD_POOLED_OBJECT()
+
 public:
    /// @brief Class constructor.
    /// @param name the name of the AVP.
@@ -507,6 +565,9 @@ class FDExtractorAvpList;
 class FDAvp
 {
    friend FDMessage;
+   friend FDExtractorAvp;
+
+   DECLARE_FD_POOLED_OBJECT()
 
 public:
    /// @brief Class constructor.
@@ -827,6 +888,7 @@ protected:
 private:
    Void init();
    Void assignValue();
+   Void detach() { m_avp = NULL; m_avphdr = NULL; }
 
    FDDictionaryEntryAVP *m_de;
    FDBuffer<uint8_t> *m_buf;
@@ -839,10 +901,14 @@ private:
 
 class FDMessageRequest;
 class FDMessageAnswer;
+class FDAnswerRouter;
+class FDThrottle;
 
 /// @brief Represents a freeDiameter message.
 class FDMessage
 {
+   DECLARE_FD_POOLED_OBJECT()
+
 public:
    FDDictionaryEntryCommand *getCommand() { return m_de; }
 
@@ -850,7 +916,7 @@ public:
    /// @param avp the AVP to add.
    /// @return a reference to this message object.
    /// @throws FDException
-   FDMessage &add( FDAvp &avp ) { avp.addTo( m_msg ); return *this; }
+   FDMessage &add( FDAvp &avp ) { avp.addTo( m_msg ); m_indexed = false; return *this; }
    /// @brief Adds an int32_t value to this message.
    /// @param de the dictionary entry of the AVP to add.
    /// @param v the value to add.
@@ -1004,11 +1070,87 @@ public:
    /// @throws FDException
    Bool get( FDDictionaryEntryAVP &de, ETime &v ) { FDAvp avp = findAVP( de ); return avp.get( v ); }
 
+   /// @brief Retrieves the int32_t AVP value associated with specified dictionary entry if it is present.
+   /// @param de the dictionary entry of the AVP to retrieve.
+   /// @param v the variable to populate.
+   /// @return True if the AVP is present and the value was retrieved, otherwise False.
+   Bool tryGet( FDDictionaryEntryAVP &de, int32_t &v ) { struct avp *a = lookupAVP( de ); return a ? FDAvp( de, a ).get( v ) : false; }
+   /// @brief Retrieves the int64_t AVP value associated with specified dictionary entry if it is present.
+   /// @param de the dictionary entry of the AVP to retrieve.
+   /// @param v the variable to populate.
+   /// @return True if the AVP is present and the value was retrieved, otherwise False.
+   Bool tryGet( FDDictionaryEntryAVP &de, int64_t &v ) { struct avp *a = lookupAVP( de ); return a ? FDAvp( de, a ).get( v ) : false; }
+   /// @brief Retrieves the uint32_t AVP value associated with specified dictionary entry if it is present.
+   /// @param de the dictionary entry of the AVP to retrieve.
+   /// @param v the variable to populate.
+   /// @return True if the AVP is present and the value was retrieved, otherwise False.
+   Bool tryGet( FDDictionaryEntryAVP &de, uint32_t &v ) { struct avp *a = lookupAVP( de ); return a ? FDAvp( de, a ).get( v ) : false; }
+   /// @brief Retrieves the uint64_t AVP value associated with specified dictionary entry if it is present.
+   /// @param de the dictionary entry of the AVP to retrieve.
+   /// @param v the variable to populate.
+   /// @return True if the AVP is present and the value was retrieved, otherwise False.
+   Bool tryGet( FDDictionaryEntryAVP &de, uint64_t &v ) { struct avp *a = lookupAVP( de ); return a ? FDAvp( de, a ).get( v ) : false; }
+   /// @brief Retrieves the float AVP value associated with specified dictionary entry if it is present.
+   /// @param de the dictionary entry of the AVP to retrieve.
+   /// @param v the variable to populate.
+   /// @return True if the AVP is present and the value was retrieved, otherwise False.
+   Bool tryGet( FDDictionaryEntryAVP &de, float &v ) { struct avp *a = lookupAVP( de ); return a ? FDAvp( de, a ).get( v ) : false; }
+   /// @brief Retrieves the double AVP value associated with specified dictionary entry if it is present.
+   /// @param de the dictionary entry of the AVP to retrieve.
+   /// @param v the variable to populate.
+   /// @return True if the AVP is present and the value was retrieved, otherwise False.
+   Bool tryGet( FDDictionaryEntryAVP &de, double &v ) { struct avp *a = lookupAVP( de ); return a ? FDAvp( de, a ).get( v ) : false; }
+   /// @brief Retrieves the string AVP value associated with specified dictionary entry if it is present.
+   /// @param de the dictionary entry of the AVP to retrieve.
+   /// @param v the variable to populate.
+   /// @return True if the AVP is present and the value was retrieved, otherwise False.
+   Bool tryGet( FDDictionaryEntryAVP &de, std::string &v ) { struct avp *a = lookupAVP( de ); return a ? FDAvp( de, a ).get( v ) : false; }
+   /// @brief Retrieves the octet string AVP value associated with specified dictionary entry if it is present.
+   /// @param de the dictionary entry of the AVP to retrieve.
+   /// @param v the variable to populate.
+   /// @param len the maximum length of the octet string.
+   /// @return True if the AVP is present and the value was retrieved, otherwise False.
+   Bool tryGet( FDDictionaryEntryAVP &de, char *v, size_t &len ) { struct avp *a = lookupAVP( de ); return a ? FDAvp( de, a ).get( v, len ) : false; }
+   /// @brief Retrieves the octet string AVP value associated with specified dictionary entry if it is present.
+   /// @param de the dictionary entry of the AVP to retrieve.
+   /// @param v the variable to populate.
+   /// @param len the maximum length of the octet string.
+   /// @return True if the AVP is present and the value was retrieved, otherwise False.
+   Bool tryGet( FDDictionaryEntryAVP &de, uint8_t *v, size_t &len ) { struct avp *a = lookupAVP( de ); return a ? FDAvp( de, a ).get( v, len ) : false; }
+   /// @brief Retrieves the time AVP value associated with specified dictionary entry if it is present.
+   /// @param de the dictionary entry of the AVP to retrieve.
+   /// @param v the variable to populate.
+   /// @return True if the AVP is present and the value was retrieved, otherwise False.
+   Bool tryGet( FDDictionaryEntryAVP &de, ETime &v ) { struct avp *a = lookupAVP( de ); return a ? FDAvp( de, a ).get( v ) : false; }
+
    /// @brief Retrieves the AVP object specified by the dictionary entry from this message.
    /// @param de the AVP dictionary entry to search for.
    /// @return the FDAvp object.
    /// @throws FDException
    FDAvp findAVP( FDDictionaryEntryAVP &de );
+   /// @brief Indicates if the AVP specified by the dictionary entry is present in this message.
+   /// @param de the AVP dictionary entry to search for.
+   /// @return True if the AVP is present, otherwise False.
+   Bool hasAVP( FDDictionaryEntryAVP &de ) { return lookupAVP( de ) != NULL; }
+   /// @brief Retrieves the number of occurrences of the AVP specified by the dictionary entry in this message.
+   /// @param de the AVP dictionary entry to search for.
+   /// @return the number of occurrences of the AVP.
+   Int countAVP( FDDictionaryEntryAVP &de );
+   /// @brief Retrieves the underlying freeDiameter AVP specified by the dictionary entry from this message.
+   /// @details The first call builds an index of the top level AVP's in the
+   ///   message so that subsequent lookups are a binary search instead of a
+   ///   linear scan of the message.  The add(), addJson() and addOrigin()
+   ///   methods invalidate the index.  AVP's added to the freeDiameter message
+   ///   returned by getMsg(), such as with fd_msg_avp_add() or a compiled
+   ///   FDJsonTemplate, are not seen until invalidateIndex() is called.
+   /// @param de the AVP dictionary entry to search for.
+   /// @param occurrence the zero based occurrence of the AVP to retrieve.
+   /// @return the freeDiameter AVP pointer or NULL if the AVP is not present.
+   struct avp *lookupAVP( FDDictionaryEntryAVP &de, Int occurrence = 0 );
+   /// @brief Discards the AVP index so that it is rebuilt by the next lookup.
+   /// @details Must be called after AVP's are added to or removed from the
+   ///   freeDiameter message returned by getMsg().
+   Void invalidateIndex() { m_indexed = false; }
    /// @brief Retrieves the first AVP object from this message.
    /// @param found indicates if the first entry was found.
    /// @return the FDAvp object.
@@ -1026,6 +1168,8 @@ public:
    Bool isAnswer() { return m_de->isAnswer(); }
 
    /// @brief Retrieves the freeDiameter message pointer.
+   /// @details Call invalidateIndex() after changing the top level AVP's of
+   ///   the message through this pointer.
    /// @return the freeDiameter message pointer.
    struct msg *getMsg() { return m_msg; }
 
@@ -1079,6 +1223,15 @@ protected:
    /// @return reference to this message object.
    /// @throws FDException
    FDMessage &sendRequest( Void (*anscb)(Void*,struct msg**), FDMessageRequest &req );
+   /// @brief Sends a request message that expires if it is not answered.
+   /// @param anscb an answer callback function pointer.
+   /// @param expirecb the function called instead of anscb when the request expires.
+   /// @param timeout the number of milliseconds before the request expires.
+   /// @param req The request message to send.
+   /// @return reference to this message object.
+   /// @throws FDException
+   FDMessage &sendRequest( Void (*anscb)(Void*,struct msg**),
+      Void (*expirecb)(Void*,DiamId_t,size_t,struct msg**), Long timeout, FDMessageRequest &req );
    /// @brief Sends an answer message;
    /// @return reference to this message object.
    /// @throws FDException
@@ -1089,13 +1242,20 @@ protected:
    Void setMsgDelete( Bool v ) { m_msgdel = v; }
 
 private:
+   typedef std::pair<ULongLong,struct avp*> FDAvpIndexEntry;
+
    FDMessage();
 
+   Void buildIndex();
+   static ULongLong indexKey( vendor_id_t vndid, avp_code_t avpcode ) { return ((ULongLong)vndid << 32) | avpcode; }
+
    FDDictionaryEntryCommand *m_de;
    struct msg *m_msg;
    Bool m_dedel;
    Bool m_msgdel;
    struct dict_cmd_data m_basedata;
+   Bool m_indexed;
+   std::vector<FDAvpIndexEntry> m_index;
 };
 
 /// @brief Represents a Diameter answer message (in rsponse to a request).
@@ -1148,9 +1308,29 @@ public:
    virtual ~FDMessageRequest();
 
    /// @brief Sends the request.
+   /// @details If a throttle has been configured for the application with
+   ///   FDOverloadControl, the request must acquire it before being sent.
+   ///   The capacity is released when the answer is received, or when the
+   ///   request expires after the request timeout of the throttle, in which
+   ///   case freeDiameter discards the request and processAnswer() is not
+   ///   called.
    /// @return reference to this message object.
+   /// @throws FDThrottleException if the request was rejected by the application throttle.
    /// @throws FDException
    FDMessageRequest &send();
+   /// @brief Sends the request, delivering the answer to the thread associated with the router.
+   /// @param router the router that the answer will be queued to.
+   /// @return reference to this message object.
+   /// @throws FDException
+   FDMessageRequest &send( FDAnswerRouter &router ) { setAnswerRouter( &router ); return send(); }
+
+   /// @brief Assigns the router that the answer will be queued to.
+   /// @param router the answer router or NULL to process the answer on the freeDiameter thread.
+   /// @return reference to this message object.
+   FDMessageRequest &setAnswerRouter( FDAnswerRouter *router ) { m_router = router; return *this; }
+   /// @brief Retrieves the router that the answer will be queued to.
+   /// @return the answer router or NULL if the answer is processed on the freeDiameter thread.
+   FDAnswerRouter *getAnswerRouter() { return m_router; }
 
    /// @brief A virtual message that will process the answer message received in response to this request message.
    /// @param ans A reference to the answer message.
@@ -1167,9 +1347,66 @@ protected:
    ETimer m_timer;
 
 private:
+   friend FDAnswerRouter;
+
    static Void anscb( Void * data, struct msg ** pmsg );
+   static Void expirecb( Void * data, DiamId_t sentto, size_t senttolen, struct msg ** pmsg );
+   Void deliverAnswer( struct msg **pmsg );
+   Void releaseThrottle();
 
    Bool m_preserve_answer;
+   FDThrottle *m_throttle;
+   FDAnswerRouter *m_router;
+   struct msg *m_answer;
+   FDMessageRequest *m_next;
+};
+
+/// @brief Queues answers to an EThreadEvent thread for processing.
+/// @details The request object is used as the queue entry, so queueing an
+///   answer does not allocate.  A single event message is posted to the
+///   thread when the first answer is queued, and every answer queued before
+///   the thread calls processAnswers() is delivered by that event.
+class FDAnswerRouter
+{
+   friend FDMessageRequest;
+
+public:
+   /// @brief Default constructor.
+   FDAnswerRouter();
+   /// @brief Class destructor.
+   ~FDAnswerRouter();
+
+   /// @brief Associates this router with a thread.
+   /// @param thread the thread that will process the answers.
+   /// @param msgid the event message ID that will be posted to the thread.
+   template <class TQueue, class TMessage>
+   Void init( EThreadEvent<TQueue,TMessage> &thread, UInt msgid )
+   {
+      TMessage *msg = new TMessage( msgid );
+      msg->setVoidPtr( this );
+      init( &thread, msg );
+   }
+
+   /// @brief Calls processAnswer() for each of the queued answers.
+   /// @details This method must be called in the context of the thread
+   ///   associated with this router when the event message is received.
+   /// @return the number of answers processed.
+   Int processAnswers();
+
+   /// @brief Retrieves the number of answers waiting to be processed.
+   /// @return the number of answers waiting to be processed.
+   Int getPending() { return m_pending; }
+
+private:
+   Void init( _EThreadEventBase *thread, _EThreadEventMessageBase *msg );
+   Void queueAnswer( FDMessageRequest *req, struct msg *ans );
+
+   EMutexPrivate m_mutex;
+   _EThreadEventBase *m_thread;
+   _EThreadEventMessageBase *m_msg;
+   FDMessageRequest *m_head;
+   FDMessageRequest *m_tail;
+   Int m_pending;
 };
 
 /// @brief Represents a command, a request or answer, that will be registered with freeDiameter.
@@ -1284,6 +1521,144 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+/// @brief Thrown when a request is rejected by an FDThrottle.
+class FDThrottleException : public FDException
+{
+public:
+   /// @brief Class constructor.
+   ///
+   /// @param m the text associated with the exception.
+   ///
+   FDThrottleException(const std::string &m) : FDException(m) {}
+};
+
+/// @brief Defines what happens to a request that exceeds the limits of an FDThrottle.
+enum FDThrottlePolicy
+{
+   /// The request is rejected immediately.
+   TPFastFail,
+   /// The sender waits for capacity, up to the maximum wait time, before the request is rejected.
+   TPQueue
+};
+
+/// @brief Limits the outstanding requests and the request rate sent to a
+///   peer or an application.
+/// @details Three limits are applied, each of which is disabled by default.
+///   The concurrency window limits the number of requests that have been
+///   sent and not answered.  The token bucket limits the sustained request
+///   rate while allowing bursts.  The overload reduction, typically set from
+///   a DOIC (RFC 7683) overload report, rejects the reported percentage of
+///   requests, spread evenly, until the report expires.
+class FDThrottle
+{
+public:
+   /// @brief Default constructor.
+   FDThrottle();
+   /// @brief Class destructor.
+   ~FDThrottle();
+
+   /// @brief Assigns the concurrency window.
+   /// @param v the maximum number of outstanding requests, 0 for unlimited.
+   /// @return reference to this object.
+   FDThrottle &setMaxInflight( Int v ) { m_maxinflight = v; return *this; }
+   /// @brief Retrieves the concurrency window.
+   /// @return the maximum number of outstanding requests, 0 for unlimited.
+   Int getMaxInflight() const { return m_maxinflight; }
+   /// @brief Assigns the token bucket rate limit.
+   /// @param rate the number of requests per second, 0 for unlimited.
+   /// @param burst the bucket size, defaults to one second of requests.
+   /// @return reference to this object.
+   FDThrottle &setRate( Double rate, Int burst = 0 );
+   /// @brief Retrieves the token bucket rate limit.
+   /// @return the number of requests per second, 0 for unlimited.
+   Double getRate() const { return m_rate; }
+   /// @brief Assigns the policy applied to requests that exceed the limits.
+   /// @param policy the throttle policy.
+   /// @param maxwait the maximum time in milliseconds a TPQueue sender will wait.
+   /// @return reference to this object.
+   FDThrottle &setPolicy( FDThrottlePolicy policy, Long maxwait = 0 );
+   /// @brief Retrieves the policy applied to requests that exceed the limits.
+   /// @return the throttle policy.
+   FDThrottlePolicy getPolicy() const { return m_policy; }
+   /// @brief Assigns the time after which an unanswered request expires.
+   /// @details A request that acquired this throttle is sent with this
+   ///   timeout, so the capacity of a request that is never answered is
+   ///   always released.
+   /// @param v the number of milliseconds, the default is 30000.
+   /// @return reference to this object.
+   FDThrottle &setRequestTimeout( Long v ) { m_requesttimeout = v > 0 ? v : 1; return *this; }
+   /// @brief Retrieves the time after which an unanswered request expires.
+   /// @return the number of milliseconds.
+   Long getRequestTimeout() const { return m_requesttimeout; }
+
+   /// @brief Applies an overload report.
+   /// @param percent the percentage of requests to reject, 0 ends the overload condition.
+   /// @param validity the number of milliseconds the report is valid for.
+   /// @param seqnum the report sequence number.  While a report is being
+   ///   applied, a report with the same or a lower sequence number is ignored
+   ///   and does not extend the validity of the current report.
+   /// @return True if the report was applied, otherwise False.
+   Bool setReduction( Int percent, Long validity, ULongLong seqnum = 0 );
+   /// @brief Retrieves the current overload reduction.
+   /// @return the percentage of requests being rejected.
+   Int getReduction();
+
+   /// @brief Indicates if a request should be rejected because of the overload reduction.
+   /// @details Each call counts as one request when spreading the rejections,
+   ///   so it should only be called once per request.  Use getReduction() to
+   ///   check the reduction without counting a request.
+   /// @return True if the request should be rejected, otherwise False.
+   Bool abate();
+
+   /// @brief Acquires capacity for a request, applying the throttle policy.
+   /// @return True if the request can be sent, otherwise False.
+   Bool acquire();
+   /// @brief Acquires capacity for a request without waiting.
+   /// @return True if the request can be sent, otherwise False.
+   Bool tryAcquire();
+   /// @brief Indicates if a request could be sent without consuming any capacity.
+   /// @return True if there is capacity for a request, otherwise False.
+   Bool isAvailable();
+   /// @brief Records a request that has been sent regardless of the limits.
+   Void consume();
+   /// @brief Releases the capacity of an answered (or failed) request.
+   Void release();
+
+   /// @brief Retrieves the number of outstanding requests.
+   /// @return the number of outstanding requests.
+   Int getInflight() const { Int v = m_inflight.load( std::memory_order_relaxed ); return v > 0 ? v : 0; }
+   /// @brief Retrieves the number of requests that have been rejected.
+   /// @return the number of requests that have been rejected.
+   ULongLong getRejected() const { return m_rejected.load( std::memory_order_relaxed ); }
+
+private:
+   FDThrottle( const FDThrottle & );
+   FDThrottle &operator=( const FDThrottle & );
+
+   Bool takeToken( Bool peek );
+
+   Int m_maxinflight;
+   Double m_rate;
+   Double m_burst;
+   FDThrottlePolicy m_policy;
+   Long m_maxwait;
+   Long m_requesttimeout;
+
+   std::atomic<Int> m_inflight;
+   std::atomic<ULongLong> m_rejected;
+
+   EMutexPrivate m_bucketmutex;
+   Double m_tokens;
+   ULongLong m_lastrefill;
+
+   std::atomic<Int> m_reduction;
+   std::atomic<ULongLong> m_reductionexpires;
+   std::atomic<ULongLong> m_reductionseq;
+   std::atomic<ULongLong> m_abatecnt;
+
+   EEvent *m_released;
+};
+
 /// @brief Peer state enumerations.
 enum FDPeerState
 {
@@ -1378,6 +1753,37 @@ public:
    /// @brief Adds the peer to freeDiameter.
    Void add();
 
+   /// @brief Indicates if the Diameter ID matches this peer.
+   /// @param diamid the Diameter ID to compare.
+   /// @param len the length of the Diameter ID.
+   /// @return True if the Diameter ID matches this peer, otherwise False.
+   Bool isPeer( DiamId_t diamid, size_t len ) const { return m_diamid.size() == len && strncasecmp( m_diamid.c_str(), diamid, len ) == 0; }
+
+   /// @brief Retrieves the throttle that limits the requests routed to the peer.
+   /// @details The limits are applied by FDPeerLoadBalancer when routing.
+   /// @return the peer throttle.
+   FDThrottle &getThrottle() { return m_throttle; }
+
+   /// @brief Retrieves the number of requests sent to the peer that have not been answered.
+   /// @return the number of outstanding requests.
+   Int getInflight() const { return m_throttle.getInflight(); }
+   /// @brief Retrieves the smoothed (EWMA) answer latency of the peer.
+   /// @return the smoothed answer latency in microseconds.
+   ULongLong getLatency() const { return m_latency.load( std::memory_order_relaxed ); }
+   /// @brief Retrieves the load score of the peer.
+   /// @details The score is the expected time to drain the outstanding
+   ///   requests, so a lower score indicates a less loaded peer.
+   /// @return the load score of the peer.
+   ULongLong getLoad() const { return ( (ULongLong)getInflight() + 1 ) * ( getLatency() + 1 ); }
+
+   /// @brief Records that a request has been sent to the peer.
+   Void requestSent() { m_throttle.consume(); }
+   /// @brief Records that an answer has been received from the peer.
+   /// @param latency the time in microseconds between sending the request and receiving the answer.
+   Void answerReceived( ULongLong latency );
+   /// @brief Records that an outstanding request will not be answered by the peer.
+   Void requestFailed() { m_throttle.release(); }
+
 private:
    Void init();
    static Void peercb( struct peer_info *pi, Void *data );
@@ -1387,6 +1793,8 @@ private:
    EString m_destip;
    uint16_t m_port;
    struct peer_hdr *m_peer;
+   FDThrottle m_throttle;
+   std::atomic<ULongLong> m_latency;
 };
 
 /// @brief A list of FDPeer objects.
@@ -1405,6 +1813,15 @@ public:
    /// @brief Retrieves the first peer that is an open state.
    /// @return Pointer to the open peer.
    FDPeer *getOpenPeer();
+   /// @brief Retrieves the open peer with the lowest load score.
+   /// @return Pointer to the open peer or NULL if no peers are open.
+   FDPeer *getLeastLoadedPeer();
+
+   /// @brief Retrieves the peer associated with a Diameter ID.
+   /// @param diamid the Diameter ID of the peer.
+   /// @param len the length of the Diameter ID.
+   /// @return Pointer to the peer or NULL if the peer is not in the list.
+   FDPeer *findPeer( DiamId_t diamid, size_t len );
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1600,14 +2017,29 @@ public:
    /// @return True if the message or AVP was successfully converted to JSON, otherwise False.
    Bool getJson( std::string &json );
 
+   /// @brief Resets this extractor and all of its children so that it can be
+   ///   reused for another message.
+   /// @details No memory is released.  The extractor objects created for list
+   ///   entries are retained and reused when the next message is resolved.
+   ///   The reference must be assigned with setReference() before the
+   ///   extractor is used again.
+   Void reset();
+   /// @brief Locates all of the AVP's in the message, including those in
+   ///   grouped AVP's, in a single pass.
+   Void resolveAll();
+
 protected:
    /// @brief Locates this AVP in the freeDiameter message or grouped AVP.
    Void resolve();
 
 private:
+   typedef std::pair<FDExtractorKey,FDExtractorBase*> FDExtractorEntry;
+
+   FDExtractorBase *findEntry( vendor_id_t vndid, avp_code_t avpcode );
+
    FDExtractor *m_parent;
    msg_or_avp *m_reference;
-   std::map<FDExtractorKey,FDExtractorBase*> m_entries;
+   std::vector<FDExtractorEntry> m_entries;
    Int m_index;
 };
 
@@ -1649,21 +2081,31 @@ public:
    /// @brief Prints the underlying freeDiameter message or AVP to stdout.
    Void dump();
 
+   /// @brief Resets the extractors in the list, retaining them for reuse.
+   Void reset();
+
 protected:
    /// @brief Retrieves the extractor list.
    /// @return the extractor list.
    std::list<FDExtractor*> &getList();
+   /// @brief Adds an extractor to the list, reusing a previously created
+   ///   extractor if one is available.
+   /// @return the extractor that was added to the list.
+   FDExtractor *nextExtractor();
 
 private:
    FDExtractorList();
 
    FDExtractor *m_parent;
    std::list<FDExtractor*> m_list;
+   std::list<FDExtractor*> m_free;
 };
 
 /// @brief An AVP extractor object.
 class FDExtractorAvp : public FDExtractorBase
 {
+   DECLARE_FD_POOLED_OBJECT()
+
 public:
    /// @brief Class constructor.
    /// @param extractor the parent extractor.
@@ -1747,6 +2189,9 @@ public:
    /// @return True if the JSON string was populated, otherwise False.
    Bool getJson( std::string &json );
 
+   /// @brief Resets the extractor so that it can be reused.
+   Void reset();
+
 private:
    FDExtractor &m_extractor;
    FDAvp m_avp;
@@ -1778,11 +2223,19 @@ public:
    /// @brief Prints the underlying freeDiameter message or AVP to stdout.
    Void dump();
 
+   /// @brief Resets the AVP extractors in the list, retaining them for reuse.
+   Void reset();
+   /// @brief Adds an AVP extractor to the list, reusing a previously created
+   ///   AVP extractor if one is available.
+   /// @return the AVP extractor that was added to the list.
+   FDExtractorAvp *nextAvp();
+
 private:
    FDExtractorAvpList();
 
    FDExtractor *m_parent;
    std::list<FDExtractorAvp*> m_list;
+   std::list<FDExtractorAvp*> m_free;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1806,6 +2259,10 @@ public:
 
    /// @brief Registers the hook for the specified events.   
    Bool registerHook(UInt hookmask);
+   /// @brief Registers the hook for the specified events with per message data.
+   /// @param hookmask the events to register for.
+   /// @param datahdl the per message data handle from fd_hook_data_register().
+   Bool registerHook(UInt hookmask, struct fd_hook_data_hdl *datahdl);
    /// @brief Unregisters the hook.
    Void unregisterHook();
 
@@ -1825,6 +2282,91 @@ private:
    struct fd_hook_hdl *m_hdl;
 };
 
+/// @brief Routes requests to the least loaded peer in a peer list.
+/// @details The balancer tracks the outstanding requests and the smoothed
+///   answer latency of each peer in the list using freeDiameter hooks and
+///   registers a routing out callback.  A request that fails over, is
+///   dropped or is freed without an answer no longer counts as outstanding.
+///   When several peers in the list share the best routing score, two of
+///   them are picked at random and the one with the lower load score is
+///   preferred (power of two choices).
+///   Peers that are not in the list and freeDiameter's routing priorities
+///   are unaffected.  The peer list must not be modified while the balancer
+///   is running.
+class FDPeerLoadBalancer : public FDHook
+{
+public:
+   /// @brief Class constructor.
+   /// @param peers the peers to balance the load across.
+   FDPeerLoadBalancer( FDPeerList &peers );
+   /// @brief Class destructor.
+   ~FDPeerLoadBalancer();
+
+   /// @brief Registers the hooks and routing callback with freeDiameter.
+   /// @param priority the priority of the routing callback.
+   /// @return True if the balancer was started, otherwise False.
+   Bool start( Int priority = 0 );
+   /// @brief Unregisters the hooks and routing callback.
+   Void stop();
+
+   /// @cond DOXYGEN_EXCLUDE
+   Void process(enum fd_hook_type type, struct msg * msg, struct peer_hdr * peer,
+      Void * other, struct fd_hook_permsgdata *pmd);
+   /// @endcond
+
+private:
+   static int rtOut( Void *cbdata, struct msg **pmsg, struct fd_list *candidates );
+   UInt random();
+
+   FDPeerList &m_peers;
+   struct fd_hook_data_hdl *m_datahdl;
+   struct fd_rt_out_hdl *m_rthdl;
+   std::atomic<ULongLong> m_seed;
+};
+
+/// @brief Applies throttles to the requests sent by each Diameter
+///   application and processes DOIC (RFC 7683) overload reports.
+/// @details A request sent with FDMessageRequest::send() acquires the
+///   throttle of its application, if one has been configured, and releases
+///   it when the answer is received.  When started, an OC-OLR AVP received
+///   in an answer is applied to the throttle of the reporting peer for a
+///   host report or of the application for a realm report.  Advertising
+///   OC-Supported-Features in the requests is the responsibility of the
+///   application.
+class FDOverloadControl
+{
+public:
+   /// @brief Registers the hook that processes overload reports.
+   /// @param peers the peers that host reports will be applied to.
+   static Void init( FDPeerList *peers = NULL );
+   /// @brief Unregisters the overload report hook.
+   static Void uninit();
+
+   /// @brief Retrieves the throttle for an application, creating it if necessary.
+   /// @param appid the application ID.
+   /// @return the application throttle.
+   static FDThrottle &getThrottle( UInt appid );
+   /// @brief Retrieves the throttle for an application.
+   /// @param appid the application ID.
+   /// @return the application throttle or NULL if one has not been created.
+   static FDThrottle *findThrottle( UInt appid );
+
+private:
+   /// @cond DOXYGEN_EXCLUDE
+   class OverloadHook : public FDHook
+   {
+   public:
+      Void process(enum fd_hook_type type, struct msg * msg, struct peer_hdr * peer,
+         Void * other, struct fd_hook_permsgdata *pmd);
+   };
+   /// @endcond
+
+   static OverloadHook m_hook;
+   static FDPeerList *m_peers;
+   static ERWLock m_lock;
+   static std::map<UInt,FDThrottle*> m_throttles;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
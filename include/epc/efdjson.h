@@ -27,6 +27,9 @@
 
 #ifdef __cplusplus
 /// @brief Creates a JSON string representing the AVP values.
+/// @details The JSON is written directly into json as the message is
+///   traversed, so reusing the same string for multiple messages avoids
+///   any memory allocation once it has grown large enough.
 /// @param ref the freeDiameter message or AVP to convert to JSON.
 /// @param json the destination for the JSON string.
 /// @param errfunc a function that is called in the event of an error.
@@ -42,10 +45,64 @@ bool fdJsonGetValueOfMember( std::string json, std::string member, std::string &
 /// @param apn where the APN will be stored if found.
 /// @return true if the APN was found, otherwise false.
 bool fdJsonGetApnValueFromSubData( std::string json, std::string &apn );
+
+/// @cond DOXYGEN_EXCLUDE
+struct JsonTemplateNode;
+/// @endcond
+
+/// @brief A JSON to Diameter conversion template.
+/// @details A template is compiled from a sample JSON document that has the
+///   same shape as the documents that will be converted.  The dictionary
+///   entry for each member is resolved once when the template is compiled,
+///   so applying the template to a JSON document only has to compare the
+///   member names with the template.  Members that are not part of the
+///   template are resolved using the dictionary.  A compiled template is
+///   not modified when applied and can be shared between threads.
+class FDJsonTemplate
+{
+   friend int fdJsonAddAvps( const FDJsonTemplate &tmpl, const char *json, msg_or_avp *msg, void (*errfunc)(const char *) );
+public:
+   /// @brief Default constructor.
+   FDJsonTemplate();
+   /// @brief Class constructor.
+   /// @param json the sample JSON document to compile.
+   /// @param errfunc a function that is called in the event of an error.
+   FDJsonTemplate( const char *json, void (*errfunc)(const char *) );
+   /// @brief Class destructor.
+   ~FDJsonTemplate();
+
+   /// @brief Compiles the template from a sample JSON document.
+   /// @param json the sample JSON document to compile.
+   /// @param errfunc a function that is called in the event of an error.
+   /// @return 0 indicates success, otherwise failure.
+   int compile( const char *json, void (*errfunc)(const char *) );
+   /// @brief Indicates if the template has been compiled.
+   /// @return true if the template has been compiled, otherwise false.
+   bool isCompiled() const { return m_root != NULL; }
+
+private:
+   FDJsonTemplate( const FDJsonTemplate & );
+   FDJsonTemplate &operator=( const FDJsonTemplate & );
+
+   JsonTemplateNode *m_root;
+};
+
+/// @brief Adds the AVP from the JSON string to a freeDiameter message or grouped AVP
+///   using a compiled template.
+/// @param tmpl the compiled template.
+/// @param json the JSON string to process.
+/// @param msg the freeDiameter or grouped AVP to add to.
+/// @param errfunc a function that is called in the event of an error.
+/// @return 0 indicates success, otherwise failure.
+int fdJsonAddAvps( const FDJsonTemplate &tmpl, const char *json, msg_or_avp *msg, void (*errfunc)(const char *) );
+
 extern "C" {
 #endif
 
 /// @brief Adds the AVP from the JSON string to a freeDiameter message or grouped AVP.
+/// @details The AVP's are created as the JSON string is parsed, so if the
+///   JSON string is malformed, the AVP's preceding the error will have
+///   already been added.
 /// @param json the JSON string to process.
 /// @param msg the freeDiameter or grouped AVP to add to.
 /// @param errfunc a function that is called in the event of an error.
@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2020 Sprint
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __EHISTOGRAM_H
+#define __EHISTOGRAM_H
+
+/// @file
+/// @brief Defines a lock-free histogram with power of 2 bucket boundaries.
+
+#include <atomic>
+
+#include "ebase.h"
+
+/// @brief A lock-free histogram with power of 2 bucket boundaries.
+/// @details Bucket 0 counts values of 0, bucket n counts values in the
+///   range [2^(n-1), 2^n - 1].  The last bucket collects all larger
+///   values.  Recording a value is wait-free, so it can be called from
+///   any thread without additional synchronization.  Typically used to
+///   record latencies in microseconds.
+class EHistogram
+{
+public:
+   /// @brief The number of buckets in the histogram.
+   static const Int Buckets = 32;
+
+   /// @brief Default constructor.
+   EHistogram()
+   {
+      reset();
+   }
+
+   /// @brief Resets all of the buckets and summary values to zero.
+   Void reset()
+   {
+      for (Int i = 0; i < Buckets; i++)
+         m_buckets[i] = 0;
+      m_count = 0;
+      m_sum = 0;
+      m_max = 0;
+   }
+
+   /// @brief Records a value in the histogram.
+   /// @param value the value to record.
+   Void record(ULongLong value)
+   {
+      m_buckets[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+      m_count.fetch_add(1, std::memory_order_relaxed);
+      m_sum.fetch_add(value, std::memory_order_relaxed);
+
+      ULongLong mx = m_max.load(std::memory_order_relaxed);
+      while (value > mx && !m_max.compare_exchange_weak(mx, value, std::memory_order_relaxed))
+         ;
+   }
+
+   /// @brief Retrieves the number of values recorded.
+   /// @return the number of values recorded.
+   ULongLong getCount() const { return m_count.load(std::memory_order_relaxed); }
+   /// @brief Retrieves the sum of all values recorded.
+   /// @return the sum of all values recorded.
+   ULongLong getSum() const { return m_sum.load(std::memory_order_relaxed); }
+   /// @brief Retrieves the largest value recorded.
+   /// @return the largest value recorded.
+   ULongLong getMax() const { return m_max.load(std::memory_order_relaxed); }
+   /// @brief Retrieves the average of all values recorded.
+   /// @return the average of all values recorded.
+   Double getAverage() const
+   {
+      ULongLong cnt = getCount();
+      return cnt ? (Double)getSum() / (Double)cnt : 0.0;
+   }
+
+   /// @brief Retrieves the number of values recorded in a bucket.
+   /// @param bucket the bucket index.
+   /// @return the number of values recorded in the bucket.
+   ULongLong getBucketCount(Int bucket) const
+   {
+      return bucket >= 0 && bucket < Buckets ? m_buckets[bucket].load(std::memory_order_relaxed) : 0;
+   }
+
+   /// @brief Retrieves the largest value that will be counted in a bucket.
+   /// @param bucket the bucket index.
+   /// @return the largest value that will be counted in a bucket.
+   static ULongLong getBucketLimit(Int bucket)
+   {
+      if (bucket <= 0)
+         return 0;
+      if (bucket >= Buckets - 1)
+         return ~0ULL;
+      return (1ULL << bucket) - 1;
+   }
+
+   /// @brief Estimates the value at the specified percentile.
+   /// @param pct the percentile (0.0 - 100.0).
+   /// @return the upper limit of the bucket containing the percentile.
+   ULongLong getPercentile(Double pct) const
+   {
+      ULongLong cnt = getCount();
+      if (cnt == 0)
+         return 0;
+
+      ULongLong target = (ULongLong)((pct / 100.0) * cnt + 0.5);
+      if (target == 0)
+         target = 1;
+
+      ULongLong accum = 0;
+      for (Int i = 0; i < Buckets; i++)
+      {
+         accum += getBucketCount(i);
+         if (accum >= target)
+         {
+            ULongLong limit = getBucketLimit(i);
+            ULongLong mx = getMax();
+            return limit < mx ? limit : mx;
+         }
+      }
+
+      return getMax();
+   }
+
+   /// @brief Retrieves the bucket index a value will be counted in.
+   /// @param value the value.
+   /// @return the bucket index.
+   static Int getBucket(ULongLong value)
+   {
+      if (value == 0)
+         return 0;
+      Int b = 64 - __builtin_clzll(value);
+      return b < Buckets ? b : Buckets - 1;
+   }
+
+private:
+   EHistogram(const EHistogram &);
+   EHistogram &operator=(const EHistogram &);
+
+   std::atomic<ULongLong> m_buckets[Buckets];
+   std::atomic<ULongLong> m_count;
+   std::atomic<ULongLong> m_sum;
+   std::atomic<ULongLong> m_max;
+};
+
+#endif // #ifndef __EHISTOGRAM_H
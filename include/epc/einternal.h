@@ -80,6 +80,7 @@ private:
 #define SECTION_TOOLS "EpcTools"
 #define SECTION_SYNCH_OBJS "SynchronizationObjects"
 #define SECTION_PUBLIC_QUEUE "PublicQueue"
+#define SECTION_SHARED_MEMORY "SharedMemory"
 
 #define SECTION_LOGGER "Logger"
 #define MEMBER_LOGGER_APPLICATION_NAME "ApplicationName"
@@ -111,6 +112,12 @@ private:
 #define MEMBER_ALLOW_MULTIPLE_READERS "AllowMultipleReaders"
 #define MEMBER_ALLOW_MULTIPLE_WRITERS "AllowMultipleWriters"
 #define MEMBER_DEBUG "Debug"
+#define MEMBER_SHMEM_BACKEND "Backend"
+#define MEMBER_SHMEM_HUGE_PAGES "HugePages"
+#define MEMBER_SHMEM_HUGE_PAGE_DIRECTORY "HugePageDirectory"
+#define MEMBER_SHMEM_POPULATE "Populate"
+#define MEMBER_SHMEM_NUMA_NODE "NumaNode"
+#define MEMBER_QUEUE_STATISTICS "QueueStatistics"
 // #define MEMBER_WRITE_TO_FILE "WriteToFile"
 // #define MEMBER_QUEUE_MODE "QueueMode"
 // #define MEMBER_LOGGER_ID "LogID"
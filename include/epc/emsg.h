@@ -20,11 +20,29 @@
 
 /// @file
 /// @brief Classes used to encode and decode messages sent to and recieved from a message queue.
+/// @details A message can implement getLength(), serialize() and unserialize()
+///   by hand with the pack() and unpack() methods, or it can list its fields
+///   with the EPC_MESSAGE_FIELDS() macro which generates all three methods.
+
+#include <type_traits>
 
 #include "ebase.h"
+#include "eerror.h"
+#include "estring.h"
 #include "etime.h"
 #include "etimer.h"
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/// @cond DOXYGEN_EXCLUDE
+DECLARE_ERROR(EMessageError_VersionMismatch);
+DECLARE_ERROR(EMessageError_DecodeOverrun);
+/// @endcond
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 /// @brief The message queue base message class.
 class EMessage
 {
@@ -370,15 +388,344 @@ public:
 
       unpack(vectorLength, Buffer, nOffset);
 
+      m_list.reserve(m_list.size() + vectorLength);
       for (ULong i = 0; i < vectorLength; i++)
       {
-         T val;
-         val.unserialize(Buffer, nOffset);
-         m_list.push_back(val);
+         m_list.emplace_back();
+         m_list.back().unserialize(Buffer, nOffset);
       }
    }
 
+   /// @brief Calcuates the packed length of the vector.
+   /// @param length the length value to update.
+   virtual Void getLength(ULong &length) { vectorLength(length); }
+   /// @brief Packs the vector.
+   /// @param pBuffer a pointer to the destination buffer.
+   /// @param nOffset the offset into the destination buffer to write the data to.
+   virtual Void serialize(pVoid pBuffer, ULong &nOffset) { packVector(pBuffer, nOffset); }
+   /// @brief Unpacks a vector.
+   /// @param pBuffer a pointer to the source buffer to unpack.
+   /// @param nOffset the offset into the source buffer to read the data from.
+   virtual Void unserialize(pVoid pBuffer, ULong &nOffset) { unpackVector(pBuffer, nOffset); }
+
 private:
    vector<T> m_list;
 };
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/// @cond DOXYGEN_EXCLUDE
+
+inline Void EMessageFieldCheck(ULong nOffset, ULong nLength, ULong nEnd)
+{
+   if (nOffset + nLength > nEnd)
+      throw EMessageError_DecodeOverrun();
+}
+
+// describes how a field type is encoded, FixedLength is known at compile
+// time and variableLength() is only called for types that need it
+template <typename T, typename Enable = void>
+struct EMessageField;
+
+// arithmetic and enumerated values are copied as is
+template <typename T>
+struct EMessageField<T, typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type>
+{
+   static constexpr ULong FixedLength = sizeof(T);
+   static ULong variableLength(T &val) { return 0; }
+   static Void pack(T &val, pStr pBuffer, ULong &nOffset)
+   {
+      memcpy(&pBuffer[nOffset], &val, sizeof(T));
+      nOffset += sizeof(T);
+   }
+   static Void unpack(T &val, pStr pBuffer, ULong &nOffset, ULong nEnd)
+   {
+      EMessageFieldCheck(nOffset, sizeof(T), nEnd);
+      memcpy(&val, &pBuffer[nOffset], sizeof(T));
+      nOffset += sizeof(T);
+   }
+};
+
+// arrays of arithmetic values are copied with a single memcpy
+template <typename T, size_t N>
+struct EMessageField<T[N], typename std::enable_if<(std::is_arithmetic<T>::value || std::is_enum<T>::value) && !std::is_same<T, Char>::value>::type>
+{
+   static constexpr ULong FixedLength = sizeof(T) * N;
+   static ULong variableLength(T (&val)[N]) { return 0; }
+   static Void pack(T (&val)[N], pStr pBuffer, ULong &nOffset)
+   {
+      memcpy(&pBuffer[nOffset], val, sizeof(T) * N);
+      nOffset += sizeof(T) * N;
+   }
+   static Void unpack(T (&val)[N], pStr pBuffer, ULong &nOffset, ULong nEnd)
+   {
+      EMessageFieldCheck(nOffset, sizeof(T) * N, nEnd);
+      memcpy(val, &pBuffer[nOffset], sizeof(T) * N);
+      nOffset += sizeof(T) * N;
+   }
+};
+
+// character arrays are encoded as a length followed by the characters
+template <size_t N>
+struct EMessageField<Char[N]>
+{
+   static constexpr ULong FixedLength = sizeof(UShort);
+   static ULong variableLength(Char (&val)[N]) { return strnlen(val, N - 1); }
+   static Void pack(Char (&val)[N], pStr pBuffer, ULong &nOffset)
+   {
+      UShort len = (UShort)strnlen(val, N - 1);
+      memcpy(&pBuffer[nOffset], &len, sizeof(len));
+      memcpy(&pBuffer[nOffset + sizeof(len)], val, len);
+      nOffset += sizeof(len) + len;
+   }
+   static Void unpack(Char (&val)[N], pStr pBuffer, ULong &nOffset, ULong nEnd)
+   {
+      UShort len;
+      EMessageFieldCheck(nOffset, sizeof(len), nEnd);
+      memcpy(&len, &pBuffer[nOffset], sizeof(len));
+      EMessageFieldCheck(nOffset + sizeof(len), len, nEnd);
+      if (len >= N)
+         throw EMessageError_DecodeOverrun();
+      memcpy(val, &pBuffer[nOffset + sizeof(len)], len);
+      val[len] = '\0';
+      nOffset += sizeof(len) + len;
+   }
+};
+
+template <>
+struct EMessageField<EString>
+{
+   static constexpr ULong FixedLength = sizeof(UShort);
+   static ULong variableLength(EString &val) { return (UShort)val.length(); }
+   static Void pack(EString &val, pStr pBuffer, ULong &nOffset)
+   {
+      UShort len = (UShort)val.length();
+      memcpy(&pBuffer[nOffset], &len, sizeof(len));
+      memcpy(&pBuffer[nOffset + sizeof(len)], val.c_str(), len);
+      nOffset += sizeof(len) + len;
+   }
+   static Void unpack(EString &val, pStr pBuffer, ULong &nOffset, ULong nEnd)
+   {
+      UShort len;
+      EMessageFieldCheck(nOffset, sizeof(len), nEnd);
+      memcpy(&len, &pBuffer[nOffset], sizeof(len));
+      EMessageFieldCheck(nOffset + sizeof(len), len, nEnd);
+      val.assign(&pBuffer[nOffset + sizeof(len)], len);
+      nOffset += sizeof(len) + len;
+   }
+};
+
+template <>
+struct EMessageField<ETime>
+{
+   static constexpr ULong FixedLength = sizeof(LongLong) * 2;
+   static ULong variableLength(ETime &val) { return 0; }
+   static Void pack(ETime &val, pStr pBuffer, ULong &nOffset)
+   {
+      LongLong tv[2] = {(LongLong)val.getTimeVal().tv_sec, (LongLong)val.getTimeVal().tv_usec};
+      memcpy(&pBuffer[nOffset], tv, sizeof(tv));
+      nOffset += sizeof(tv);
+   }
+   static Void unpack(ETime &val, pStr pBuffer, ULong &nOffset, ULong nEnd)
+   {
+      LongLong tv[2];
+      EMessageFieldCheck(nOffset, sizeof(tv), nEnd);
+      memcpy(tv, &pBuffer[nOffset], sizeof(tv));
+      nOffset += sizeof(tv);
+
+      timeval t;
+      t.tv_sec = (time_t)tv[0];
+      t.tv_usec = (time_t)tv[1];
+      val.set(t);
+   }
+};
+
+template <>
+struct EMessageField<ETimer>
+{
+   static constexpr ULong FixedLength = sizeof(epctime_t);
+   static ULong variableLength(ETimer &val) { return 0; }
+   static Void pack(ETimer &val, pStr pBuffer, ULong &nOffset)
+   {
+      epctime_t t = val;
+      memcpy(&pBuffer[nOffset], &t, sizeof(t));
+      nOffset += sizeof(t);
+   }
+   static Void unpack(ETimer &val, pStr pBuffer, ULong &nOffset, ULong nEnd)
+   {
+      epctime_t t;
+      EMessageFieldCheck(nOffset, sizeof(t), nEnd);
+      memcpy(&t, &pBuffer[nOffset], sizeof(t));
+      val.Set(t);
+      nOffset += sizeof(t);
+   }
+};
+
+// nested messages, including EMessageVector, encode themselves
+template <typename T>
+struct EMessageField<T, typename std::enable_if<std::is_base_of<EMessage, T>::value>::type>
+{
+   static constexpr ULong FixedLength = 0;
+   static ULong variableLength(T &val)
+   {
+      ULong len = 0;
+      val.getLength(len);
+      return len;
+   }
+   static Void pack(T &val, pStr pBuffer, ULong &nOffset) { val.serialize(pBuffer, nOffset); }
+   static Void unpack(T &val, pStr pBuffer, ULong &nOffset, ULong nEnd)
+   {
+      val.unserialize(pBuffer, nOffset);
+      EMessageFieldCheck(nOffset, 0, nEnd);
+   }
+};
+
+template <typename... Ts>
+struct EMessageFieldList;
+
+template <>
+struct EMessageFieldList<>
+{
+   static constexpr ULong FixedLength = 0;
+   static ULong variableLength() { return 0; }
+   static Void pack(pStr pBuffer, ULong &nOffset) {}
+   static Void unpack(pStr pBuffer, ULong &nOffset, ULong nEnd) {}
+};
+
+template <typename T, typename... Ts>
+struct EMessageFieldList<T, Ts...>
+{
+   static constexpr ULong FixedLength = EMessageField<T>::FixedLength + EMessageFieldList<Ts...>::FixedLength;
+   static ULong variableLength(T &val, Ts &... vals)
+   {
+      return EMessageField<T>::variableLength(val) + EMessageFieldList<Ts...>::variableLength(vals...);
+   }
+   static Void pack(pStr pBuffer, ULong &nOffset, T &val, Ts &... vals)
+   {
+      EMessageField<T>::pack(val, pBuffer, nOffset);
+      EMessageFieldList<Ts...>::pack(pBuffer, nOffset, vals...);
+   }
+   static Void unpack(pStr pBuffer, ULong &nOffset, ULong nEnd, T &val, Ts &... vals)
+   {
+      EMessageField<T>::unpack(val, pBuffer, nOffset, nEnd);
+      EMessageFieldList<Ts...>::unpack(pBuffer, nOffset, nEnd, vals...);
+   }
+};
+
+/// @endcond
+
+/// @brief Encodes and decodes a list of message fields.
+/// @details The fields are preceded by a header containing a version and
+///   the length of the encoded fields.  The decoder verifies the version,
+///   will not read past the encoded length and skips any fields that were
+///   appended by a newer encoder.  Fixed length fields are copied with a
+///   single memcpy and their combined length is computed at compile time.
+///   This class is normally used through the EPC_MESSAGE_FIELDS() macro.
+class EMessageFields
+{
+public:
+   /// @brief The length of the version and length header.
+   static constexpr ULong HeaderLength = sizeof(UShort) + sizeof(ULong);
+
+   /// @brief Adds the encoded length of the fields to the message length.
+   /// @param length the length value to update.
+   /// @param vals the fields.
+   template <typename... Ts>
+   static Void getLength(ULong &length, Ts &... vals)
+   {
+      length += HeaderLength + EMessageFieldList<Ts...>::FixedLength + EMessageFieldList<Ts...>::variableLength(vals...);
+   }
+
+   /// @brief Encodes the fields.
+   /// @param version the version of the field list.
+   /// @param pBuffer a pointer to the destination buffer.
+   /// @param nOffset a reference to the next location to write to in the buffer.
+   /// @param vals the fields.
+   template <typename... Ts>
+   static Void serialize(UShort version, pVoid pBuffer, ULong &nOffset, Ts &... vals)
+   {
+      pStr buf = (pStr)pBuffer;
+      ULong start = nOffset;
+
+      nOffset += HeaderLength;
+      EMessageFieldList<Ts...>::pack(buf, nOffset, vals...);
+
+      ULong len = nOffset - start - HeaderLength;
+      memcpy(&buf[start], &version, sizeof(version));
+      memcpy(&buf[start + sizeof(version)], &len, sizeof(len));
+   }
+
+   /// @brief Decodes the fields.
+   /// @param version the expected version of the field list.
+   /// @param pBuffer a pointer to the source buffer.
+   /// @param nOffset a reference to the next location in the buffer to read.
+   /// @param vals the fields.
+   /// @throws EMessageError_VersionMismatch if the encoded version is different.
+   /// @throws EMessageError_DecodeOverrun if a field extends past the encoded length.
+   template <typename... Ts>
+   static Void unserialize(UShort version, pVoid pBuffer, ULong &nOffset, Ts &... vals)
+   {
+      pStr buf = (pStr)pBuffer;
+      UShort ver;
+      ULong len;
+
+      memcpy(&ver, &buf[nOffset], sizeof(ver));
+      memcpy(&len, &buf[nOffset + sizeof(ver)], sizeof(len));
+      if (ver != version)
+         throw EMessageError_VersionMismatch();
+
+      ULong end = nOffset + HeaderLength + len;
+      nOffset += HeaderLength;
+      EMessageFieldList<Ts...>::unpack(buf, nOffset, end, vals...);
+      nOffset = end;
+   }
+};
+
+/// @brief Generates getLength(), serialize() and unserialize() for a message.
+/// @details Place the macro in the public section of a class derived from
+///   EMessage.  The base class is encoded first, followed by each of the
+///   listed member fields.  Supported field types are the arithmetic types,
+///   enumerations, arrays of arithmetic values, character arrays, EString,
+///   ETime, ETimer and classes derived from EMessage (including EMessageVector).
+/// @code
+/// class MyMessage : public EQueueMessage
+/// {
+/// public:
+///    EPC_MESSAGE_FIELDS(EQueueMessage, m_id, m_name, m_values)
+///
+///    Long m_id;
+///    EString m_name;
+///    Double m_values[4];
+/// };
+/// @endcode
+/// @param __base__ the base class of the message.
+/// @param ... the member fields of the message.
+#define EPC_MESSAGE_FIELDS(__base__, ...) \
+   EPC_MESSAGE_FIELDS_VERSION(__base__, 0, __VA_ARGS__)
+
+/// @brief Generates getLength(), serialize() and unserialize() for a versioned message.
+/// @details Identical to EPC_MESSAGE_FIELDS() except that the field list is
+///   tagged with a version.  Decoding a message encoded with a different
+///   version throws EMessageError_VersionMismatch.
+/// @param __base__ the base class of the message.
+/// @param __version__ the version of the field list.
+/// @param ... the member fields of the message.
+#define EPC_MESSAGE_FIELDS_VERSION(__base__, __version__, ...)                          \
+   virtual Void getLength(ULong &length)                                                \
+   {                                                                                    \
+      __base__::getLength(length);                                                      \
+      EMessageFields::getLength(length, __VA_ARGS__);                                   \
+   }                                                                                    \
+   virtual Void serialize(pVoid pBuffer, ULong &nOffset)                                \
+   {                                                                                    \
+      __base__::serialize(pBuffer, nOffset);                                            \
+      EMessageFields::serialize(__version__, pBuffer, nOffset, __VA_ARGS__);            \
+   }                                                                                    \
+   virtual Void unserialize(pVoid pBuffer, ULong &nOffset)                              \
+   {                                                                                    \
+      __base__::unserialize(pBuffer, nOffset);                                          \
+      EMessageFields::unserialize(__version__, pBuffer, nOffset, __VA_ARGS__);          \
+   }
+
 #endif // #ifndef __emsg_h_included
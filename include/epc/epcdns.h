@@ -27,6 +27,9 @@
 #include <sstream>
 #include <list>
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include <atomic>
 
 #include "estring.h"
 #include "dnscache.h"
@@ -441,6 +444,70 @@ namespace EPCDNS
    /////////////////////////////////////////////////////////////////////////////
    /////////////////////////////////////////////////////////////////////////////
 
+   /// @brief Precomputed public land mobile network (PLMN) domain name suffixes.
+   /// @details Used with the Utility FQDN methods that write to a caller
+   ///   supplied buffer so that the PLMN portion of the FQDN is only
+   ///   formatted once per PLMN.
+   class PlmnSuffix
+   {
+   public:
+      /// @brief Default constructor.
+      PlmnSuffix() { set( "", "" ); }
+      /// @brief Class constructor.
+      /// @param mnc the mobile network code.
+      /// @param mcc the mobile country code.
+      PlmnSuffix( const char *mnc, const char *mcc ) { set( mnc, mcc ); }
+      /// @brief Class constructor.
+      /// @param plmnid the public land mobile network ID.
+      PlmnSuffix( const unsigned char *plmnid ) { set( plmnid ); }
+
+      /// @brief Computes the suffixes for the specified PLMN.
+      /// @param mnc the mobile network code.
+      /// @param mcc the mobile country code.
+      Void set( const char *mnc, const char *mcc );
+      /// @brief Computes the suffixes for the specified PLMN.
+      /// @param plmnid the public land mobile network ID.
+      Void set( const unsigned char *plmnid );
+
+      /// @brief Retrieves the home network suffix (mncXXX.mccYYY.3gppnetwork.org).
+      /// @return the home network suffix.
+      const char *getNetwork() const { return m_network; }
+      /// @brief Retrieves the length of the home network suffix.
+      /// @return the length of the home network suffix.
+      size_t getNetworkLength() const { return m_networklen; }
+      /// @brief Retrieves the public suffix (mncXXX.mccYYY.pub.3gppnetwork.org).
+      /// @return the public suffix.
+      const char *getPublic() const { return m_public; }
+      /// @brief Retrieves the length of the public suffix.
+      /// @return the length of the public suffix.
+      size_t getPublicLength() const { return m_publiclen; }
+      /// @brief Retrieves the visited country suffix (mccYYY.visited-country.pub.3gppnetwork.org).
+      /// @return the visited country suffix.
+      const char *getVisitedCountry() const { return m_visitedcountry; }
+      /// @brief Retrieves the length of the visited country suffix.
+      /// @return the length of the visited country suffix.
+      size_t getVisitedCountryLength() const { return m_visitedcountrylen; }
+      /// @brief Retrieves the GPRS suffix (mncXXX.mccYYY.gprs).
+      /// @return the GPRS suffix.
+      const char *getGprs() const { return m_gprs; }
+      /// @brief Retrieves the length of the GPRS suffix.
+      /// @return the length of the GPRS suffix.
+      size_t getGprsLength() const { return m_gprslen; }
+
+   private:
+      char m_network[64];
+      size_t m_networklen;
+      char m_public[64];
+      size_t m_publiclen;
+      char m_visitedcountry[64];
+      size_t m_visitedcountrylen;
+      char m_gprs[64];
+      size_t m_gprslen;
+   };
+
+   /////////////////////////////////////////////////////////////////////////////
+   /////////////////////////////////////////////////////////////////////////////
+
    /// @brief Provides several utilities for manipulating names, services and protocols.
    class Utility
    {
@@ -770,6 +837,173 @@ namespace EPCDNS
       /// @return the Diameter service string.
       static EString getDiameterService( DiameterApplicationEnum app, DiameterProtocolEnum protocol );
 
+      /// @brief Constructs the home network domain name in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the home network domain name or 0 if the buffer is too small.
+      static size_t home_network( char *buf, size_t len, const PlmnSuffix &plmn );
+      /// @brief Constructs the APN operator identifier in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the APN operator identifier or 0 if the buffer is too small.
+      static size_t home_network_gprs( char *buf, size_t len, const PlmnSuffix &plmn );
+      /// @brief Constructs the tracking area identity FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param lb low byte of the type allocation code.
+      /// @param hb high byte of the type allocation code.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the tracking area identity FQDN or 0 if the buffer is too small.
+      static size_t tai_fqdn( char *buf, size_t len, const char *lb, const char *hb, const PlmnSuffix &plmn );
+      /// @brief Constructs the mobile management entity (MME) FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param mmec MME code.
+      /// @param mmegi MME Group ID.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the mobile management entity (MME) FQDN or 0 if the buffer is too small.
+      static size_t mme_fqdn( char *buf, size_t len, const char *mmec, const char *mmegi, const PlmnSuffix &plmn );
+      /// @brief Constructs the MME pool FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param mmegi MME Group ID.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the MME pool FQDN or 0 if the buffer is too small.
+      static size_t mme_pool_fqdn( char *buf, size_t len, const char *mmegi, const PlmnSuffix &plmn );
+      /// @brief Constructs the routing area identity (RAI) FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param rac routing area code.
+      /// @param lac location area code.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the routing area identity (RAI) FQDN or 0 if the buffer is too small.
+      static size_t rai_fqdn( char *buf, size_t len, const char *rac, const char *lac, const PlmnSuffix &plmn );
+      /// @brief Constructs the radio network controller (RNC) FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param rnc radio network controller ID.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the radio network controller (RNC) FQDN or 0 if the buffer is too small.
+      static size_t rnc_fqdn( char *buf, size_t len, const char *rnc, const PlmnSuffix &plmn );
+      /// @brief Constructs the serving GPRS support node (SGSN) FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param nri network resource identifier.
+      /// @param rac routing area code.
+      /// @param lac location area code.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the serving GPRS support node (SGSN) FQDN or 0 if the buffer is too small.
+      static size_t sgsn_fqdn( char *buf, size_t len, const char *nri, const char *rac, const char *lac, const PlmnSuffix &plmn );
+      /// @brief Constructs the EPC nodes subdomain (DNS zone) in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the EPC nodes subdomain (DNS zone) or 0 if the buffer is too small.
+      static size_t epc_nodes_domain_fqdn( char *buf, size_t len, const PlmnSuffix &plmn );
+      /// @brief Constructs the EPC node FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param node the node name.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the EPC node FQDN or 0 if the buffer is too small.
+      static size_t epc_node_fqdn( char *buf, size_t len, const char *node, const PlmnSuffix &plmn );
+      /// @brief Constructs the operator identifier (OI) based ePDG FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the operator identifier (OI) based ePDG FQDN or 0 if the buffer is too small.
+      static size_t nonemergency_epdg_oi_fqdn( char *buf, size_t len, const PlmnSuffix &plmn );
+      /// @brief Constructs the tracking area identity based ePDG FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param lb low byte of the type allocation code.
+      /// @param hb high byte of the type allocation code.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the tracking area identity based ePDG FQDN or 0 if the buffer is too small.
+      static size_t nonemergency_epdg_tai_fqdn( char *buf, size_t len, const char *lb, const char *hb, const PlmnSuffix &plmn );
+      /// @brief Constructs the location area code based ePDG FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param lac location area code.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the location area code based ePDG FQDN or 0 if the buffer is too small.
+      static size_t nonemergency_epdg_lac_fqdn( char *buf, size_t len, const char *lac, const PlmnSuffix &plmn );
+      /// @brief Constructs the visited country FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the visited country FQDN or 0 if the buffer is too small.
+      static size_t nonemergency_epdg_visitedcountry_fqdn( char *buf, size_t len, const PlmnSuffix &plmn );
+      /// @brief Constructs the operator identifier (OI) based emergency ePDG FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the operator identifier (OI) based emergency ePDG FQDN or 0 if the buffer is too small.
+      static size_t emergency_epdg_oi_fqdn( char *buf, size_t len, const PlmnSuffix &plmn );
+      /// @brief Constructs the tracking area identity based emergency ePDG FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param lb low byte of the type allocation code.
+      /// @param hb high byte of the type allocation code.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the tracking area identity based emergency ePDG FQDN or 0 if the buffer is too small.
+      static size_t emergency_epdg_tai_fqdn( char *buf, size_t len, const char *lb, const char *hb, const PlmnSuffix &plmn );
+      /// @brief Constructs the location area code based emergency ePDG FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param lac location area code.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the location area code based emergency ePDG FQDN or 0 if the buffer is too small.
+      static size_t emergency_epdg_lac_fqdn( char *buf, size_t len, const char *lac, const PlmnSuffix &plmn );
+      /// @brief Constructs the visited country emergency FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the visited country emergency FQDN or 0 if the buffer is too small.
+      static size_t emergency_epdg_visitedcountry_fqdn( char *buf, size_t len, const PlmnSuffix &plmn );
+      /// @brief Constructs the global eNodeB ID in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param enb the eNodeB-ID.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the global eNodeB ID or 0 if the buffer is too small.
+      static size_t global_enodeb_id_fqdn( char *buf, size_t len, const char *enb, const PlmnSuffix &plmn );
+      /// @brief Constructs the local home network identifier in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param lhn local home network.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the local home network identifier or 0 if the buffer is too small.
+      static size_t local_homenetwork_fqdn( char *buf, size_t len, const char *lhn, const PlmnSuffix &plmn );
+      /// @brief Constructs the home network realm/domain name in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the home network realm/domain name or 0 if the buffer is too small.
+      static size_t epc( char *buf, size_t len, const PlmnSuffix &plmn );
+      /// @brief Constructs the APN FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param apn the APN.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the APN FQDN or 0 if the buffer is too small.
+      static size_t apn_fqdn( char *buf, size_t len, const char *apn, const PlmnSuffix &plmn );
+      /// @brief Constructs the APN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param apn the APN.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the APN or 0 if the buffer is too small.
+      static size_t apn( char *buf, size_t len, const char *apn, const PlmnSuffix &plmn );
+      /// @brief Constructs the Diameter FQDN in a caller supplied buffer.
+      /// @param buf the buffer to write the NULL terminated result to.
+      /// @param len the length of the buffer.
+      /// @param plmn the precomputed PLMN suffixes.
+      /// @return the length of the Diameter FQDN or 0 if the buffer is too small.
+      static size_t diameter_fqdn( char *buf, size_t len, const PlmnSuffix &plmn );
+
    private:
       Utility() {}
    };
@@ -901,6 +1135,41 @@ namespace EPCDNS
    /////////////////////////////////////////////////////////////////////////////
    /////////////////////////////////////////////////////////////////////////////
 
+   /// @brief Iterates over a StringVector starting at a random position.
+   /// @details Allows a shared StringVector (see NodeSelectorResultCache) to be
+   ///   spread across callers without shuffling or copying the vector.
+   class StringVectorRandomIterator
+   {
+   public:
+      /// @brief Class constructor.
+      /// @param sv the StringVector to iterate over.
+      StringVectorRandomIterator( const StringVector &sv )
+         : m_sv( sv ),
+           m_start( sv.empty() ? 0 : rand() % sv.size() ),
+           m_cnt( 0 )
+      {
+      }
+
+      /// @brief Determines if there are more entries to retrieve.
+      /// @return True if there are more entries, otherwise False.
+      Bool hasNext() const { return m_cnt < m_sv.size(); }
+      /// @brief Retrieves the next entry.
+      /// @return the next entry.
+      const std::string &next() { return m_sv[ (m_start + m_cnt++) % m_sv.size() ]; }
+      /// @brief Restarts the iteration at the original random position.
+      Void reset() { m_cnt = 0; }
+
+   private:
+      StringVectorRandomIterator();
+
+      const StringVector &m_sv;
+      size_t m_start;
+      size_t m_cnt;
+   };
+
+   /////////////////////////////////////////////////////////////////////////////
+   /////////////////////////////////////////////////////////////////////////////
+
    /// @brief Application protocol object.
    class AppProtocol
    {
@@ -1225,6 +1494,73 @@ namespace EPCDNS
       static Bool sort_compare( NodeSelectorResult*& first, NodeSelectorResult*& second );
    };
 
+   /// @brief A typedef to std::shared_ptr<NodeSelectorResultList>.
+   typedef std::shared_ptr<NodeSelectorResultList> NodeSelectorResultListPtr;
+
+   /////////////////////////////////////////////////////////////////////////////
+   /////////////////////////////////////////////////////////////////////////////
+
+   /// @brief Caches node selector results keyed by the selection criteria.
+   /// @details An entry is only reused while the DNS query it was built from
+   ///   is still the one held by the DNS::Cache, so an entry is implicitly
+   ///   invalidated when the DNS::Cache replaces (refreshes) the query.
+   ///   The number of entries is limited.  When the cache is full, entries
+   ///   built from expired DNS queries are removed first and then the least
+   ///   recently used entry is evicted.  Cached result lists are shared
+   ///   between NodeSelector objects and must not be modified.
+   class NodeSelectorResultCache
+   {
+   public:
+      /// @brief Retrieves the NodeSelectorResultCache instance.
+      /// @return a reference to the NodeSelectorResultCache object.
+      static NodeSelectorResultCache &getInstance();
+
+      /// @brief Searches for the results associated with the selection criteria.
+      /// @param hash the hash of the selection criteria key.
+      /// @param key the selection criteria key.
+      /// @param query the current DNS query for the selection criteria domain.
+      /// @return the cached results or an empty pointer if not found or stale.
+      NodeSelectorResultListPtr lookup( ULong hash, const EString &key, const DNS::QueryPtr &query );
+      /// @brief Adds/replaces the results associated with the selection criteria.
+      /// @param hash the hash of the selection criteria key.
+      /// @param key the selection criteria key.
+      /// @param query the DNS query the results were built from.
+      /// @param results the node selector results.
+      Void update( ULong hash, const EString &key, const DNS::QueryPtr &query, const NodeSelectorResultListPtr &results );
+
+      /// @brief Removes all entries from the cache.
+      Void clear();
+      /// @brief Retrieves the number of entries in the cache.
+      /// @return the number of entries in the cache.
+      size_t size();
+
+      /// @brief Retrieves the maximum number of entries in the cache.
+      /// @return the maximum number of entries in the cache.
+      size_t getMaxEntries() { return m_maxentries; }
+      /// @brief Assigns the maximum number of entries in the cache.
+      /// @details Existing entries are evicted as new entries are added.
+      /// @param maxentries the maximum number of entries (minimum 1).
+      /// @return the maximum number of entries in the cache.
+      size_t setMaxEntries( size_t maxentries ) { return m_maxentries = maxentries ? maxentries : 1; }
+
+   private:
+      struct Entry
+      {
+         EString key;
+         DNS::QueryPtr query;
+         NodeSelectorResultListPtr results;
+         std::atomic<ULongLong> used;
+      };
+
+      NodeSelectorResultCache() : m_maxentries( 1024 ), m_clock( 0 ) {}
+      Void evict();
+
+      ERWLock m_lock;
+      std::unordered_map<ULong,Entry> m_entries;
+      size_t m_maxentries;
+      std::atomic<ULongLong> m_clock;
+   };
+
    /////////////////////////////////////////////////////////////////////////////
    /////////////////////////////////////////////////////////////////////////////
 
@@ -1254,7 +1590,20 @@ namespace EPCDNS
       const EString &getDomainName() { return m_domain; }
       /// @brief Retrieves the node selector results list.
       /// @return the node selector results list.
-      NodeSelectorResultList &getResults() { return m_results; }
+      NodeSelectorResultList &getResults() { return *m_results; }
+      /// @brief Retrieves the shared pointer to the node selector results list.
+      /// @return the shared pointer to the node selector results list.
+      NodeSelectorResultListPtr getResultsPtr() { return m_results; }
+
+      /// @brief Retrieves the result caching indicator.
+      /// @return True if the results are cached in the NodeSelectorResultCache, otherwise False.
+      Bool getCacheResults() { return m_cacheresults; }
+      /// @brief Assigns the result caching indicator.
+      /// @details When enabled, the results are shared with other node selectors
+      ///   that have identical selection criteria and must not be modified.
+      /// @param cacheresults the result caching indicator.
+      /// @return the result caching indicator.
+      Bool setCacheResults( Bool cacheresults ) { return m_cacheresults = cacheresults; }
    
       /// @brief Adds a desired usage type to the list of desired usage types.
       /// @param ut the usage type to add.
@@ -1290,7 +1639,7 @@ namespace EPCDNS
          std::cout << "  desired network capabilities" << std::endl;
          m_desiredNetworkCapabilities.dump( "    " );
          std::cout << "  results" << std::endl;
-         m_results.dump( "    " );
+         m_results->dump( "    " );
       }
    
    protected:
@@ -1315,6 +1664,8 @@ namespace EPCDNS
       AppServiceEnum parseService( const std::string &service, std::list<AppProtocolEnum> &protocols ) const;
       static Bool naptr_compare( DNS::RRecordNAPTR*& first, DNS::RRecordNAPTR*& second );
       NodeSelectorResultList &process(DNS::QueryPtr query, Bool cacheHit);
+      Void buildResults(NodeSelectorResultList &results);
+      EString getCriteriaKey();
       static Void async_callback(DNS::QueryPtr q, Bool cacheHit, const void *data);
  
       DNS::namedserverid_t m_nsid;
@@ -1324,7 +1675,9 @@ namespace EPCDNS
       UsageTypeList m_desiredUsageTypes;
       NetworkCapabilityList m_desiredNetworkCapabilities;
 
-      NodeSelectorResultList m_results;
+      NodeSelectorResultListPtr m_results;
+      Bool m_cacheresults;
+      Bool m_sharedresults;
       DNS::QueryPtr m_query;
       AsyncNodeSelectorCallback m_asynccb;
       pVoid m_asyncdata;
@@ -1354,6 +1707,13 @@ namespace EPCDNS
       /// @param candidate1 the first candidate.
       /// @param candidate2 the second candidate.
       ColocatedCandidate( NodeSelectorResult &candidate1, NodeSelectorResult &candidate2 );
+      /// @brief Class constructor.
+      /// @param candidate1 the first candidate.
+      /// @param candidate2 the second candidate.
+      /// @param cnn1 the parsed canonical node name of the first candidate.
+      /// @param cnn2 the parsed canonical node name of the second candidate.
+      ColocatedCandidate( NodeSelectorResult &candidate1, NodeSelectorResult &candidate2,
+                          const CanonicalNodeName &cnn1, const CanonicalNodeName &cnn2 );
 
       /// @brief Retrieves the first candidate node selector result object.
       /// @return the first candidate node selector result object.
@@ -1394,6 +1754,7 @@ namespace EPCDNS
 
    private:
       ColocatedCandidate();
+      Void classify();
 
       NodeSelectorResult &m_candidate1;
       NodeSelectorResult &m_candidate2;
@@ -1438,8 +1799,6 @@ namespace EPCDNS
    private:
       ColocatedCandidateList();
 
-      static Bool sort_compare( ColocatedCandidate*& first, ColocatedCandidate*& second );
-
       NodeSelectorResultList &m_nodelist1;
       NodeSelectorResultList &m_nodelist2;
    };
@@ -1447,6 +1806,52 @@ namespace EPCDNS
    /////////////////////////////////////////////////////////////////////////////
    /////////////////////////////////////////////////////////////////////////////
 
+   /// @brief Produces colocated candidates in priority order on demand.
+   /// @details The candidates are produced in the same order as the
+   ///   ColocatedCandidateList, but without creating (or sorting) every pair.
+   ///   The canonical node names are parsed once per node and the nodes in
+   ///   the second list are grouped by canonical node name so that colocated
+   ///   pairs are found with a single lookup.
+   class ColocatedCandidateSelector
+   {
+   public:
+      /// @brief Class constructor.
+      /// @param nodelist1 the first list of node selection results.
+      /// @param nodelist2 the second list of node selection results.
+      ColocatedCandidateSelector( NodeSelectorResultList &nodelist1, NodeSelectorResultList &nodelist2 );
+
+      /// @brief Retrieves the next candidate.
+      /// @return the next candidate (to be deleted by the caller) or NULL if there are no more candidates.
+      ColocatedCandidate *next();
+      /// @brief Restarts the selection at the highest priority candidate.
+      Void reset();
+
+   private:
+      struct Node
+      {
+         NodeSelectorResult *nsr;
+         CanonicalNodeName cnn;
+         size_t index;
+         const std::vector<size_t> *colocated;
+      };
+
+      ColocatedCandidateSelector();
+
+      static Bool node_compare( const Node &first, const Node &second );
+      Bool nextPair( size_t &idx1, size_t &idx2 );
+
+      std::vector<Node> m_nodes1;
+      std::vector<Node> m_nodes2;
+      std::unordered_map<std::string,std::vector<size_t>> m_names2;
+      std::vector<size_t> m_topon2;
+      ColocatedCandidate::PairType m_pairtype;
+      size_t m_pos1;
+      size_t m_pos2;
+   };
+
+   /////////////////////////////////////////////////////////////////////////////
+   /////////////////////////////////////////////////////////////////////////////
+
    /// @brief A MME node selector.
    class MMENodeSelector : public NodeSelector
    {
@@ -2241,6 +2646,9 @@ namespace EPCDNS
    /////////////////////////////////////////////////////////////////////////////
    /////////////////////////////////////////////////////////////////////////////
 
+   class DiameterSelector;
+   extern "C" typedef Void(*AsyncDiameterSelectorCallback)(DiameterSelector &ds, cpVoid data);
+
    /// @brief Represents a Diameter selector.
    class DiameterSelector
    {
@@ -2248,6 +2656,14 @@ namespace EPCDNS
       /// @brief Default constructor.
       DiameterSelector();
 
+      /// @brief Retrieves the named server ID.
+      /// @return the named server ID.
+      DNS::namedserverid_t getNamedServerID() { return m_nsid; }
+      /// @brief Assigns the named server ID.
+      /// @param nsid the named server ID.
+      /// @return the named server ID.
+      DNS::namedserverid_t setNamedServerID(DNS::namedserverid_t nsid) { return m_nsid = nsid; }
+
       /// @brief Retrieves the realm.
       /// @return the realm.
       const EString &getRealm() { return m_realm; }
@@ -2281,16 +2697,47 @@ namespace EPCDNS
       /// @return the protocol type.
       DiameterProtocolEnum setProtocol( DiameterProtocolEnum proto ) { return m_protocol = proto; }
 
+      /// @brief Retrieves the Diameter NAPTR results list.
+      /// @return the Diameter NAPTR results list.
+      DiameterNaptrList &getResults() { return m_results; }
+
       /// @brief Performs the lookup of the Diameter hosts.
       DiameterNaptrList &process();
+      /// @brief Performs the asynchronous lookup of the Diameter hosts.
+      /// @details The NAPTR, SRV and A/AAAA queries are pipelined.  Any SRV or
+      ///   A/AAAA records not included in the additional section of a response
+      ///   are queried for as soon as that response arrives and the follow-up
+      ///   queries are performed in parallel.  The callback is called once
+      ///   all of the queries are complete.
+      /// @param data a void pointer that will be passed to the callback when complete.
+      /// @param cb a pointer to the callback function that will be called when the lookup is complete.
+      Void process(cpVoid data, AsyncDiameterSelectorCallback cb);
 
    private:
+      struct AsyncQuery;
+      typedef std::list<AsyncQuery*> AsyncQueryList;
+
+      Bool validate();
+      Void processNaptr( DNS::QueryPtr query, AsyncQueryList *followups );
+      Void processSrv( DiameterNaptrS &naptr, DNS::QueryPtr query, AsyncQueryList *followups );
+      Void addFollowup( AsyncQueryList *followups, ns_type rtype, const std::string &domain, DiameterNaptrS *naptr, DiameterHost *host );
+      Void beginAsyncQueries( AsyncQueryList &queries );
+      Void endAsyncQuery();
+      Void finalizeResults();
+      static Void async_callback( DNS::QueryPtr q, Bool cacheHit, const void *data );
+
+      DNS::namedserverid_t m_nsid;
       EString m_realm;
       DiameterApplicationEnum m_application;
       DiameterProtocolEnum m_protocol;
 
       DNS::QueryPtr m_query;
       DiameterNaptrList m_results;
+
+      EMutexPrivate m_mutex;
+      long m_pending;
+      AsyncDiameterSelectorCallback m_asynccb;
+      pVoid m_asyncdata;
    };
 
 } // namespace EPCDNS
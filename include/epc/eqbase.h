@@ -25,6 +25,7 @@
 #include "etimer.h"
 //#include "etq.h"
 #include "emsg.h"
+#include "eqstats.h"
 
 /// @file
 /// @brief Provides base class support for sending and receiving messages via a
@@ -34,7 +35,27 @@
 ///    allocated from the heap, can be accessed by any thread in the same
 ///    process, while the public queue, allocated from shared memory, can be
 ///    accessed from any process running on the same machine.  The EMessage class
-///    serializes/deserializes the data to/from the queue.
+///    serializes/deserializes the data directly to/from the queue buffer.
+///
+///    Each message is stored as a variable length record made up of one or
+///    more contiguous slots.  The record header carries the message type and
+///    length, so a message is decoded in place exactly once.  A writer
+///    reserves the slots while holding the write lock and serializes the
+///    message after releasing it, and the record is published by a single
+///    atomic store to the record state.
+///
+///    A public queue does not use any locks to push or pop a message.  Each
+///    slot has a sequence number that indicates whether the slot is free or
+///    holds a committed record for the current pass through the queue, and
+///    readers and writers claim records by advancing the shared read and write
+///    positions with compare and swap.  Blocked readers and writers wait on a
+///    futex.  Before advancing a position, the claiming process stores a
+///    token containing its process ID in the first slot of the record, so if
+///    a process dies after claiming a record the record is skipped by the
+///    other processes instead of blocking the queue.  A claim is never taken
+///    from a process that is still running, and a claim is never considered
+///    abandoned when the queue is shared by processes in different PID
+///    namespaces.
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -44,6 +65,7 @@ DECLARE_ERROR(EQueueBaseError_UnInitialized);
 DECLARE_ERROR(EQueueBaseError_NotOpenForWriting);
 DECLARE_ERROR(EQueueBaseError_NotOpenForReading);
 DECLARE_ERROR(EQueueBaseError_MultipleReadersNotAllowed);
+DECLARE_ERROR(EQueueBaseError_MessageTooLarge);
 /// @endcond
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -63,7 +85,7 @@ public:
    }
 
    /// @brief Class destructor.
-   ~EQueueMessage()
+   virtual ~EQueueMessage()
    {
    }
 
@@ -140,6 +162,7 @@ public:
    ///    in the queue before writing the data.
    /// @return True indicates that the message was successfully written, otherwise
    ///    there was insufficient space to write the message.
+   /// @throws EQueueBaseError_MessageTooLarge if the message is larger than the queue.
    Bool push(EQueueMessage &msg, Bool wait = True);
    /// @brief Retrieves the next message from the queue.
    /// @param wait indicates whether to wait for a message or to return immediately.
@@ -149,6 +172,15 @@ public:
    /// @brief Destroys the message queue.
    Void destroy();
 
+   /// @brief Retrieves the statistics for this queue object.
+   /// @details The statistics are collected in this process once
+   ///   EQueueStatistics::enable() has been called.  The queue depth is
+   ///   measured in slots and the residency is measured from the time
+   ///   push() stored the record, which is only recorded when the
+   ///   statistics are enabled in the writing process.
+   /// @return a reference to the statistics for this queue object.
+   EQueueStatistics &getStatistics() { return m_stats; }
+
 protected:
    /// @cond DOXYGEN_EXCLUDE
    virtual Bool isPublic() = 0;
@@ -162,7 +194,7 @@ protected:
    virtual Int &numWriters() = 0;
    virtual Int &refCnt() = 0;
    virtual pChar data() = 0;
-   virtual Void allocDataSpace(cpStr sFile, Char cId, Int nSize) = 0;
+   virtual Void allocDataSpace(cpStr sFile, Char cId, size_t nSize) = 0;
    virtual Void initReadMutex() = 0;
    virtual Void initWriteMutex() = 0;
    virtual Void initSemFree(UInt initialCount) = 0;
@@ -175,6 +207,23 @@ protected:
 
    virtual EQueueMessage *allocMessage(Long msgType) = 0;
 
+   typedef struct
+   {
+      ULongLong m_writePos;
+      Char m_pad1[64 - sizeof(ULongLong)];
+      ULongLong m_readPos;
+      Char m_pad2[64 - sizeof(ULongLong)];
+      Int m_msgsFutex;
+      Int m_msgsWaiters;
+      Int m_freeFutex;
+      Int m_freeWaiters;
+      ULongLong m_pidNamespace;
+      Int m_mixedNamespaces;
+   } equeuering_t;
+
+   virtual Bool isLockFree() { return False; }
+   virtual equeuering_t *ring() { return NULL; }
+
    Mode mode() { return m_mode; }
 
    EQueueBase();
@@ -185,10 +234,85 @@ protected:
    /// @endcond
 
 private:
+   enum RecordState
+   {
+      RecordFree = 0,
+      RecordCommitted = 1,
+      RecordPadding = 2
+   };
+
+   typedef struct
+   {
+      Int m_state;
+      Int m_slots;
+      ULong m_length;
+      Long m_msgType;
+      epctime_t m_enqueued; // zero unless the writer collects statistics
+   } equeuerecord_t;
+
+   equeuerecord_t *record(Long slot) { return (equeuerecord_t *)&data()[(size_t)slot * msgSize()]; }
+   static pChar recordData(equeuerecord_t *rec) { return (pChar)(rec + 1); }
+   static Void commit(equeuerecord_t *rec, RecordState state) { __atomic_store_n(&rec->m_state, state, __ATOMIC_RELEASE); }
+
+   Bool reserve(Int nSlots, Bool wait);
+   Void release(equeuerecord_t *rec);
+
+   // the lock free queue keeps the slot state separate from the data so
+   // that a record can span multiple slots
+   typedef struct
+   {
+      ULongLong m_seq;
+      ULongLong m_owner; // claim token of the first slot of a record
+      ULongLong m_writerPos; // position of the first slot of the record
+      Int m_slots;
+      Int m_state;
+      ULong m_length;
+      Long m_msgType;
+      epctime_t m_enqueued; // zero unless the writer collects statistics
+   } equeueslot_t;
+
+   // milliseconds between checks for a dead process while waiting
+   static const Int RingRecoveryInterval = 100;
+   // retries on a claim that is being taken before checking if its owner is running
+   static const Int RingOwnerSpins = 1000;
+
+   // a claim token holds the process ID, the claim role and the low bits
+   // of the position of the record, zero indicates that there is no claim
+   static const ULongLong RingTokenReader = 0x80000000ULL;
+   static const ULongLong RingTokenPosMask = 0x7fffffffULL;
+   static ULongLong claimToken(Int pid, Bool reader, ULongLong pos)
+   {
+      return ((ULongLong)(UInt)pid << 32) | (reader ? RingTokenReader : 0) | (pos & RingTokenPosMask);
+   }
+   static Bool tokenMatches(ULongLong token, ULongLong pos) { return token != 0 && (token & RingTokenPosMask) == (pos & RingTokenPosMask); }
+   static Bool tokenReader(ULongLong token) { return (token & RingTokenReader) != 0; }
+
+   equeueslot_t *ringSlot(ULongLong pos) { return &((equeueslot_t *)data())[pos % msgCnt()]; }
+   pChar ringData(ULongLong pos) { return &data()[(size_t)msgCnt() * sizeof(equeueslot_t) + (size_t)(pos % msgCnt()) * msgSize()]; }
+
+   static Bool commitRing(equeueslot_t *s, ULongLong pos)
+   {
+      ULongLong expected = pos;
+      return __atomic_compare_exchange_n(&s->m_seq, &expected, pos + 1, False, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+   }
+
+   Void initRing();
+   Bool pushRing(EQueueMessage &msg, Bool wait);
+   EQueueMessage *popRing(Bool wait);
+   Void releaseRing(ULongLong pos, Int nSlots, Bool committed);
+   Bool recoverReader(ULongLong pos);
+   Bool ownerGone(ULongLong token);
+   Void openRing();
+   Bool waitRing(Int &futex, Int &waiters, Int expected);
+   Void signalRing(Int &futex, Int &waiters, Int count);
+
+   // the enqueue time is kept in the record so the message is not changed
+   epctime_t enqueueTime() { return m_stats.isEnabled() ? (epctime_t)ETimer() : 0; }
+   Void recordResidency(epctime_t enqueued);
+
    Bool m_initialized;
    Mode m_mode;
-   Char m_rBuffer[USHRT_MAX];
-   Char m_wBuffer[USHRT_MAX];
+   EQueueStatistics m_stats;
 };
 
 #endif // #define __eqbase_h_included
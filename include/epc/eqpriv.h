@@ -59,7 +59,7 @@ protected:
    Int &refCnt();
    pChar data();
    Int ctrlSize();
-   Void allocDataSpace(cpStr sFile, Char cId, Int nSize);
+   Void allocDataSpace(cpStr sFile, Char cId, size_t nSize);
    Void initReadMutex();
    Void initWriteMutex();
    Void initSemFree(UInt initialCount);
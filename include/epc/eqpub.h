@@ -46,6 +46,8 @@ public:
 protected:
    /// @cond DOXYGEN_EXCLUDE
    Bool isPublic() { return True; }
+   Bool isLockFree() { return True; }
+   equeuering_t *ring() { return &m_pCtrl->m_ring; }
    ULong &msgSize();
    Int &msgCnt();
    Long &msgHead();
@@ -57,7 +59,7 @@ protected:
    Int &refCnt();
    pChar data();
    Int ctrlSize();
-   Void allocDataSpace(cpStr sFile, Char cId, Int nSize);
+   Void allocDataSpace(cpStr sFile, Char cId, size_t nSize);
    Void initReadMutex();
    Void initWriteMutex();
    Void initSemFree(UInt initialCount);
@@ -94,6 +96,7 @@ private:
       Int m_wmutexid;
       Int m_semfreeid;
       Int m_semmsgsid;
+      equeuering_t m_ring;
    } esharedqueue_ctrl_t;
 
    Int &readMutexId() { return m_pCtrl->m_rmutexid; }
@@ -0,0 +1,169 @@
+/*
+* Copyright (c) 2020 Sprint
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __EQSTATS_H
+#define __EQSTATS_H
+
+/// @file
+/// @brief Defines the statistics that can be collected for a message queue
+///   or a thread event queue.
+
+#include <atomic>
+#include <list>
+
+#include "ebase.h"
+#include "egetopt.h"
+#include "ehistogram.h"
+#include "estring.h"
+#include "esynch.h"
+
+/// @brief Statistics collected by a message queue or thread event queue.
+/// @details Collection is disabled until enable() is called.  Once enabled,
+///   the queue records the time each message spent in the queue, the highest
+///   observed queue depth, the time writers were blocked waiting for free
+///   space and the time the reader was idle waiting for a message.  All
+///   values are updated and read without locks, so the statistics can be
+///   retrieved at any time by a management handler.  The statistics describe
+///   the activity observed by the queue object in the current process.
+class EQueueStatistics
+{
+public:
+   /// @brief Default constructor.
+   EQueueStatistics();
+   /// @brief Class destructor.
+   ~EQueueStatistics();
+
+   /// @brief Enables collection and registers the statistics.
+   /// @param name the name reported for the queue.
+   Void enable(cpStr name);
+   /// @brief Disables collection and unregisters the statistics.
+   Void disable();
+   /// @brief Indicates if collection has been enabled.
+   /// @return True if collection has been enabled, otherwise False.
+   Bool isEnabled() const { return m_enabled.load(std::memory_order_acquire); }
+   /// @brief Retrieves the name reported for the queue.
+   /// @return the name reported for the queue.
+   const EString &getName() const { return m_name; }
+
+   /// @brief Records messages that were added to the queue.
+   /// @param depth the number of messages, or slots for a variable length
+   ///   record queue, in use after the push.
+   /// @param count the number of messages that were added.
+   Void recordPush(ULongLong depth, ULongLong count = 1)
+   {
+      m_pushes.fetch_add(count, std::memory_order_relaxed);
+      ULongLong hw = m_highWater.load(std::memory_order_relaxed);
+      while (depth > hw && !m_highWater.compare_exchange_weak(hw, depth, std::memory_order_relaxed))
+         ;
+   }
+   /// @brief Records a message that was removed from the queue.
+   /// @param residency the number of microseconds the message was in the queue.
+   Void recordPop(ULongLong residency)
+   {
+      m_pops.fetch_add(1, std::memory_order_relaxed);
+      m_residency.record(residency);
+   }
+   /// @brief Records the time a writer waited for free space.
+   /// @param usec the number of microseconds the writer waited.
+   Void recordBlocked(ULongLong usec)
+   {
+      m_blockedCount.fetch_add(1, std::memory_order_relaxed);
+      m_blockedTime.fetch_add(usec, std::memory_order_relaxed);
+   }
+   /// @brief Records the time the reader waited for a message.
+   /// @param usec the number of microseconds the reader waited.
+   Void recordIdle(ULongLong usec)
+   {
+      m_idleCount.fetch_add(1, std::memory_order_relaxed);
+      m_idleTime.fetch_add(usec, std::memory_order_relaxed);
+   }
+
+   /// @brief Retrieves the number of messages added to the queue.
+   /// @return the number of messages added to the queue.
+   ULongLong getPushes() const { return m_pushes.load(std::memory_order_relaxed); }
+   /// @brief Retrieves the number of messages removed from the queue.
+   /// @return the number of messages removed from the queue.
+   ULongLong getPops() const { return m_pops.load(std::memory_order_relaxed); }
+   /// @brief Retrieves the highest queue depth observed after a push.
+   /// @return the highest queue depth observed after a push.
+   ULongLong getHighWater() const { return m_highWater.load(std::memory_order_relaxed); }
+   /// @brief Retrieves the number of times a writer waited for free space.
+   /// @return the number of times a writer waited for free space.
+   ULongLong getBlockedCount() const { return m_blockedCount.load(std::memory_order_relaxed); }
+   /// @brief Retrieves the total microseconds writers waited for free space.
+   /// @return the total microseconds writers waited for free space.
+   ULongLong getBlockedTime() const { return m_blockedTime.load(std::memory_order_relaxed); }
+   /// @brief Retrieves the number of times the reader waited for a message.
+   /// @return the number of times the reader waited for a message.
+   ULongLong getIdleCount() const { return m_idleCount.load(std::memory_order_relaxed); }
+   /// @brief Retrieves the total microseconds the reader waited for a message.
+   /// @return the total microseconds the reader waited for a message.
+   ULongLong getIdleTime() const { return m_idleTime.load(std::memory_order_relaxed); }
+   /// @brief Retrieves the queue residency histogram in microseconds.
+   /// @return the queue residency histogram in microseconds.
+   const EHistogram &getResidency() const { return m_residency; }
+
+   /// @brief Resets all of the statistics to zero.
+   /// @details The name and the collection setting are not changed.  Each
+   ///   value is cleared separately, so a value recorded by another thread
+   ///   while the reset is in progress may be retained.
+   Void reset();
+
+   /// @brief Serializes the statistics as a JSON object.
+   /// @param json updated with the JSON representation of the statistics.
+   /// @return a reference to the json parameter.
+   EString &toJson(EString &json) const;
+   /// @brief Serializes the statistics for all enabled queues as a JSON array.
+   /// @details Intended to be returned by an application supplied
+   ///   EManagementHandler.
+   /// @param json updated with the JSON representation of the statistics.
+   /// @return a reference to the json parameter.
+   static EString &getMetricsJson(EString &json);
+
+   /// @brief Loads the default collection setting from the configuration.
+   /// @param options the configuration options.
+   static Void loadDefaults(EGetOpt &options);
+   /// @brief Assigns the default collection setting.
+   /// @details When True, every queue enables collection when it is
+   ///   initialized.
+   /// @param enabled the default collection setting.
+   static Void setDefaultEnabled(Bool enabled) { m_defaultEnabled = enabled; }
+   /// @brief Retrieves the default collection setting.
+   /// @return the default collection setting.
+   static Bool getDefaultEnabled() { return m_defaultEnabled; }
+
+private:
+   EQueueStatistics(const EQueueStatistics &);
+   EQueueStatistics &operator=(const EQueueStatistics &);
+
+   std::atomic<Bool> m_enabled;
+   EString m_name;
+
+   std::atomic<ULongLong> m_pushes;
+   std::atomic<ULongLong> m_pops;
+   std::atomic<ULongLong> m_highWater;
+   std::atomic<ULongLong> m_blockedCount;
+   std::atomic<ULongLong> m_blockedTime;
+   std::atomic<ULongLong> m_idleCount;
+   std::atomic<ULongLong> m_idleTime;
+   EHistogram m_residency;
+
+   static Bool m_defaultEnabled;
+   static ERWLock m_lock;
+   static std::list<EQueueStatistics *> m_registry;
+};
+
+#endif // #ifndef __EQSTATS_H
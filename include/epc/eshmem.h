@@ -22,6 +22,7 @@
 /// @brief Defines a class for access to shared memory.
 
 #include "esynch.h"
+#include "egetopt.h"
 
 /// @cond DOXYGEN_EXCLUDE
 DECLARE_ERROR(ESharedMemoryError_NotInitialized);
@@ -34,22 +35,46 @@ public:
    ESharedMemoryError_UnableToCreateKeyFile(cpStr pszFile);
    virtual const cpStr Name() const { return "ESharedMemoryError_UnableToCreateKeyFile"; }
 };
+
+class ESharedMemoryError_PathTooLong : public EError
+{
+public:
+   ESharedMemoryError_PathTooLong(cpStr pszDir, cpStr pszName);
+   virtual const cpStr Name() const { return "ESharedMemoryError_PathTooLong"; }
+};
 /// @endcond
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
 /// @brief The shared memory access class.
+/// @details The shared memory can be allocated from one of two backends.
+///   The System V backend (the default) uses ftok()/shmget()/shmat().  The
+///   POSIX backend uses shm_open() + mmap(), or a file on a hugetlbfs mount
+///   when huge pages are requested.  The backend, huge page, prefault and
+///   NUMA options are normally assigned from the "EpcTools/SharedMemory"
+///   configuration section by EpcTools::Initialize(), so every shared memory
+///   object created afterwards (public queues, public thread queues and the
+///   public synchronization objects) uses the same settings.
 class ESharedMemory
 {
 public:
+   /// @brief The shared memory backends.
+   enum Backend
+   {
+      /// System V shared memory (shmget/shmat)
+      SystemV,
+      /// POSIX shared memory (shm_open/mmap)
+      Posix
+   };
+
    /// @brief Default constructor.
    ESharedMemory();
    /// @brief Class constructor.
    /// @param file the file name associated with the shared memory.
    /// @param id the identifier for the shared memory.
    /// @param size the amount of memory to allocate for this shared memory object.
-   ESharedMemory(cpStr file, Int id, Int size);
+   ESharedMemory(cpStr file, Int id, size_t size);
    /// @brief Class destructor.
    ~ESharedMemory();
 
@@ -58,7 +83,10 @@ public:
    /// @param file the file name associated with the shared memory.
    /// @param id the identifier for the shared memory.
    /// @param size the amount of memory to allocate for this shared memory object.
-   Void init(cpStr file, Int id, Int size);
+   Void init(cpStr file, Int id, size_t size);
+   /// @brief Detaches from the shared memory.  The shared memory is removed
+   ///   if there are no other clients.  This method is called by the destructor.
+   Void detach();
 
    /// @brief Retrieves a pointer to the first location of the shated memory.
    /// @return a pointer to the first location of the shated memory.
@@ -74,6 +102,51 @@ public:
 
    /// @brief Retrieves the number of clients accessing the shared memory.
    Int getUsageCount();
+   /// @brief Adds a reference that keeps the shared memory from being removed
+   ///   when the last client detaches.
+   Void incUsageCount();
+   /// @brief Removes a reference added by incUsageCount().
+   /// @details The reference held by this object is not removed, so the
+   ///   shared memory is removed when this object is destroyed if there are
+   ///   no other clients.
+   Void decUsageCount();
+
+   /// @brief Assigns the backend used by this object.  Must be called before init().
+   /// @param v the backend.
+   /// @return a reference to this object.
+   ESharedMemory &setBackend(Backend v) { m_backend = v; return *this; }
+   /// @brief Requests that the shared memory be allocated from huge pages.  Must be called before init().
+   /// @param v True to use huge pages, otherwise False.
+   /// @return a reference to this object.
+   ESharedMemory &setHugePages(Bool v) { m_hugePages = v; return *this; }
+   /// @brief Requests that the pages be faulted in when the shared memory is mapped.  Must be called before init().
+   /// @param v True to prefault the pages, otherwise False.
+   /// @return a reference to this object.
+   ESharedMemory &setPopulate(Bool v) { m_populate = v; return *this; }
+   /// @brief Assigns the preferred NUMA node for the shared memory.  Must be called before init().
+   /// @param v the NUMA node or -1 for no preference.
+   /// @return a reference to this object.
+   ESharedMemory &setNumaNode(Int v) { m_numaNode = v; return *this; }
+
+   /// @brief Retrieves the backend used by this object.
+   /// @return the backend.
+   Backend getBackend() { return m_backend; }
+   /// @brief Retrieves the size of the mapping, including the control block.
+   /// @return the size of the mapping.
+   size_t getMappedSize() { return m_size; }
+
+   /// @brief Loads the default options from the "SharedMemory" section of the configuration.
+   /// @param options the configuration options.
+   static Void loadDefaults(EGetOpt &options);
+   /// @brief Assigns the default options used by shared memory objects created after this call.
+   /// @param backend the backend.
+   /// @param hugePages True to use huge pages, otherwise False.
+   /// @param populate True to prefault the pages, otherwise False.
+   /// @param numaNode the preferred NUMA node or -1 for no preference.
+   static Void setDefaults(Backend backend, Bool hugePages = False, Bool populate = False, Int numaNode = -1);
+   /// @brief Assigns the hugetlbfs mount point used by the POSIX backend for huge pages.
+   /// @param dir the hugetlbfs mount point.
+   static Void setHugePageDirectory(cpStr dir) { m_hugePageDir = dir; }
 
 private:
    typedef struct
@@ -87,14 +160,32 @@ private:
       return m_pCtrl->s_mutex;
    }
 
+   Void initSystemV(cpStr file, Int id);
+   Void initPosix();
+   Void applyPolicy();
+   static size_t getHugePageSize();
+
    Char m_szShMem[EPC_FILENAME_MAX + 1];
    Char m_szMutex[EPC_FILENAME_MAX + 1];
+   Char m_szPath[EPC_FILENAME_MAX + 1];
    pVoid m_pShMem;
    pVoid m_pData;
    eshmemctrl_t *m_pCtrl;
 
    Int m_shmid;
    key_t m_key;
+
+   Backend m_backend;
+   Bool m_hugePages;
+   Bool m_populate;
+   Int m_numaNode;
+   size_t m_size;
+
+   static Backend m_defaultBackend;
+   static Bool m_defaultHugePages;
+   static Bool m_defaultPopulate;
+   static Int m_defaultNumaNode;
+   static EString m_hugePageDir;
 };
 
 #endif // #define __eshmem_h_included
@@ -1453,15 +1453,8 @@ namespace ESocket
       /// @brief Default constructor.
       Thread()
       {
-         int *pipefd = this->getBumpPipe();
-
          m_error = 0;
 
-         int result = pipe(pipefd);
-         if (result == -1)
-            throw ThreadError_UnableToOpenPipe();
-         fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
-
          FD_ZERO(&m_master);
 
          getMaxFileDescriptor(True);
@@ -1503,7 +1496,7 @@ namespace ESocket
          {
             {
                memcpy(&readworking, &m_master, sizeof(m_master));
-               FD_SET(this->getBumpPipe()[0], &readworking);
+               FD_SET(m_bump.getHandle(), &readworking);
 
                FD_ZERO(&writeworking);
                for (auto it = m_socketmap.begin(); it != m_socketmap.end(); it++)
@@ -1541,7 +1534,7 @@ namespace ESocket
             ////////////////////////////////////////////////////////////////////////
             // Process any thread messages
             ////////////////////////////////////////////////////////////////////////
-            if (FD_ISSET(this->getBumpPipe()[0], &readworking))
+            if (FD_ISSET(m_bump.getHandle(), &readworking))
             {
                --fdcnt;
                if (!pumpMessagesInternal())
@@ -1598,12 +1591,14 @@ namespace ESocket
 
             ////////////////////////////////////////////////////////////////////////
             // Process any thread messages that may have been posted while
-            //   processing the socket events
+            //   processing the socket events, the bump is cleared first so
+            //   that a message posted after the messages are pumped will
+            //   bump the thread again
             ////////////////////////////////////////////////////////////////////////
+            clearBump();
+
             if (!pumpMessagesInternal())
                break;
-
-            clearBump();
          }
 
          while (true)
@@ -1644,22 +1639,12 @@ namespace ESocket
 
       Void bump()
       {
-         if (write(this->getBumpPipe()[1], "~", 1) == -1)
-            throw ThreadError_UnableToWritePipe();
+         m_bump.signal();
       }
       
       Void clearBump()
       {
-         char buf[1];
-         while (true)
-         {
-            if (read(this->getBumpPipe()[0], buf, 1) == -1)
-            {
-               if (errno == EWOULDBLOCK)
-                  break;
-               throw ThreadError_UnableToReadPipe();
-            }
-         }
+         m_bump.reset();
       }
 
       virtual const typename EThreadEvent<TQueue,TMessage>::msgmap_t *GetMessageMap() const
@@ -1892,7 +1877,7 @@ namespace ESocket
       {
          if (calc)
          {
-            m_maxfd = this->getBumpPipe()[0];
+            m_maxfd = m_bump.getHandle();
             
             for (auto entry : m_socketmap)
                if (entry.second->getHandle() > m_maxfd)
@@ -1906,6 +1891,7 @@ namespace ESocket
       std::unordered_map<Int,Base<TQueue,TMessage>*> m_socketmap;
       fd_set m_master;
       Int m_maxfd;
+      EEventFd m_bump;
    };
 
    typedef Base<EThreadQueuePublic<EThreadMessage>,EThreadMessage> BasePublic;
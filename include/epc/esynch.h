@@ -53,6 +53,13 @@ DECLARE_ERROR(ESemaphoreError_AlreadyAllocated);
 DECLARE_ERROR(ESemaphoreError_NotInitialized);
 DECLARE_ERROR(ESemaphoreError_AlreadyInitialized);
 DECLARE_ERROR(ESemaphoreError_MaxNotifyIdsExceeded);
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+DECLARE_ERROR_ADVANCED(EEventFdError_UnableToCreate);
+DECLARE_ERROR_ADVANCED(EEventFdError_UnableToRead);
+DECLARE_ERROR_ADVANCED(EEventFdError_UnableToWrite);
 /// @endcond
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -300,11 +307,19 @@ public:
    /// @brief Decrements the semaphore.
    /// @param wait if True, this method will block until the semaphore can be
    ///   decremented (when the current value is less than or equal to zeor).  
+   ///   If False, the current value is left unchanged when it is not
+   ///   greater than zero.
    /// @return True if the semaphore was successfully decremented, otherwise False.
    Bool Decrement(Bool wait = True);
    /// @brief Increments teh semaphore.
    /// @return True indicates that the semaphore was successfully incremented, otherwise False.
    Bool Increment();
+   /// @brief Increments the semaphore by the specified amount.
+   /// @details The count is added with a single atomic operation, any
+   ///   waiting threads that can be released are then posted.
+   /// @param count the amount to increment the semaphore by.
+   /// @return True indicates that the semaphore was successfully incremented, otherwise False.
+   Bool Increment(Long count);
 
    /// @brief Retrieves the initialization status.
    /// @return True indicates the semahpore data has been initialized, otherwise False.
@@ -349,6 +364,10 @@ public:
    /// @brief Increments the semaphore value.
    /// @return True indicates that the semaphore value was successfully decremented, otherwise False.
    Bool Increment() { return getData().Increment(); }
+   /// @brief Increments the semaphore value by the specified amount.
+   /// @param count the amount to increment the semaphore by.
+   /// @return True indicates that the semaphore value was successfully incremented, otherwise False.
+   Bool Increment(Long count) { return getData().Increment(count); }
 
    /// @brief Indicates the initialization status for this object.
    /// @return True indicates the object is initialized, otherwise False.
@@ -612,6 +631,54 @@ private:
 //////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////
 
+/// @brief A wake up object backed by a Linux eventfd.
+/// @details The eventfd counter is incremented when the object is signaled
+///   and is cleared when the object is reset, so the file descriptor can be
+///   monitored with select() or poll().  Signaling an object that has already
+///   been signaled, and not yet reset, does not write to the eventfd, so a
+///   producer that outruns the consumer does not make a system call for each
+///   signal.
+class EEventFd
+{
+public:
+   /// @brief Default constructor.
+   /// @throws EEventFdError_UnableToCreate if the eventfd cannot be created.
+   EEventFd();
+   /// @brief Class destructor.
+   ~EEventFd();
+
+   /// @brief Signals the object.
+   /// @return True if the eventfd was written, False if the object was already signaled.
+   /// @throws EEventFdError_UnableToWrite if the eventfd cannot be written.
+   Bool signal();
+   /// @brief Resets the object.
+   /// @details The eventfd is read before the signaled indication is cleared.
+   ///   A signal that occurs during the reset may not write to the eventfd,
+   ///   so the consumer must reset the object before processing the work it
+   ///   was signaled for, which then includes the work of that signal.
+   /// @return the value of the eventfd counter that was cleared.
+   /// @throws EEventFdError_UnableToRead if the eventfd cannot be read.
+   ULongLong reset();
+   /// @brief Waits for the object to be signaled.
+   /// @param ms if -1, this function waits indefinitely, otherwise waits the
+   ///   specified number of milli-seconds for the object to be signaled.
+   /// @return True if the object has been signaled, otherwise False.
+   Bool wait(Int ms = -1);
+   /// @brief Retrieves the eventfd file descriptor.
+   /// @return the eventfd file descriptor.
+   Int getHandle() { return m_fd; }
+
+private:
+   EEventFd(const EEventFd &);
+   EEventFd &operator=(const EEventFd &);
+
+   Int m_fd;
+   Int m_signaled;
+};
+
+//////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////
+
 /// @brief An object that can be waited on to be set in another thread.
 class EEvent
 {
@@ -636,10 +703,34 @@ public:
    Bool isSet() { return wait(0); }
 
 private:
-   void closepipe();
+   EEventFd m_event;
+};
 
-   int m_pipefd[2];
-   char m_buf[1];
+//////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Wraps the Linux futex system call.
+/// @details A futex is a 32-bit integer that can be waited on until another
+///   thread, or another process when the integer is stored in shared memory,
+///   changes its value and wakes the waiters.  The caller owns the protocol
+///   used to update the integer; these functions only block and wake.
+class EFutex
+{
+public:
+   /// @brief Waits for the futex to be woken.
+   /// @param word the futex integer.
+   /// @param expected the value the futex integer is expected to contain.
+   ///   If the futex integer contains a different value, this function
+   ///   returns immediately.
+   /// @param ms if -1, this function waits indefinitely, otherwise waits the
+   ///   specified number of milli-seconds to be woken.
+   /// @return False if the wait timed out, otherwise True.
+   static Bool wait(Int &word, Int expected, Int ms = -1);
+   /// @brief Wakes threads that are waiting on the futex.
+   /// @param word the futex integer.
+   /// @param count the maximum number of waiting threads to wake.
+   /// @return the number of threads that were woken.
+   static Int wake(Int &word, Int count = 1);
 };
 
 //////////////////////////////////////////////////////////////////////////////////
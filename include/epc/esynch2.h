@@ -20,6 +20,9 @@
 
 /// @file
 
+#include <memory>
+#include <unordered_map>
+
 #include "esynch.h"
 #include "eshmem.h"
 #include "eatomic.h"
@@ -42,15 +45,24 @@ class ESynchObjects : public EStatic
 {
 /// @cond DOXYGEN_EXCLUDE
 public:
+   // the objects are stored in shared memory segments that are created
+   // as needed, the free list head holds a tag in the upper 32 bits and
+   // the index of the first free object in the lower 32 bits
    typedef struct
    {
       EMutexPrivate m_mutex;
       Int m_max;
-      Int m_head;
+      Int m_segSize;
+      Int m_segShift;
+      Int m_segments;
+      ULongLong m_head;
       Long m_currused;
       Long m_maxused;
    } _esynchcontrol_t;
 
+   /// the maximum number of shared memory segments for each object type
+   static const Int MaxSegments = 64;
+
    typedef struct
    {
       Bool m_initialized;
@@ -88,13 +100,8 @@ public:
 
    epublicqueuedef_t *getPublicQueue(Int queueid)
    {
-      for (int i = 0; m_pPubQueues[i].m_name[0] != 0; i++)
-      {
-         if (m_pPubQueues[i].m_queueid == queueid)
-            return &m_pPubQueues[i];
-      }
-
-      return NULL;
+      auto it = m_pubQueueIndex.find(queueid);
+      return it == m_pubQueueIndex.end() ? NULL : &m_pPubQueues[it->second];
    }
 
    Void setPublicQueue(Int idx, cpChar pName, Int queueid, Int msgSize,
@@ -106,6 +113,7 @@ public:
       m_pPubQueues[idx].m_msgCnt = msgCnt;
       m_pPubQueues[idx].m_multipleReaders = multipleReaders;
       m_pPubQueues[idx].m_multipleWriters = multipleWriters;
+      m_pubQueueIndex[queueid] = idx;
    }
 
    static ESynchObjects *getSynchObjCtrlPtr()
@@ -117,20 +125,65 @@ public:
 
    static ESemaphoreDataPublic &getSemaphore(Int ofs)
    {
-      if (ofs < 0)
+      if (ofs <= 0)
          throw ESynchObjectsError_InvalidOffset();
-      return getSynchObjCtrlPtr()->m_pSemaphores[ofs - 1];
+      return getSynchObjCtrlPtr()->m_semaphores.get(ofs - 1);
    }
 
    static EMutexDataPublic &getMutex(Int ofs)
    {
-      if (ofs < 0)
+      if (ofs <= 0)
          throw ESynchObjectsError_InvalidOffset();
-      return getSynchObjCtrlPtr()->m_pMutexes[ofs - 1];
+      return getSynchObjCtrlPtr()->m_mutexes.get(ofs - 1);
    }
 /// @endcond
 
 private:
+   // a table of public objects of one type, the segment pointers are
+   // local to the process, the existing segments are attached at init
+   // and a segment added by another process is attached the first time
+   // an object in the segment is referenced.  Each segment holds a
+   // reference for the control block, so a segment is only removed when
+   // the control block is destroyed.
+   template <class T>
+   class ESynchObjectTable
+   {
+   public:
+      ESynchObjectTable(cpStr name);
+
+      Void init(_esynchcontrol_t *pCtrl);
+      Void create(Int nObjects);
+      Void attachAll();
+      static Void destroy(cpStr name, _esynchcontrol_t *pCtrl);
+
+      Int allocate();
+      Void release(Int idx);
+
+      T &get(Int idx)
+      {
+         Int seg = idx >> m_pCtrl->m_segShift;
+         if (seg >= MaxSegments)
+            throw ESynchObjectsError_InvalidOffset();
+         pChar p = __atomic_load_n(&m_segments[seg], __ATOMIC_ACQUIRE);
+         if (!p)
+            p = attach(seg);
+         return ((T *)p)[idx & (m_pCtrl->m_segSize - 1)];
+      }
+
+   private:
+      pChar attach(Int seg);
+      Bool grow(ULongLong head);
+
+      static Int &objectId(ESemaphoreDataPublic &s) { return s.semIndex(); }
+      static Int &objectId(EMutexDataPublic &m) { return m.mutexId(); }
+
+      cpStr m_name;
+      _esynchcontrol_t *m_pCtrl;
+      EMutexPrivate m_attachMutex;
+      std::unique_ptr<ESharedMemory> m_shmem[MaxSegments];
+      pChar m_segments[MaxSegments];
+   };
+
    class ESynchObjectsSharedMemory : public ESharedMemory
    {
       friend class ESynchObjects;
@@ -145,9 +198,10 @@ private:
 
    ESynchObjectsSharedMemory m_sharedmem;
    esynchcontrol_t *m_pCtrl;
-   ESemaphoreDataPublic *m_pSemaphores;
-   EMutexDataPublic *m_pMutexes;
+   ESynchObjectTable<ESemaphoreDataPublic> m_semaphores;
+   ESynchObjectTable<EMutexDataPublic> m_mutexes;
    epublicqueuedef_t *m_pPubQueues;
+   std::unordered_map<Int, Int> m_pubQueueIndex;
 
    static ESynchObjects *m_pThis;
 };
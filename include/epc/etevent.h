@@ -17,6 +17,7 @@
 #ifndef __ETEVENT_H
 #define __ETEVENT_H
 
+#include <iterator>
 #include <unistd.h>
 #include <sys/syscall.h>
 
@@ -25,6 +26,7 @@
 #include "eerror.h"
 #include "egetopt.h"
 #include "eshmem.h"
+#include "eqstats.h"
 #include "esynch.h"
 #include "esynch2.h"
 #include "etimer.h"
@@ -37,6 +39,7 @@
 DECLARE_ERROR(EThreadQueueBaseError_NotOpenForWriting);
 DECLARE_ERROR(EThreadQueueBaseError_NotOpenForReading);
 DECLARE_ERROR(EThreadQueueBaseError_MultipleReadersNotAllowed);
+DECLARE_ERROR(EThreadQueueBaseError_NoSynchObjects);
 DECLARE_ERROR(EThreadQueuePublicError_UnInitialized);
 
 DECLARE_ERROR_ADVANCED(EThreadTimerError_UnableToInitialize);
@@ -367,28 +370,39 @@ public:
    /// @return True indicates that the message was successfully added to the queue, otherwise False.
    ///   This function can only return False if wait is False.
    Bool push(const T &msg, Bool wait = True)
+   {
+      const T *first = &msg;
+      return push(first, first + 1, wait) == 1;
+   }
+   /// @brief Adds a sequence of messages to the thread event queue.
+   /// @details The slots for as many of the messages as will fit are reserved
+   ///   together, the messages are copied and the reader is signaled once for
+   ///   each group of messages instead of once for each message.
+   /// @param first a forward iterator referencing the first message to add.
+   /// @param last a forward iterator referencing the position after the last
+   ///   message to add.
+   /// @param wait indicates whether this function should wait for space to become
+   ///   available in the queue.
+   /// @return the number of messages that were added to the queue.  This can only
+   ///   be less than the number of messages in the sequence if wait is False.
+   template <class Iterator>
+   Int push(Iterator first, Iterator last, Bool wait = True)
    {
       if (m_mode == EThreadQueueMode::ReadOnly)
          throw EThreadQueueBaseError_NotOpenForWriting();
 
-      if (semFree().Decrement(wait) < 0)
-         return False;
+      Int count = std::distance(first, last);
+      Int pushed = 0;
 
+      while (pushed < count)
       {
-         EMutexLock l(mutex());
-
-         data()[msgHead()] = msg;
-         data()[msgHead()].data().getTimer().Start();
-
-         msgHead()++;
-
-         if (msgHead() >= msgCnt())
-            msgHead() = 0;
+         Int n = ring() ? pushRing(first, count - pushed, wait) : pushSemaphore(first, count - pushed, wait);
+         if (n == 0)
+            break;
+         pushed += n;
       }
 
-      semMsgs().Increment();
-
-      return True;
+      return pushed;
    }
    /// @brief Removes the next message from the thread event queue.
    /// @param msg a reference to a message object that will be populated with the message.
@@ -400,7 +414,10 @@ public:
       if (m_mode == EThreadQueueMode::WriteOnly)
          throw EThreadQueueBaseError_NotOpenForReading();
 
-      if (!semMsgs().Decrement(wait))
+      if (ring())
+         return popRing(msg, wait, True);
+
+      if (!decrementMsgs(wait))
          return False;
 
       msg = data()[msgTail()++];
@@ -410,6 +427,8 @@ public:
 
       semFree().Increment();
 
+      recordResidency(msg);
+
       return True;
    }
    /// @brief Retrievees the next message from the thread event queue without removing
@@ -423,7 +442,10 @@ public:
       if (m_mode == EThreadQueueMode::WriteOnly)
          throw EThreadQueueBaseError_NotOpenForReading();
 
-      if (!semMsgs().Decrement(wait))
+      if (ring())
+         return popRing(msg, wait, False);
+
+      if (!decrementMsgs(wait))
          return False;
 
       msg = data()[msgTail()];
@@ -441,6 +463,11 @@ public:
    /// @brief Retrieves the access mode associated with this queue object.
    /// @return the access mode associated with this queue object.
    EThreadQueueMode mode() { return m_mode; }
+   /// @brief Retrieves the statistics for this queue object.
+   /// @details The statistics are collected in this process once
+   ///   EQueueStatistics::enable() has been called.
+   /// @return a reference to the statistics for this queue object.
+   EQueueStatistics &getStatistics() { return m_stats; }
 
 protected:
    /// @cond DOXYGEN_EXCLUDE
@@ -455,6 +482,7 @@ protected:
    virtual Int &refCnt() = 0;
    virtual T *data() = 0;
    virtual Void allocDataSpace(cpStr sFile, Char cId, Int nSize) = 0;
+
    virtual Void initMutex() = 0;
    virtual Void initSemFree(UInt initialCount) = 0;
    virtual Void initSemMsgs(UInt initialCount) = 0;
@@ -463,7 +491,22 @@ protected:
    virtual ESemaphoreData &semMsgs() = 0;
    virtual ESemaphoreData &semFree() = 0;
 
-   virtual int *getBumpPipe() = 0;
+   // the ring is stored in shared memory, each slot has a sequence that
+   // indicates if the slot is free or holds a message for the current
+   // pass through the queue
+   typedef struct
+   {
+      ULongLong m_writePos;
+      Char m_pad1[64 - sizeof(ULongLong)];
+      ULongLong m_readPos;
+      Char m_pad2[64 - sizeof(ULongLong)];
+      Int m_msgsFutex;
+      Int m_readerParked;
+      Int m_freeFutex;
+      Int m_freeWaiters;
+   } ethreadqueuering_t;
+
+   virtual ethreadqueuering_t *ring() { return NULL; }
 
    EThreadQueueBase()
    {
@@ -481,8 +524,10 @@ protected:
       Char szName[EPC_FILENAME_MAX];
       epc_sprintf_s(szName, sizeof(szName), "%d", threadId);
 
-      // calcuate the space required
+      // calcuate the space required, the ring sequences follow the messages
       int nSize = sizeof(T) * nMsgCnt;
+      if (ring())
+         nSize += sizeof(ULongLong) * nMsgCnt;
 
       // initialize the shared memory
       allocDataSpace(szName, 'A', nSize);
@@ -498,15 +543,34 @@ protected:
          msgHead() = 0;
          msgTail() = 0;
 
-         // initialize the control mutex and semaphores
-         initMutex();
-         initSemFree(msgCnt());
-         initSemMsgs(0);
+         if (ring())
+         {
+            initRing();
+         }
+         else
+         {
+            // initialize the control mutex and semaphores
+            initMutex();
+            initSemFree(msgCnt());
+            initSemMsgs(0);
+         }
       }
       else
       {
       }
 
+      if (EQueueStatistics::getDefaultEnabled() && !m_stats.isEnabled())
+      {
+         EString name;
+         m_stats.enable(name.format("thread-%d", threadId).c_str());
+      }
+
+      if (ring())
+      {
+         openRing(eMode);
+         return;
+      }
+
       EMutexLock l(mutex());
 
       if ((eMode == EThreadQueueMode::ReadOnly || eMode == EThreadQueueMode::ReadWrite) && numReaders() > 0)
@@ -525,6 +589,19 @@ protected:
    {
       Bool destroyMutex = False;
 
+      m_stats.disable();
+
+      if (m_initialized && ring())
+      {
+         __sync_sub_and_fetch(&refCnt(), 1);
+         if (m_mode == EThreadQueueMode::ReadOnly || m_mode == EThreadQueueMode::ReadWrite)
+            __sync_sub_and_fetch(&numReaders(), 1);
+         if (m_mode == EThreadQueueMode::WriteOnly || m_mode == EThreadQueueMode::ReadWrite)
+            __sync_sub_and_fetch(&numWriters(), 1);
+         m_initialized = False;
+         return;
+      }
+
       if (m_initialized)
       {
          EMutexLock l(mutex());
@@ -550,8 +627,240 @@ protected:
    /// @endcond
 
 private:
+   ULongLong &ringSeq(ULongLong pos) { return ((ULongLong *)(data() + msgCnt()))[pos % msgCnt()]; }
+
+   Void initRing()
+   {
+      ethreadqueuering_t *r = ring();
+
+      r->m_writePos = 0;
+      r->m_readPos = 0;
+      r->m_msgsFutex = 0;
+      r->m_readerParked = 0;
+      r->m_freeFutex = 0;
+      r->m_freeWaiters = 0;
+
+      for (ULongLong pos = 0; pos < (ULongLong)msgCnt(); pos++)
+         ringSeq(pos) = pos;
+   }
+
+   Void openRing(EThreadQueueMode eMode)
+   {
+      if (eMode == EThreadQueueMode::ReadOnly || eMode == EThreadQueueMode::ReadWrite)
+      {
+         if (__sync_fetch_and_add(&numReaders(), 1) > 0)
+         {
+            __sync_sub_and_fetch(&numReaders(), 1);
+            throw EThreadQueueBaseError_MultipleReadersNotAllowed();
+         }
+      }
+
+      __sync_add_and_fetch(&refCnt(), 1);
+      if (eMode == EThreadQueueMode::WriteOnly || eMode == EThreadQueueMode::ReadWrite)
+         __sync_add_and_fetch(&numWriters(), 1);
+
+      m_initialized = True;
+   }
+
+   template <class Iterator>
+   Int pushSemaphore(Iterator &first, Int count, Bool wait)
+   {
+      // the writer is only timed when it has to wait for free space
+      ETimer blocked(0);
+      Bool timed = m_stats.isEnabled() && wait && semFree().currCount() <= 0;
+      if (timed)
+         blocked.Start();
+
+      if (!semFree().Decrement(wait))
+         return 0;
+
+      if (timed)
+         m_stats.recordBlocked(blocked.MicroSeconds());
+
+      // reserve any additional slots that are free without waiting
+      Int n = 1;
+      while (n < count && semFree().currCount() > 0 && semFree().Decrement(False))
+         n++;
+
+      {
+         EMutexLock l(mutex());
+
+         for (Int i = 0; i < n; i++, ++first)
+         {
+            data()[msgHead()] = *first;
+            data()[msgHead()].data().getTimer().Start();
+
+            msgHead()++;
+
+            if (msgHead() >= msgCnt())
+               msgHead() = 0;
+         }
+      }
+
+      semMsgs().Increment(n);
+
+      if (m_stats.isEnabled())
+      {
+         Long nFree = semFree().currCount();
+         m_stats.recordPush(msgCnt() - (nFree > 0 ? nFree : 0), n);
+      }
+
+      return n;
+   }
+
+   template <class Iterator>
+   Int pushRing(Iterator &first, Int count, Bool wait)
+   {
+      ethreadqueuering_t *r = ring();
+
+      while (True)
+      {
+         ULongLong pos = __atomic_load_n(&r->m_writePos, __ATOMIC_RELAXED);
+
+         // the reader frees the slots in order, so count the free slots
+         // that follow the write position
+         Int n = 0;
+         while (n < count && n < msgCnt() && __atomic_load_n(&ringSeq(pos + n), __ATOMIC_ACQUIRE) == pos + n)
+            n++;
+
+         if (n > 0)
+         {
+            if (!__atomic_compare_exchange_n(&r->m_writePos, &pos, pos + n, True, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+               continue;
+
+            for (Int i = 0; i < n; i++, ++first)
+            {
+               T &slot = data()[(pos + i) % msgCnt()];
+               slot = *first;
+               slot.data().getTimer().Start();
+            }
+
+            for (Int i = 0; i < n; i++)
+               __atomic_store_n(&ringSeq(pos + i), pos + i + 1, __ATOMIC_RELEASE);
+
+            if (m_stats.isEnabled())
+            {
+               // the read position is loaded first so it cannot pass the write position
+               ULongLong readPos = __atomic_load_n(&r->m_readPos, __ATOMIC_ACQUIRE);
+               m_stats.recordPush(__atomic_load_n(&r->m_writePos, __ATOMIC_ACQUIRE) - readPos, n);
+            }
+
+            // only wake the reader if it is parked, and only one writer
+            // needs to wake it
+            __sync_synchronize();
+            if (__atomic_load_n(&r->m_readerParked, __ATOMIC_RELAXED) &&
+                __sync_bool_compare_and_swap(&r->m_readerParked, 1, 0))
+            {
+               __sync_add_and_fetch(&r->m_msgsFutex, 1);
+               EFutex::wake(r->m_msgsFutex, 1);
+            }
+
+            return n;
+         }
+
+         ULongLong seq = __atomic_load_n(&ringSeq(pos), __ATOMIC_ACQUIRE);
+         if (seq > pos)
+            continue;
+
+         // the queue is full
+         if (!wait)
+            return 0;
+
+         ETimer blocked(0);
+         if (m_stats.isEnabled())
+            blocked.Start();
+
+         Int futex = __atomic_load_n(&r->m_freeFutex, __ATOMIC_ACQUIRE);
+         __sync_add_and_fetch(&r->m_freeWaiters, 1);
+         if (__atomic_load_n(&ringSeq(pos), __ATOMIC_ACQUIRE) == seq)
+            EFutex::wait(r->m_freeFutex, futex);
+         __sync_sub_and_fetch(&r->m_freeWaiters, 1);
+
+         if (m_stats.isEnabled())
+            m_stats.recordBlocked(blocked.MicroSeconds());
+      }
+   }
+
+   Bool popRing(T &msg, Bool wait, Bool remove)
+   {
+      ethreadqueuering_t *r = ring();
+
+      // there is only one reader, so the read position is not contended
+      ULongLong pos = __atomic_load_n(&r->m_readPos, __ATOMIC_RELAXED);
+
+      while (__atomic_load_n(&ringSeq(pos), __ATOMIC_ACQUIRE) != pos + 1)
+      {
+         if (!wait)
+            return False;
+
+         ETimer idle(0);
+         if (m_stats.isEnabled())
+            idle.Start();
+
+         // park the reader, the writers check the parked flag after
+         // committing a message so the message is seen either here or
+         // after the wake
+         Int futex = __atomic_load_n(&r->m_msgsFutex, __ATOMIC_ACQUIRE);
+         __atomic_store_n(&r->m_readerParked, 1, __ATOMIC_RELAXED);
+         __sync_synchronize();
+         if (__atomic_load_n(&ringSeq(pos), __ATOMIC_ACQUIRE) != pos + 1)
+            EFutex::wait(r->m_msgsFutex, futex);
+         __atomic_store_n(&r->m_readerParked, 0, __ATOMIC_RELAXED);
+
+         if (m_stats.isEnabled())
+            m_stats.recordIdle(idle.MicroSeconds());
+      }
+
+      msg = data()[pos % msgCnt()];
+
+      if (remove)
+      {
+         __atomic_store_n(&ringSeq(pos), pos + msgCnt(), __ATOMIC_RELEASE);
+         __atomic_store_n(&r->m_readPos, pos + 1, __ATOMIC_RELAXED);
+
+         __sync_synchronize();
+         if (__atomic_load_n(&r->m_freeWaiters, __ATOMIC_RELAXED) > 0)
+         {
+            __sync_add_and_fetch(&r->m_freeFutex, 1);
+            EFutex::wake(r->m_freeFutex, INT_MAX);
+         }
+
+         recordResidency(msg);
+      }
+
+      return True;
+   }
+
+   Bool decrementMsgs(Bool wait)
+   {
+      // the reader is only timed when it has to wait for a message
+      ETimer idle(0);
+      Bool timed = m_stats.isEnabled() && wait && semMsgs().currCount() <= 0;
+      if (timed)
+         idle.Start();
+
+      if (!semMsgs().Decrement(wait))
+         return False;
+
+      if (timed)
+         m_stats.recordIdle(idle.MicroSeconds());
+
+      return True;
+   }
+
+   Void recordResidency(T &msg)
+   {
+      // the message timer is started when the message is pushed
+      if (m_stats.isEnabled())
+      {
+         epctime_t usec = msg.data().getTimer().MicroSeconds();
+         m_stats.recordPop(usec > 0 ? usec : 0);
+      }
+   }
+
    Bool m_initialized;
    EThreadQueueMode m_mode;
+   EQueueStatistics m_stats;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -560,7 +869,10 @@ private:
 /// @brief Definition of a public event thread message queue.
 /// @details The template parameter to this class template is the class of for
 ///   the message that will be stored in this event thread message queue.  This
-///   class is derived from template <class T> class EThreadQueueBase.
+///   class is derived from template <class T> class EThreadQueueBase.  The
+///   queue is a lock free ring in shared memory that does not use the
+///   ESynchObjects mutexes or semaphores.  A writer only makes a system call
+///   to wake the reader when the reader is waiting for a message.
 /// @tparam T the event message class name.
 template <class T>
 class EThreadQueuePublic : public EThreadQueueBase<T>
@@ -608,30 +920,17 @@ protected:
       m_pCtrl = (ethreadmessagequeue_ctrl_t *)m_sharedmem.getDataPtr();
       m_pData = (T *)(((pChar)m_sharedmem.getDataPtr()) + sizeof(ethreadmessagequeue_ctrl_t));
    }
-   Void initMutex()
-   {
-      EMutexPublic m;
-      m_pCtrl->m_mutexid = m.mutexId();
-      m.detach();
-   }
-   Void initSemFree(UInt initialCount)
-   {
-      ESemaphorePublic s(initialCount);
-      m_pCtrl->m_freeSemId = s.semIndex();
-      s.detach();
-   }
-   Void initSemMsgs(UInt initialCount)
-   {
-      ESemaphorePublic s(initialCount);
-      m_pCtrl->m_msgsSemId = s.semIndex();
-      s.detach();
-   }
 
-   EMutexData &mutex() { return ESynchObjects::getMutex(m_pCtrl->m_mutexid); }
-   ESemaphoreData &semFree() { return ESynchObjects::getSemaphore(m_pCtrl->m_freeSemId); }
-   ESemaphoreData &semMsgs() { return ESynchObjects::getSemaphore(m_pCtrl->m_msgsSemId); }
+   // the ring does not use the mutex or semaphores
+   Void initMutex() { throw EThreadQueueBaseError_NoSynchObjects(); }
+   Void initSemFree(UInt initialCount) { throw EThreadQueueBaseError_NoSynchObjects(); }
+   Void initSemMsgs(UInt initialCount) { throw EThreadQueueBaseError_NoSynchObjects(); }
 
-   int *getBumpPipe() { return m_pCtrl->m_bumppipe; }
+   EMutexData &mutex() { throw EThreadQueueBaseError_NoSynchObjects(); }
+   ESemaphoreData &semMsgs() { throw EThreadQueueBaseError_NoSynchObjects(); }
+   ESemaphoreData &semFree() { throw EThreadQueueBaseError_NoSynchObjects(); }
+
+   typename EThreadQueueBase<T>::ethreadqueuering_t *ring() { return &m_pCtrl->m_ring; }
    /// @endcond
 
 private:
@@ -646,11 +945,7 @@ private:
       Int m_head; // next location to write
       Int m_tail; // next location to read
 
-      Int m_mutexid;
-      Int m_freeSemId;
-      Int m_msgsSemId;
-
-      int m_bumppipe[2];
+      typename EThreadQueueBase<T>::ethreadqueuering_t m_ring;
    } ethreadmessagequeue_ctrl_t;
 
    ESharedMemory m_sharedmem;
@@ -740,8 +1035,6 @@ protected:
    EMutexData &mutex() { return m_mutex; }
    ESemaphoreData &semFree() { return m_semFree; }
    ESemaphoreData &semMsgs() { return m_semMsgs; }
-
-   int *getBumpPipe() { return m_bumppipe; }
    /// @endcond
 
 private:
@@ -758,8 +1051,6 @@ private:
    ESemaphorePrivate m_semFree;
    ESemaphorePrivate m_semMsgs;
 
-   int m_bumppipe[2];
-
    T *m_pData;
 };
 
@@ -1121,6 +1412,49 @@ public:
          messageQueued();
       return result;
    }
+   /// @brief Sends a sequence of event messages to this thread.
+   ///
+   /// @param first a forward iterator referencing the first message to send.
+   /// @param last a forward iterator referencing the position after the last
+   ///   message to send.
+   /// @param wait waits for the messages to be sent
+   ///
+   /// @details
+   /// Sends (posts) the supplied event messages to this thread's event queue.
+   /// The queue slots are reserved for as many messages as will fit at once
+   /// and messageQueued() is called once for each group of messages, so a
+   /// socket thread is bumped once instead of once per message.
+   ///
+   /// @return the number of messages that were sent.
+   template <class Iterator>
+   Int sendMessages(Iterator first, Iterator last, Bool wait = True)
+   {
+      Int result = 0;
+
+      while (first != last)
+      {
+         // add the messages that fit without waiting
+         Int n = m_queue.push(first, last, False);
+         if (n > 0)
+         {
+            messageQueued();
+            std::advance(first, n);
+            result += n;
+            continue;
+         }
+
+         // the queue is full, the thread has already been notified of the
+         // messages that were added so it will make room for the next one
+         if (!wait || !m_queue.push(*first, True))
+            break;
+
+         messageQueued();
+         ++first;
+         result++;
+      }
+
+      return result;
+   }
 
    /// @brief Initializes the thread object.
    /// @param appId identifies the application this thread is associated with.
@@ -1207,6 +1541,10 @@ public:
       t.init(this, msg);
    }
    /// @brief Returns the semaphore associated with this thread's event queue.
+   /// @details Only a private thread has a message semaphore.  The queue of a
+   ///   public thread is a lock free ring that has no semaphore, so this
+   ///   method throws EThreadQueueBaseError_NoSynchObjects for a public thread.
+   /// @throws EThreadQueueBaseError_NoSynchObjects if the queue is a public queue.
    ESemaphoreData &getMsgSemaphore()
    {
       return m_queue.semMsgs();
@@ -1222,10 +1560,6 @@ protected:
    {
       return NULL;
    }
-   int *getBumpPipe()
-   {
-      return m_queue.getBumpPipe();
-   }
    /// @endcond
 
    /// @brief Called when an event message is queued.
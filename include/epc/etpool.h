@@ -0,0 +1,786 @@
+/*
+* Copyright (c) 2020 Sprint
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __ETPOOL_H
+#define __ETPOOL_H
+
+/// @file
+/// @brief Defines a work stealing pool of event threads.
+
+#include <unistd.h>
+
+#include <iterator>
+#include <vector>
+
+#include "ebase.h"
+#include "eerror.h"
+#include "estring.h"
+#include "esynch.h"
+#include "etbasic.h"
+#include "etevent.h"
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/// @cond DOXYGEN_EXCLUDE
+
+DECLARE_ERROR(EThreadPoolError_AlreadyInitialized);
+
+/// @endcond
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief A fixed capacity Chase-Lev work stealing deque.
+/// @details The owning thread adds and removes messages at the bottom of the
+///   deque without locks.  Any other thread can steal the oldest message from
+///   the top of the deque, only contending with the owner when a single
+///   message remains.
+/// @tparam T the event message class name.
+template <class T>
+class EThreadPoolDeque
+{
+public:
+   /// @brief Default constructor.
+   EThreadPoolDeque()
+      : m_top(0),
+        m_bottom(0),
+        m_mask(0),
+        m_data(NULL)
+   {
+   }
+   /// @brief Class destructor.
+   ~EThreadPoolDeque()
+   {
+      if (m_data)
+      {
+         delete[] m_data;
+         m_data = NULL;
+      }
+   }
+
+   /// @brief Allocates the deque.
+   /// @param capacity the maximum number of messages, rounded up to a power of 2.
+   Void init(Int capacity)
+   {
+      Int cap = 16;
+      while (cap < capacity)
+         cap <<= 1;
+
+      m_mask = cap - 1;
+      m_data = new T[cap];
+   }
+
+   /// @brief Adds a message to the bottom of the deque.  Only called by the owner.
+   /// @param msg the message to add.
+   /// @return True if the message was added, False if the deque is full.
+   Bool push(const T &msg)
+   {
+      LongLong b = __atomic_load_n(&m_bottom, __ATOMIC_RELAXED);
+      LongLong t = __atomic_load_n(&m_top, __ATOMIC_ACQUIRE);
+      if (b - t > m_mask)
+         return False;
+
+      m_data[b & m_mask] = msg;
+      __atomic_store_n(&m_bottom, b + 1, __ATOMIC_RELEASE);
+
+      return True;
+   }
+   /// @brief Removes the newest message from the bottom of the deque.  Only
+   ///   called by the owner.
+   /// @param msg populated with the message.
+   /// @return True if a message was removed, False if the deque is empty.
+   Bool take(T &msg)
+   {
+      LongLong b = __atomic_load_n(&m_bottom, __ATOMIC_RELAXED) - 1;
+      __atomic_store_n(&m_bottom, b, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      LongLong t = __atomic_load_n(&m_top, __ATOMIC_RELAXED);
+
+      if (t > b)
+      {
+         // the deque is empty
+         __atomic_store_n(&m_bottom, b + 1, __ATOMIC_RELAXED);
+         return False;
+      }
+
+      msg = m_data[b & m_mask];
+      if (t == b)
+      {
+         // the last message, race any thief for it
+         Bool won = __atomic_compare_exchange_n(&m_top, &t, t + 1, False, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+         __atomic_store_n(&m_bottom, b + 1, __ATOMIC_RELAXED);
+         return won;
+      }
+
+      return True;
+   }
+   /// @brief Removes the oldest message from the top of the deque.  Can be
+   ///   called by any thread.
+   /// @param msg populated with the message.
+   /// @return True if a message was removed, False if the deque is empty or
+   ///   another thread removed the message first.
+   Bool steal(T &msg)
+   {
+      LongLong t = __atomic_load_n(&m_top, __ATOMIC_ACQUIRE);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      LongLong b = __atomic_load_n(&m_bottom, __ATOMIC_ACQUIRE);
+
+      if (t >= b)
+         return False;
+
+      // the owner cannot overwrite this slot until the top has moved past it,
+      // so the copy is only kept if the top is claimed
+      msg = m_data[t & m_mask];
+      return __atomic_compare_exchange_n(&m_top, &t, t + 1, False, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+   }
+
+   /// @brief Retrieves the approximate number of messages in the deque.
+   /// @return the approximate number of messages in the deque.
+   Int size() const
+   {
+      LongLong t = __atomic_load_n(&m_top, __ATOMIC_ACQUIRE);
+      LongLong b = __atomic_load_n(&m_bottom, __ATOMIC_ACQUIRE);
+      return b > t ? (Int)(b - t) : 0;
+   }
+   /// @brief Retrieves the maximum number of messages in the deque.
+   /// @return the maximum number of messages in the deque.
+   Int capacity() const { return (Int)m_mask + 1; }
+
+private:
+   EThreadPoolDeque(const EThreadPoolDeque &);
+   EThreadPoolDeque &operator=(const EThreadPoolDeque &);
+
+   LongLong m_top;
+   Char m_pad1[64 - sizeof(LongLong)];
+   LongLong m_bottom;
+   Char m_pad2[64 - sizeof(LongLong)];
+   LongLong m_mask;
+   T *m_data;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief A pool of worker threads that share the processing of event messages.
+///
+/// @details Messages are dispatched to the handlers declared with
+/// BEGIN_MESSAGE_MAP/ON_MESSAGE/END_MESSAGE_MAP in the derived class, the same
+/// as EThreadEvent, but a handler can be called by any worker at the same time
+/// so handlers must not modify shared state without synchronization.
+///
+/// Each worker owns a work stealing deque.  A message sent from outside the
+/// pool is added to the inbox of a worker, selected round robin, and the worker
+/// moves it to its deque.  A message sent by a handler is added directly to the
+/// deque of the worker running the handler.  A worker processes the newest
+/// message in its own deque first and, when the deque is empty, steals the
+/// oldest message from the deque of another worker.
+///
+/// A handler never waits for space in a queue.  When the deque of its worker
+/// is full, the message is added to the inbox of any worker with space, and
+/// when every inbox is also full the handler processes the message itself.
+/// Messages processed this way are limited to a small nesting depth, beyond
+/// which the send fails.
+///
+/// A keyed message is always processed by the worker selected by the key and
+/// is never stolen, so the messages sent with the same key, a session ID for
+/// example, are processed one at a time in the order they were sent.
+///
+/// @tparam TMessage the event message class name.
+template <class TMessage>
+class EThreadPoolBase : public _EThreadEventBase
+{
+public:
+   /// @cond DOXYGEN_EXCLUDE
+   typedef Void (EThreadPoolBase::*msgfxn_t)(TMessage &);
+   typedef struct
+   {
+      UInt     nMessage; // message
+      msgfxn_t pFn; // routine to call (or special value)
+   } msgentry_t;
+
+   struct msgmap_t
+   {
+      const msgmap_t *(*pfnGetBaseMap)();
+      const msgentry_t *lpEntries;
+   };
+   /// @endcond
+
+   /// @brief Default class constructor.
+   EThreadPoolBase()
+      : m_appId(0),
+        m_threadId(0),
+        m_stacksize(0),
+        m_next(0),
+        m_idle(0)
+   {
+   }
+   /// @brief Class destructor.
+   /// @details quit() and join() must be called before the pool is destroyed.
+   virtual ~EThreadPoolBase()
+   {
+      for (auto w : m_workers)
+         delete w;
+      m_workers.clear();
+   }
+
+   /// @brief Sends an event message to the pool.
+   /// @param message the message ID.
+   /// @param wait waits for the message to be sent.
+   /// @return True if the message was sent, otherwise False.
+   Bool sendMessage(UInt message, Bool wait = True)
+   {
+      TMessage msg(message);
+      return post(msg, wait);
+   }
+   /// @brief Sends an event message to the pool.
+   /// @param message the message ID.
+   /// @param voidptr a void pointer to be included with the message.
+   /// @param wait waits for the message to be sent.
+   /// @return True if the message was sent, otherwise False.
+   Bool sendMessage(UInt message, pVoid voidptr, Bool wait = True)
+   {
+      TMessage msg(message);
+      msg.setVoidPtr(voidptr);
+      return post(msg, wait);
+   }
+   /// @brief Sends an event message to the pool.
+   /// @param msg the message to send.
+   /// @param wait waits for the message to be sent.
+   /// @return True if the message was sent, otherwise False.
+   Bool sendMessage(const TMessage &msg, Bool wait = True)
+   {
+      return post(msg, wait);
+   }
+   /// @brief Sends a sequence of event messages to the pool.
+   /// @details The messages are added to the inbox of one worker as a group
+   ///   and idle workers steal them from that worker.
+   /// @param first a forward iterator referencing the first message to send.
+   /// @param last a forward iterator referencing the position after the last
+   ///   message to send.
+   /// @param wait waits for the messages to be sent.
+   /// @return the number of messages that were sent.
+   template <class Iterator>
+   Int sendMessages(Iterator first, Iterator last, Bool wait = True)
+   {
+      Int result = 0;
+
+      while (first != last)
+      {
+         Worker &w = *m_workers[nextWorker()];
+         Int n = w.m_inbox.push(first, last, False);
+         if (n > 0)
+         {
+            wake(w);
+            std::advance(first, n);
+            result += n;
+            continue;
+         }
+
+         if (!wait || !post(*first, True))
+            break;
+
+         ++first;
+         result++;
+      }
+
+      return result;
+   }
+   /// @brief Sends a keyed event message to the pool.
+   /// @details All messages sent with the same key are processed by the same
+   ///   worker in the order they were sent.  A handler never waits for space
+   ///   in the keyed queue, since two workers waiting on each other's queue
+   ///   would never resume.  The message cannot be processed by another
+   ///   worker, so when called by a handler this method returns False if the
+   ///   keyed queue of the selected worker is full.
+   /// @param key the affinity key, such as a session ID.
+   /// @param msg the message to send.
+   /// @param wait waits for the message to be sent, ignored when called by a
+   ///   handler.
+   /// @return True if the message was sent, otherwise False.
+   Bool sendKeyedMessage(ULongLong key, const TMessage &msg, Bool wait = True)
+   {
+      Worker &w = *m_workers[getKeyWorker(key)];
+      if (currentWorker())
+         wait = False;
+      if (!w.m_keyed.push(msg, wait))
+         return False;
+      wake(w);
+      return True;
+   }
+   /// @brief Sends a keyed event message to the pool.
+   /// @param key the affinity key, such as a session ID.
+   /// @param message the message ID.
+   /// @param voidptr a void pointer to be included with the message.
+   /// @param wait waits for the message to be sent.
+   /// @return True if the message was sent, otherwise False.
+   Bool sendKeyedMessage(ULongLong key, UInt message, pVoid voidptr = NULL, Bool wait = True)
+   {
+      TMessage msg(message);
+      msg.setVoidPtr(voidptr);
+      return sendKeyedMessage(key, msg, wait);
+   }
+
+   /// @brief Initializes the pool.
+   /// @param appId identifies the application this pool is associated with.
+   /// @param threadId identifies the pool within this application.
+   /// @param workers the number of worker threads, if zero the number of
+   ///   online processors.
+   /// @param queueSize the maximum number of unprocessed entries in the inbox
+   ///   and in the keyed queue of each worker.
+   /// @param dequeSize the maximum number of entries in the work stealing
+   ///   deque of each worker.
+   /// @param suspended if True, the workers are not started until start() is called.
+   /// @param stackSize the stack size.
+   /// @throws EThreadPoolError_AlreadyInitialized if the pool has already been initialized.
+   virtual Void init(Short appId, UShort threadId, Int workers = 0, Int queueSize = 16384,
+                     Int dequeSize = 4096, Bool suspended = False, Dword stackSize = 0)
+   {
+      if (!m_workers.empty())
+         throw EThreadPoolError_AlreadyInitialized();
+
+      if (workers <= 0)
+         workers = (Int)sysconf(_SC_NPROCESSORS_ONLN);
+      if (workers <= 0)
+         workers = 1;
+
+      m_appId = appId;
+      m_threadId = threadId;
+      m_stacksize = stackSize;
+
+      long id = m_appId * 10000 + m_threadId;
+
+      for (Int i = 0; i < workers; i++)
+      {
+         Worker *w = new Worker(*this, i);
+
+         w->m_deque.init(dequeSize);
+         w->m_inbox.init(queueSize, id, True, EThreadQueueMode::ReadWrite);
+         w->m_keyed.init(queueSize, id, True, EThreadQueueMode::ReadWrite);
+
+         // both queues were registered with the pool ID, give each a unique name
+         EString name;
+         if (w->m_inbox.getStatistics().isEnabled())
+         {
+            w->m_inbox.getStatistics().disable();
+            w->m_inbox.getStatistics().enable(name.format("pool-%ld-%d", id, i).c_str());
+         }
+         if (w->m_keyed.getStatistics().isEnabled())
+         {
+            w->m_keyed.getStatistics().disable();
+            w->m_keyed.getStatistics().enable(name.format("pool-%ld-%d-keyed", id, i).c_str());
+         }
+
+         m_workers.push_back(w);
+      }
+
+      if (!suspended)
+         start();
+   }
+   /// @brief Starts the worker threads when the pool was suspended at init().
+   Void start()
+   {
+      for (Int i = 0; i < getWorkerCount(); i++)
+      {
+         Worker &w = *m_workers[i];
+         if (!w.isInitialized())
+         {
+            w.init(NULL, m_stacksize);
+            sendKeyedMessage(i, EM_INIT);
+         }
+      }
+   }
+   /// @brief Posts the quit message to each worker.
+   /// @details Each worker exits after it has processed the messages in its
+   ///   queues and no work is left to steal.  Messages sent after quit() is
+   ///   called may not be processed.
+   Void quit()
+   {
+      for (Int i = 0; i < getWorkerCount(); i++)
+         sendKeyedMessage(i, EM_QUIT);
+   }
+   /// @brief Waits for all of the worker threads to exit.
+   Void join()
+   {
+      for (auto w : m_workers)
+         w->join();
+   }
+
+   /// @brief Retrieves the number of worker threads.
+   /// @return the number of worker threads.
+   Int getWorkerCount() const { return (Int)m_workers.size(); }
+   /// @brief Retrieves the index of the worker that processes a key.
+   /// @param key the affinity key.
+   /// @return the index of the worker that processes the key.
+   Int getKeyWorker(ULongLong key) const { return (Int)(key % m_workers.size()); }
+   /// @brief Retrieves the index of the worker calling this method.
+   /// @return the index of the worker, or -1 if not called by a worker of this pool.
+   Int getWorkerIndex() const
+   {
+      Worker *w = currentWorker();
+      return w ? w->m_index : -1;
+   }
+
+   /// @brief Called in the context of each worker when the EM_INIT event is processed.
+   virtual Void onInit()
+   {
+   }
+   /// @brief Called in the context of each worker before it exits.
+   virtual Void onQuit()
+   {
+   }
+   /// @brief Called in the context of a worker when the EM_TIMER event is processed.
+   /// @param ptimer a pointer to the EThreadEventTimer object that expired
+   virtual Void onTimer(EThreadEventTimer *ptimer)
+   {
+   }
+   /// @brief Intializes an EThreadEventTimer object and associates with this pool.
+   /// @param t the EThreadEventTimer object to initialize
+   Void initTimer(EThreadEventTimer &t)
+   {
+      TMessage *msg = new TMessage(EM_TIMER);
+      msg->setVoidPtr(&t);
+      t.init(this, msg);
+   }
+
+protected:
+   /// @cond DOXYGEN_EXCLUDE
+   virtual const msgmap_t *GetMessageMap() const
+   {
+      return GetThisMessageMap();
+   }
+   static const msgmap_t *GetThisMessageMap()
+   {
+      return NULL;
+   }
+   /// @endcond
+
+   /// @brief The default event message handler.
+   /// @param msg the event message object
+   /// @details This method is called when no event handler has been defined
+   ///   in the class heirarchy for a specified event.
+   virtual Void defaultMessageHandler(TMessage &msg)
+   {
+   }
+
+private:
+   class Worker : public EThreadBasic
+   {
+   public:
+      Worker(EThreadPoolBase &pool, Int index)
+         : m_pool(pool),
+           m_index(index),
+           m_sleeping(0),
+           m_depth(0),
+           m_wake(0)
+      {
+      }
+
+      Dword threadProc(pVoid arg)
+      {
+         m_pool.run(*this);
+         return 0;
+      }
+
+      EThreadPoolBase &m_pool;
+      Int m_index;
+      Int m_sleeping;
+      Int m_depth; // messages being processed inline by a handler
+      ESemaphorePrivate m_wake;
+      EThreadPoolDeque<TMessage> m_deque;
+      EThreadQueuePrivate<TMessage> m_inbox;
+      EThreadQueuePrivate<TMessage> m_keyed;
+   };
+
+   // the maximum number of messages moved from the inbox to the deque at a time
+   static const Int DrainBatch = 64;
+   // the maximum number of messages a handler can process inline when every
+   // queue is full, each one adds the handler to the stack
+   static const Int MaxInlineDepth = 8;
+
+   static Worker *&current()
+   {
+      static thread_local Worker *w = NULL;
+      return w;
+   }
+
+   Worker *currentWorker() const
+   {
+      Worker *w = current();
+      return w && &w->m_pool == this ? w : NULL;
+   }
+
+   Int nextWorker()
+   {
+      return (Int)(__sync_fetch_and_add(&m_next, 1) % m_workers.size());
+   }
+
+   Bool post(const TMessage &msg, Bool wait)
+   {
+      Worker *self = currentWorker();
+      if (self)
+      {
+         if (self->m_deque.push(msg))
+         {
+            notifyIdle(self);
+            return True;
+         }
+
+         // the deque is full, a worker must not wait on another worker so
+         // try each inbox once and process the message here if all are full
+         for (Int i = 0; i < getWorkerCount(); i++)
+         {
+            Worker &w = *m_workers[nextWorker()];
+            if (w.m_inbox.push(msg, False))
+            {
+               wake(w);
+               return True;
+            }
+         }
+
+         // a handler processed inline can send again, so the nesting is
+         // limited to keep the stack bounded
+         if (!wait || self->m_depth >= MaxInlineDepth)
+            return False;
+
+         TMessage m(msg);
+         self->m_depth++;
+         try
+         {
+            dispatch(m);
+         }
+         catch (...)
+         {
+            self->m_depth--;
+            throw;
+         }
+         self->m_depth--;
+         return True;
+      }
+
+      Worker &w = *m_workers[nextWorker()];
+      if (!w.m_inbox.push(msg, wait))
+         return False;
+      wake(w);
+      return True;
+   }
+
+   Bool wake(Worker &w)
+   {
+      // the message was queued before the sleeping flag is checked, the
+      // worker sets the flag before checking its queues
+      __sync_synchronize();
+      if (__atomic_load_n(&w.m_sleeping, __ATOMIC_RELAXED) &&
+          __atomic_exchange_n(&w.m_sleeping, 0, __ATOMIC_SEQ_CST))
+      {
+         __sync_sub_and_fetch(&m_idle, 1);
+         w.m_wake.Increment();
+         return True;
+      }
+      return False;
+   }
+
+   Void notifyIdle(Worker *self)
+   {
+      // wake one idle worker to steal the work that was just added
+      __sync_synchronize();
+      if (__atomic_load_n(&m_idle, __ATOMIC_RELAXED) <= 0)
+         return;
+
+      Int cnt = getWorkerCount();
+      for (Int i = 1; i < cnt; i++)
+      {
+         if (wake(*m_workers[(self->m_index + i) % cnt]))
+            break;
+      }
+   }
+
+   Bool steal(Worker &self, TMessage &msg)
+   {
+      Int cnt = getWorkerCount();
+      for (Int i = 1; i < cnt; i++)
+      {
+         Worker &victim = *m_workers[(self.m_index + i) % cnt];
+         while (victim.m_deque.size() > 0)
+         {
+            if (victim.m_deque.steal(msg))
+               return True;
+         }
+      }
+      return False;
+   }
+
+   Bool hasWork(Worker &self)
+   {
+      TMessage msg;
+
+      if (self.m_keyed.peek(msg, False) || self.m_inbox.peek(msg, False))
+         return True;
+
+      for (auto w : m_workers)
+      {
+         if (w->m_deque.size() > 0)
+            return True;
+      }
+
+      return False;
+   }
+
+   Void sleep(Worker &self)
+   {
+      __atomic_store_n(&self.m_sleeping, 1, __ATOMIC_SEQ_CST);
+      __sync_add_and_fetch(&m_idle, 1);
+
+      if (hasWork(self))
+      {
+         if (__atomic_exchange_n(&self.m_sleeping, 0, __ATOMIC_SEQ_CST))
+         {
+            __sync_sub_and_fetch(&m_idle, 1);
+            return;
+         }
+         // another thread claimed the wakeup and will post the semaphore
+      }
+
+      self.m_wake.Decrement();
+   }
+
+   Void run(Worker &self)
+   {
+      TMessage msg;
+      Bool quitting = False;
+
+      current() = &self;
+
+      while (True)
+      {
+         Bool found = False;
+
+         // keyed messages are only processed by this worker, in order
+         if (self.m_keyed.pop(msg, False))
+         {
+            found = True;
+            if (msg.getMessageId() == EM_QUIT)
+               quitting = True;
+            else
+               dispatch(msg);
+         }
+
+         // move unkeyed messages to the deque where idle workers can steal them
+         Int moved = 0;
+         while (moved < DrainBatch && self.m_deque.size() < self.m_deque.capacity() &&
+                self.m_inbox.pop(msg, False))
+         {
+            // only this worker adds to the deque, so there is room
+            self.m_deque.push(msg);
+            moved++;
+         }
+         if (moved > 1)
+            notifyIdle(&self);
+
+         if (self.m_deque.take(msg) || steal(self, msg))
+         {
+            found = True;
+            dispatch(msg);
+         }
+
+         if (found)
+            continue;
+
+         if (quitting)
+            break;
+
+         sleep(self);
+      }
+
+      onQuit();
+
+      current() = NULL;
+   }
+
+   Bool dispatch(TMessage &msg)
+   {
+      Bool keepgoing = True;
+      const msgmap_t *pMap;
+      const msgentry_t *pEntries;
+
+      if (msg.getMessageId() >= EM_USER)
+      {
+         // interate through each map
+         for (pMap = GetMessageMap(); keepgoing && pMap && pMap->pfnGetBaseMap != NULL; pMap = (*pMap->pfnGetBaseMap)())
+         {
+            // interate through each entry for the map
+            for (pEntries = pMap->lpEntries; pEntries->nMessage; pEntries++)
+            {
+               if (pEntries->nMessage == msg.getMessageId())
+               {
+                  (this->*pEntries->pFn)(msg);
+                  keepgoing = False;
+                  break;
+               }
+            }
+         }
+
+         if (pMap == NULL)
+            defaultMessageHandler(msg);
+      }
+      else
+      {
+         switch (msg.getMessageId())
+         {
+            case EM_INIT:
+            {
+               onInit();
+               break;
+            }
+            case EM_TIMER:
+            {
+               onTimer( (EThreadEventTimer*)msg.getVoidPtr() );
+               break;
+            }
+            default:
+            {
+               break;
+            }
+         }
+      }
+
+      return keepgoing;
+   }
+
+   Bool _sendMessage(const _EThreadEventMessageBase &msg, Bool wait)
+   {
+      return sendMessage( (const TMessage &)msg, wait );
+   }
+
+   Void _destroyMessage(_EThreadEventMessageBase *msg)
+   {
+      delete (TMessage*)msg;
+   }
+
+   Short m_appId;
+   UShort m_threadId;
+   size_t m_stacksize;
+   ULong m_next;
+   Int m_idle;
+   std::vector<Worker*> m_workers;
+};
+
+typedef EThreadPoolBase<EThreadMessage> EThreadPool;
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // #ifndef __ETPOOL_H
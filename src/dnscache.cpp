@@ -27,6 +27,7 @@
 #include "eerror.h"
 #include "etevent.h"
 #include "esynch.h"
+#include "ehash.h"
 #include "dnscache.h"
 #include "dnsparser.h"
 
@@ -183,7 +184,7 @@ namespace DNS
 
       if (qp)
       {
-         qp->endQuery();
+         qp->endQuery( *qq, status );
 
          try
          {
@@ -201,6 +202,9 @@ namespace DNS
             qp->getCache().updateCache( *qq );
          }
 
+         if ( status != ARES_SUCCESS || (*qq)->getError() )
+            qp->getCache().getMetrics().incErrors();
+
          if ( (*qq)->getCompletionEvent() )
             (*qq)->getCompletionEvent()->set();
 
@@ -226,6 +230,9 @@ namespace DNS
    {
       m_channel = NULL;
 
+      for ( Int i = 0; i < InFlightSlots; i++ )
+         m_inflight[i] = 0;
+
       init();
 
       m_qpt.init( NULL );
@@ -335,6 +342,11 @@ namespace DNS
       q->setQueryProcessor( this );
       q->setError( false );
 
+      if ( getInFlightSlot( q ).fetch_add( 1, std::memory_order_relaxed ) > 0 )
+         m_cache.getMetrics().incDuplicateMisses();
+      m_cache.getMetrics().incInFlight();
+      q->getTimer().Start();
+
       QueryPtr *qq = new QueryPtr(q);
 
       if ( q->getCallback() || q->getCompletionEvent() )
@@ -355,10 +367,24 @@ namespace DNS
       }
    }
 
-   Void QueryProcessor::endQuery()
+   Void QueryProcessor::endQuery( QueryPtr &q, int status )
    {
+      m_cache.getMetrics().queryCompleted( q->getTimer().MicroSeconds() );
+      if ( status == ARES_ETIMEOUT )
+         m_cache.getMetrics().incTimeouts();
+
+      getInFlightSlot( q ).fetch_sub( 1, std::memory_order_relaxed );
+
       m_qpt.decActiveQueries();
    }
+
+   std::atomic<Int> &QueryProcessor::getInFlightSlot( QueryPtr &q )
+   {
+      // queries that hash to the same slot are counted together, so a
+      // collision can report a duplicate miss for a different domain
+      ULong hash = Cache::getDomainHash( q->getDomain().data(), q->getDomain().length() );
+      return m_inflight[ ( hash ^ q->getType() ) & ( InFlightSlots - 1 ) ];
+   }
    /// @endcond
 
    /////////////////////////////////////////////////////////////////////////////
@@ -423,14 +449,23 @@ namespace DNS
       }
 
       std::map<namedserverid_t, Cache*> &getMap() { return m_map; }
+      EMutexPrivate &getMutex() { return m_mutex; }
 
    private:
       std::map<namedserverid_t, Cache*> m_map;
+      EMutexPrivate m_mutex;
    };
 
-   Cache& Cache::getInstance(namedserverid_t nsid)
+   static CacheMap &getCacheMap()
    {
       static CacheMap cm;
+      return cm;
+   }
+
+   Cache& Cache::getInstance(namedserverid_t nsid)
+   {
+      CacheMap &cm = getCacheMap();
+      EMutexLock l( cm.getMutex() );
       Cache *c;
 
       auto search = cm.getMap().find(nsid);
@@ -468,6 +503,7 @@ namespace DNS
       QueryPtr q = lookupQuery( rtype, domain );
 
       cacheHit = !( !q || q->isExpired() );
+      countQuery( cacheHit, ignorecache );
 
       if ( !cacheHit || ignorecache ) // query not found or expired
       {
@@ -485,6 +521,7 @@ namespace DNS
       QueryPtr q = lookupQuery( rtype, domain );
 
       Bool cacheHit = !( !q || q->isExpired() );
+      countQuery( cacheHit, ignorecache );
 
       if ( cacheHit && !ignorecache )
       {
@@ -500,6 +537,72 @@ namespace DNS
       }
    }
 
+   QueryPtr Cache::query( ns_type rtype, const char *domain, size_t len, ULong hash, Bool &cacheHit, Bool ignorecache )
+   {
+      QueryPtr q = lookupQuery( rtype, domain, len, hash );
+
+      cacheHit = !( !q || q->isExpired() );
+      countQuery( cacheHit, ignorecache );
+
+      if ( !cacheHit || ignorecache ) // query not found or expired
+      {
+         q.reset( new Query( rtype, std::string(domain, len) ) );
+         m_qp.beginQuery( q );
+         if (ignorecache)
+            cacheHit = false;
+      }
+
+      return q;
+   }
+
+   Void Cache::query( ns_type rtype, const char *domain, size_t len, ULong hash, CachedDNSQueryCallback cb, const Void *data, Bool ignorecache )
+   {
+      QueryPtr q = lookupQuery( rtype, domain, len, hash );
+
+      Bool cacheHit = !( !q || q->isExpired() );
+      countQuery( cacheHit, ignorecache );
+
+      if ( cacheHit && !ignorecache )
+      {
+         if ( cb )
+            cb( q, cacheHit, data );
+      }
+      else
+      {
+         q.reset( new Query( rtype, std::string(domain, len) ) );
+         q->setCallback( cb );
+         q->setData( data );
+         m_qp.beginQuery( q );
+      }
+   }
+
+   EString &Cache::getMetricsJson( EString &json )
+   {
+      StringBuffer buf;
+      Writer<StringBuffer> writer( buf );
+
+      // the lock keeps a cache from being added while the map is walked
+      CacheMap &cm = getCacheMap();
+      EMutexLock l( cm.getMutex() );
+
+      writer.StartArray();
+      for ( auto &kv : cm.getMap() )
+      {
+         EString s;
+         kv.second->getMetrics().toJson( s, kv.first );
+         writer.RawValue( s.c_str(), s.length(), kObjectType );
+      }
+      writer.EndArray();
+
+      json.assign( buf.GetString(), buf.GetSize() );
+      return json;
+   }
+
+   ULong Cache::getDomainHash( const char *domain, size_t len )
+   {
+      return EHash::getHash( domain, len );
+   }
+
    Void Cache::loadQueries(const char *qfn)
    {
       m_refresher.loadQueries( qfn );
@@ -534,6 +637,22 @@ namespace DNS
       return it != m_cache.end() ? it->second : QueryPtr();
    }
 
+   QueryPtr Cache::lookupQuery( ns_type rtype, const char *domain, size_t len, ULong hash )
+   {
+      ERDLock l( m_cacherwlock );
+      auto it = m_hashindex.find( hash );
+      if ( it != m_hashindex.end() )
+      {
+         for ( auto &q : it->second )
+         {
+            if ( q->getType() == rtype && q->getDomain().length() == len &&
+                 memcmp( q->getDomain().data(), domain, len ) == 0 )
+               return q;
+         }
+      }
+      return QueryPtr();
+   }
+
    Void Cache::updateCache( QueryPtr q )
    {
       if ( !q )
@@ -542,10 +661,25 @@ namespace DNS
       if ( !q->getError() )
       {
          QueryCacheKey qck( q->getType(), q->getDomain() );
+         ULong hash = getDomainHash( q->getDomain().data(), q->getDomain().length() );
          EWRLock l( m_cacherwlock );
          if ( m_cache.find(qck) == m_cache.end() )
             atomic_inc_fetch( m_newquerycnt );
          m_cache[qck] = q;
+
+         // replace the query in the hash index
+         std::vector<QueryPtr> &bucket = m_hashindex[hash];
+         auto it = bucket.begin();
+         for ( ; it != bucket.end(); ++it )
+         {
+            if ( (*it)->getType() == q->getType() && (*it)->getDomain() == q->getDomain() )
+            {
+               *it = q;
+               break;
+            }
+         }
+         if ( it == bucket.end() )
+            bucket.push_back( q );
       }
    }
 
@@ -577,11 +711,73 @@ namespace DNS
       for (auto val : m_cache )
          keys.push_back( val.first );
    }
+
+   Void Cache::countQuery( Bool cacheHit, Bool ignorecache )
+   {
+      m_metrics.incQueries();
+      if ( ignorecache )
+         m_metrics.incRefreshes();
+      else if ( cacheHit )
+         m_metrics.incHits();
+      else
+         m_metrics.incMisses();
+   }
    /// @endcond
 
    ////////////////////////////////////////////////////////////////////////////////
    ////////////////////////////////////////////////////////////////////////////////
 
+   EString &CacheMetrics::toJson( EString &json, namedserverid_t nsid ) const
+   {
+      StringBuffer buf;
+      Writer<StringBuffer> writer( buf );
+
+      writer.StartObject();
+      writer.String( "namedserverid" );     writer.Int( nsid );
+      writer.String( "queries" );           writer.Uint64( getQueries() );
+      writer.String( "hits" );              writer.Uint64( getHits() );
+      writer.String( "misses" );            writer.Uint64( getMisses() );
+      writer.String( "hitratio" );          writer.Double( getHitRatio() );
+      writer.String( "duplicatemisses" );   writer.Uint64( getDuplicateMisses() );
+      writer.String( "refreshes" );         writer.Uint64( getRefreshes() );
+      writer.String( "refreshbacklog" );    writer.Int( getRefreshBacklog() );
+      writer.String( "inflight" );          writer.Int( getInFlight() );
+      writer.String( "completed" );         writer.Uint64( getCompleted() );
+      writer.String( "errors" );            writer.Uint64( getErrors() );
+      writer.String( "timeouts" );          writer.Uint64( getTimeouts() );
+
+      const EHistogram &h = getResolverLatency();
+      writer.String( "latency" );
+      writer.StartObject();
+      writer.String( "count" );  writer.Uint64( h.getCount() );
+      writer.String( "avg" );    writer.Double( h.getAverage() );
+      writer.String( "max" );    writer.Uint64( h.getMax() );
+      writer.String( "p50" );    writer.Uint64( h.getPercentile( 50.0 ) );
+      writer.String( "p90" );    writer.Uint64( h.getPercentile( 90.0 ) );
+      writer.String( "p99" );    writer.Uint64( h.getPercentile( 99.0 ) );
+      writer.String( "buckets" );
+      writer.StartArray();
+      for ( Int i = 0; i < EHistogram::Buckets; i++ )
+      {
+         if ( h.getBucketCount(i) == 0 )
+            continue;
+         writer.StartObject();
+         writer.String( "le" );     writer.Uint64( EHistogram::getBucketLimit(i) );
+         writer.String( "count" );  writer.Uint64( h.getBucketCount(i) );
+         writer.EndObject();
+      }
+      writer.EndArray();
+      writer.EndObject();
+
+      writer.EndObject();
+
+      json.assign( buf.GetString(), buf.GetSize() );
+      return json;
+   }
+
+   ////////////////////////////////////////////////////////////////////////////////
+   ////////////////////////////////////////////////////////////////////////////////
+
    /// @cond DOXYGEN_EXCLUDE
 
    BEGIN_MESSAGE_MAP(CacheRefresher, EThreadPrivate)
@@ -663,13 +859,16 @@ namespace DNS
    Void CacheRefresher::_submitQueries( std::list<QueryCacheKey> &keys )
    {
       m_running = true;
+      m_cache.getMetrics().setRefreshBacklog( keys.size() );
 
       for (auto qck : keys)
       {
          m_sem.Decrement();
+         m_cache.getMetrics().decRefreshBacklog();
          m_cache.query( qck.getType(), qck.getDomain(), callback, this, true );
       }
 
+      m_cache.getMetrics().setRefreshBacklog( 0 );
       m_running = false;
    }
 
@@ -18,6 +18,7 @@
 #include "einternal.h"
 #include "etbasic.h"
 #include "esynch2.h"
+#include "eqstats.h"
 
 Void EpcTools::Initialize(EGetOpt &options)
 {
@@ -26,6 +27,10 @@ Void EpcTools::Initialize(EGetOpt &options)
    m_public = options.get(MEMBER_ENABLE_PUBLIC_OBJECTS, false);
    options.setPrefix("");
 
+   // the shared memory options must be assigned before the public objects are created
+   ESharedMemory::loadDefaults(options);
+   EQueueStatistics::loadDefaults(options);
+
    EStatic::Initialize(options);
    EThreadBasic::Initialize();
 }
@@ -15,6 +15,7 @@
 * limitations under the License.
 */
 
+#include <algorithm>
 #include <string>
 #include <iostream>
 
@@ -28,6 +29,13 @@
 
 static Void copyall( msg_or_avp *from, msg_or_avp *to );
 
+static ULongLong fdMonotonicMicroseconds()
+{
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return (ULongLong)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 static Void copy( struct avp *from, msg_or_avp *to )
 {
    Int ret;
@@ -126,6 +134,233 @@ static Void copyall( msg_or_avp *from, msg_or_avp *to )
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+// every block is preceded by a header containing the size class,
+// 16 bytes to preserve the alignment returned by operator new
+#define FD_POOL_HEADER     16
+#define FD_POOL_CLASSES    ((Int)(FDObjectPool::MaxBlockSize / FDObjectPool::Granularity))
+#define FD_POOL_LARGE      0
+// the maximum number of batches held in the depot per size class
+#define FD_POOL_DEPOT_LIMIT 256
+
+struct FDPoolBlock
+{
+   FDPoolBlock *next;
+};
+
+static Void fdPoolFreeChain( FDPoolBlock *b )
+{
+   while ( b )
+   {
+      FDPoolBlock *next = b->next;
+      ::operator delete( b );
+      b = next;
+   }
+}
+
+class FDPoolDepot
+{
+public:
+   Void put( Int cls, FDPoolBlock *batch, Int count )
+   {
+      {
+         EMutexLock l( m_mutex );
+         if ( m_batches[cls].size() < FD_POOL_DEPOT_LIMIT )
+         {
+            m_batches[cls].push_back( std::make_pair( batch, count ) );
+            return;
+         }
+      }
+
+      fdPoolFreeChain( batch );
+   }
+
+   Int get( Int cls, FDPoolBlock *&batch )
+   {
+      EMutexLock l( m_mutex );
+
+      if ( m_batches[cls].empty() )
+      {
+         batch = NULL;
+         return 0;
+      }
+
+      batch = m_batches[cls].back().first;
+      Int count = m_batches[cls].back().second;
+      m_batches[cls].pop_back();
+
+      return count;
+   }
+
+private:
+   EMutexPrivate m_mutex;
+   std::vector< std::pair<FDPoolBlock*,Int> > m_batches[FD_POOL_CLASSES];
+};
+
+// the depot is never destroyed so that threads exiting during process
+// shutdown can still return their cached blocks
+static FDPoolDepot &fdPoolDepot()
+{
+   static FDPoolDepot *depot = new FDPoolDepot();
+   return *depot;
+}
+
+class FDPoolCache
+{
+public:
+   FDPoolCache()
+   {
+      for ( Int i = 0; i < FD_POOL_CLASSES; i++ )
+      {
+         m_lists[i].head = NULL;
+         m_lists[i].count = 0;
+      }
+   }
+
+   ~FDPoolCache()
+   {
+      for ( Int i = 0; i < FD_POOL_CLASSES; i++ )
+      {
+         if ( m_lists[i].head )
+            fdPoolDepot().put( i, m_lists[i].head, m_lists[i].count );
+      }
+   }
+
+   FDPoolBlock *pop( Int cls )
+   {
+      FreeList &fl = m_lists[cls];
+
+      if ( !fl.head )
+      {
+         fl.count = fdPoolDepot().get( cls, fl.head );
+         if ( !fl.head )
+            return NULL;
+      }
+
+      FDPoolBlock *b = fl.head;
+      fl.head = b->next;
+      fl.count--;
+
+      return b;
+   }
+
+   Void push( Int cls, FDPoolBlock *b )
+   {
+      FreeList &fl = m_lists[cls];
+
+      b->next = fl.head;
+      fl.head = b;
+
+      if ( ++fl.count > FDObjectPool::CacheLimit )
+      {
+         // move a batch of blocks to the depot
+         FDPoolBlock *batch = fl.head;
+         FDPoolBlock *last = batch;
+         for ( Int i = 1; i < FDObjectPool::BatchSize; i++ )
+            last = last->next;
+
+         fl.head = last->next;
+         fl.count -= FDObjectPool::BatchSize;
+         last->next = NULL;
+
+         fdPoolDepot().put( cls, batch, FDObjectPool::BatchSize );
+      }
+   }
+
+private:
+   struct FreeList
+   {
+      FDPoolBlock *head;
+      Int count;
+   };
+
+   FreeList m_lists[FD_POOL_CLASSES];
+};
+
+// the thread's cache is reached through trivially destructible thread local
+// values, so a block released by another thread local or static destructor
+// after the cache has been destroyed goes to the depot instead
+static thread_local FDPoolCache *fdPoolCacheThread = NULL;
+static thread_local Bool fdPoolCacheDestroyed = false;
+
+class FDPoolCacheOwner
+{
+public:
+   ~FDPoolCacheOwner()
+   {
+      FDPoolCache *cache = fdPoolCacheThread;
+
+      fdPoolCacheDestroyed = true;
+      fdPoolCacheThread = NULL;
+
+      delete cache;
+   }
+};
+
+static FDPoolCache *fdPoolCache()
+{
+   if ( !fdPoolCacheThread && !fdPoolCacheDestroyed )
+   {
+      static thread_local FDPoolCacheOwner owner;
+      (Void)owner;
+
+      fdPoolCacheThread = new FDPoolCache();
+   }
+
+   return fdPoolCacheThread;
+}
+
+pVoid FDObjectPool::allocate( size_t sz )
+{
+   size_t cls = sz ? ( sz + Granularity - 1 ) / Granularity : 1;
+   size_t *hdr;
+
+   if ( cls > (size_t)FD_POOL_CLASSES )
+   {
+      hdr = (size_t*)::operator new( sz + FD_POOL_HEADER );
+      *hdr = FD_POOL_LARGE;
+   }
+   else
+   {
+      FDPoolCache *cache = fdPoolCache();
+      hdr = cache ? (size_t*)cache->pop( (Int)cls - 1 ) : NULL;
+      if ( !hdr )
+         hdr = (size_t*)::operator new( cls * Granularity + FD_POOL_HEADER );
+      *hdr = cls;
+   }
+
+   return (pUChar)hdr + FD_POOL_HEADER;
+}
+
+Void FDObjectPool::release( pVoid p )
+{
+   if ( !p )
+      return;
+
+   size_t *hdr = (size_t*)( (pUChar)p - FD_POOL_HEADER );
+
+   if ( *hdr == FD_POOL_LARGE )
+   {
+      ::operator delete( hdr );
+      return;
+   }
+
+   Int cls = (Int)*hdr - 1;
+   FDPoolCache *cache = fdPoolCache();
+   if ( cache )
+   {
+      cache->push( cls, (FDPoolBlock*)hdr );
+   }
+   else
+   {
+      FDPoolBlock *b = (FDPoolBlock*)hdr;
+      b->next = NULL;
+      fdPoolDepot().put( cls, b, 1 );
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 FDEngine::FDEngine( const char *cfgfile )
 {
    if ( cfgfile )
@@ -1122,7 +1357,8 @@ FDMessage::FDMessage( Bool req2ans, FDDictionaryEntryCommand *de, struct msg *pm
    : m_de( de ),
      m_msg( pmsg ),
      m_dedel( dedel ),
-     m_msgdel( msgdel )
+     m_msgdel( msgdel ),
+     m_indexed( false )
 {
    Int ret;
 
@@ -1170,7 +1406,8 @@ FDMessage::FDMessage( FDDictionaryEntryCommand *de, struct msg *pmsg, Bool dedel
    : m_de( de ),
      m_msg( pmsg ),
      m_dedel( dedel ),
-     m_msgdel( true )
+     m_msgdel( true ),
+     m_indexed( false )
 {
    Int ret;
 
@@ -1189,7 +1426,8 @@ FDMessage::FDMessage( FDDictionaryEntryApplication *ade, FDDictionaryEntryComman
    : m_de( cde ),
      m_msg( pmsg ),
      m_dedel( dedel ),
-     m_msgdel( true )
+     m_msgdel( true ),
+     m_indexed( false )
 {
    Int ret;
 
@@ -1212,13 +1450,82 @@ FDMessage::~FDMessage()
       delete m_de;
 }
 
-FDAvp FDMessage::findAVP( FDDictionaryEntryAVP &de )
+Void FDMessage::buildIndex()
 {
    Int ret;
-   struct avp *a;
+   struct avp *loopavp;
+   struct avp_hdr *ah;
+
+   m_index.clear();
 
-   ret =  fd_msg_search_avp ( m_msg, de.getEntry(), &a );
+   ret = fd_msg_browse_internal( m_msg, MSG_BRW_FIRST_CHILD, (msg_or_avp**)&loopavp, NULL );
    if ( ret != 0 )
+      throw FDException(
+         EUtility::string_format("%s:%d - ERROR - browse returned %d direction MSG_BRW_FIRST_CHILD",
+         __FILE__, __LINE__, ret )
+      );
+
+   while ( loopavp )
+   {
+      ret = fd_msg_avp_hdr( loopavp, &ah );
+      if ( ret != 0 )
+         throw FDException(
+            EUtility::string_format("%s:%d - ERROR - error retrieving AVP header fd_msg_avp_hdr ret=%d",
+            __FILE__, __LINE__, ret )
+         );
+
+      m_index.push_back( FDAvpIndexEntry( indexKey( ah->avp_vendor, ah->avp_code ), loopavp ) );
+
+      ret = fd_msg_browse_internal( loopavp, MSG_BRW_NEXT, (msg_or_avp**)&loopavp, NULL );
+      if ( ret != 0 )
+         throw FDException(
+            EUtility::string_format("%s:%d - ERROR - browse returned %d direction MSG_BRW_NEXT",
+            __FILE__, __LINE__, ret )
+         );
+   }
+
+   // a stable sort preserves the message order of repeated AVP's
+   std::stable_sort( m_index.begin(), m_index.end(),
+      []( const FDAvpIndexEntry &a, const FDAvpIndexEntry &b ) { return a.first < b.first; } );
+
+   m_indexed = true;
+}
+
+struct avp *FDMessage::lookupAVP( FDDictionaryEntryAVP &de, Int occurrence )
+{
+   if ( !m_indexed )
+      buildIndex();
+
+   ULongLong key = indexKey( de.getVendorId(), de.getAvpCode() );
+   std::vector<FDAvpIndexEntry>::iterator it = std::lower_bound( m_index.begin(), m_index.end(), key,
+      []( const FDAvpIndexEntry &e, ULongLong k ) { return e.first < k; } );
+
+   if ( occurrence < 0 || m_index.end() - it <= occurrence )
+      return NULL;
+
+   it += occurrence;
+
+   return it->first == key ? it->second : NULL;
+}
+
+Int FDMessage::countAVP( FDDictionaryEntryAVP &de )
+{
+   if ( !m_indexed )
+      buildIndex();
+
+   ULongLong key = indexKey( de.getVendorId(), de.getAvpCode() );
+   std::pair<std::vector<FDAvpIndexEntry>::iterator,std::vector<FDAvpIndexEntry>::iterator> range =
+      std::equal_range( m_index.begin(), m_index.end(), FDAvpIndexEntry( key, NULL ),
+         []( const FDAvpIndexEntry &a, const FDAvpIndexEntry &b ) { return a.first < b.first; } );
+
+   return (Int)( range.second - range.first );
+}
+
+FDAvp FDMessage::findAVP( FDDictionaryEntryAVP &de )
+{
+   struct avp *a = lookupAVP( de );
+
+   if ( a == NULL )
       throw FDException(
          EUtility::string_format("%s:%d - ERROR - AVP not found for [%s] (vendor id %u)",
          __FILE__, __LINE__, de.getName(), de.getVendorId() )
@@ -1274,6 +1581,10 @@ FDMessage &FDMessage::sendRequest( Void (*anscb)(Void*,struct msg**), FDMessageR
 {
    Int ret;
 
+   // the message is owned by freeDiameter once it is sent
+   m_indexed = false;
+   m_index.clear();
+
    // send the message
    ret = fd_msg_send( &m_msg, anscb, &req );
    if ( ret != 0 )
@@ -1285,10 +1596,45 @@ FDMessage &FDMessage::sendRequest( Void (*anscb)(Void*,struct msg**), FDMessageR
    return *this;
 }
 
+FDMessage &FDMessage::sendRequest( Void (*anscb)(Void*,struct msg**),
+   Void (*expirecb)(Void*,DiamId_t,size_t,struct msg**), Long timeout, FDMessageRequest &req )
+{
+   Int ret;
+
+   // the message is owned by freeDiameter once it is sent
+   m_indexed = false;
+   m_index.clear();
+
+   // freeDiameter expects the absolute time the request expires
+   struct timespec ts;
+   clock_gettime( CLOCK_REALTIME, &ts );
+   ts.tv_sec += timeout / 1000;
+   ts.tv_nsec += ( timeout % 1000 ) * 1000000;
+   if ( ts.tv_nsec >= 1000000000 )
+   {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
+   }
+
+   // send the message
+   ret = fd_msg_send_timeout( &m_msg, anscb, &req, expirecb, &ts );
+   if ( ret != 0 )
+      throw FDException(
+         EUtility::string_format("%s:%d - INFO - error attempting to send request message ret=%d",
+         __FILE__, __LINE__, ret )
+      );
+
+   return *this;
+}
+
 FDMessage &FDMessage::sendAnswer()
 {
    Int ret;
 
+   // the message is owned by freeDiameter once it is sent
+   m_indexed = false;
+   m_index.clear();
+
    // send the message
    ret = fd_msg_send( &m_msg, NULL, NULL );
    if ( ret != 0 )
@@ -1302,6 +1648,8 @@ FDMessage &FDMessage::sendAnswer()
 
 Void FDMessage::addOrigin()
 {
+   m_indexed = false;
+
    Int ret = fd_msg_add_origin( m_msg, 0 );
    if ( ret != 0 )
       throw FDException(
@@ -1312,6 +1660,8 @@ Void FDMessage::addOrigin()
 
 FDMessage &FDMessage::add( FDExtractor &e )
 {
+   m_indexed = false;
+
    if ( e.exists() )
    {
       copy( (struct avp *)e.getReference(), getMsg() );
@@ -1334,6 +1684,8 @@ FDMessage &FDMessage::add( FDExtractorList &el )
 
 FDMessage &FDMessage::add( FDExtractorAvp &ea )
 {
+   m_indexed = false;
+
    if ( ea.exists() )
    {
       copy( ea.getAvp(), getMsg() );
@@ -1356,6 +1708,7 @@ FDMessage &FDMessage::add( FDExtractorAvpList &eal )
 
 FDMessage &FDMessage::addJson( const char *json )
 {
+   m_indexed = false;
    fdJsonAddAvps( json, getMsg(), NULL );
 
    return *this;
@@ -1404,7 +1757,11 @@ FDMessageAnswer &FDMessageAnswer::send()
 ////////////////////////////////////////////////////////////////////////////////
 
 FDMessageRequest::FDMessageRequest( FDDictionaryEntryCommand *cde )
-   : FDMessage( cde )
+   : FDMessage( cde ),
+     m_throttle( NULL ),
+     m_router( NULL ),
+     m_answer( NULL ),
+     m_next( NULL )
 {
    if ( cde->isAnswer() )
       throw FDException(
@@ -1414,7 +1771,11 @@ FDMessageRequest::FDMessageRequest( FDDictionaryEntryCommand *cde )
 }
 
 FDMessageRequest::FDMessageRequest( FDDictionaryEntryCommand *cde, struct msg *pmsg )
-   : FDMessage( cde, pmsg )
+   : FDMessage( cde, pmsg ),
+     m_throttle( NULL ),
+     m_router( NULL ),
+     m_answer( NULL ),
+     m_next( NULL )
 {
    if ( cde->isAnswer() )
       throw FDException(
@@ -1424,7 +1785,11 @@ FDMessageRequest::FDMessageRequest( FDDictionaryEntryCommand *cde, struct msg *p
 }
 
 FDMessageRequest::FDMessageRequest( FDDictionaryEntryApplication *ade, FDDictionaryEntryCommand *cde )
-   : FDMessage( ade, cde )
+   : FDMessage( ade, cde ),
+     m_throttle( NULL ),
+     m_router( NULL ),
+     m_answer( NULL ),
+     m_next( NULL )
 {
    if ( cde->isAnswer() )
       throw FDException(
@@ -1439,11 +1804,54 @@ FDMessageRequest::~FDMessageRequest()
 
 FDMessageRequest &FDMessageRequest::send()
 {
+   struct msg_hdr *hdr;
+   Int ret = fd_msg_hdr( getMsg(), &hdr );
+   if ( ret != 0 )
+      throw FDException(
+         EUtility::string_format("%s:%d - ERROR - Error retrieving message header fd_msg_hdr ret=%d",
+         __FILE__, __LINE__, ret )
+      );
+
+   FDThrottle *throttle = FDOverloadControl::findThrottle( hdr->msg_appl );
+   if ( throttle )
+   {
+      if ( !throttle->acquire() )
+         throw FDThrottleException(
+            EUtility::string_format("%s:%d - INFO - request throttled for application %u",
+            __FILE__, __LINE__, hdr->msg_appl )
+         );
+      m_throttle = throttle;
+   }
+
    m_timer.Start();
-   sendRequest( anscb, *this );
+
+   try
+   {
+      // a request holding throttle capacity expires so that the capacity
+      // is released even if the request is never answered
+      if ( m_throttle )
+         sendRequest( anscb, expirecb, m_throttle->getRequestTimeout(), *this );
+      else
+         sendRequest( anscb, *this );
+   }
+   catch ( ... )
+   {
+      releaseThrottle();
+      throw;
+   }
+
    return *this;
 }
 
+Void FDMessageRequest::releaseThrottle()
+{
+   // the answer and expiry callbacks are exclusive, the exchange ensures
+   // the capacity is released exactly once regardless
+   FDThrottle *throttle = __atomic_exchange_n( &m_throttle, (FDThrottle*)NULL, __ATOMIC_ACQ_REL );
+   if ( throttle )
+      throttle->release();
+}
+
 Void FDMessageRequest::processAnswer( FDMessageAnswer &ans )
 {
 }
@@ -1453,33 +1861,155 @@ Void FDMessageRequest::anscb( Void * data, struct msg ** pmsg )
    // set the "this" pointer
    FDMessageRequest *pthis = (FDMessageRequest*)data;
 
+   pthis->releaseThrottle();
+
+   if ( pthis->m_router )
+   {
+      // the answer will be processed by the thread associated with the router
+      pthis->m_router->queueAnswer( pthis, *pmsg );
+      *pmsg = NULL;
+   }
+   else
+   {
+      pthis->deliverAnswer( pmsg );
+   }
+}
+
+Void FDMessageRequest::expirecb( Void * data, DiamId_t sentto, size_t senttolen, struct msg ** pmsg )
+{
+   // the request was not answered in time, freeDiameter frees the request
+   FDMessageRequest *pthis = (FDMessageRequest*)data;
+
+   pthis->releaseThrottle();
+}
+
+Void FDMessageRequest::deliverAnswer( struct msg ** pmsg )
+{
    // construct the FDMessageAnswer object
-   //FDDictionaryEntryCommand anscmd( *pthis->getCommand() );
-   if (pthis->getPreserveAnswer())
+   //FDDictionaryEntryCommand anscmd( *getCommand() );
+   if (getPreserveAnswer())
    {
-      FDMessageAnswer *ans = new FDMessageAnswer( pthis, *pmsg );
+      FDMessageAnswer *ans = new FDMessageAnswer( this, *pmsg );
       // process the answer
-      pthis->processAnswer( *ans );
+      processAnswer( *ans );
       // clear the pmsg pointer, it will be freed by the FDMessageAnswer destructor
       *pmsg = NULL;
    }
    else
    {
-      FDMessageAnswer ans( pthis, *pmsg );
+      FDMessageAnswer ans( this, *pmsg );
       // process the answer
-      pthis->processAnswer( ans );
+      processAnswer( ans );
       // clear the pmsg pointer, it will be freed by the FDMessageAnswer destructor
       *pmsg = NULL;
    }
    
    // free the request now that the answer has been processed
-   //delete pthis;
+   //delete this;
    // this no longer needs to be done since it will be released by the FDMessageAnswer destructor
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+FDAnswerRouter::FDAnswerRouter()
+   : m_thread( NULL ),
+     m_msg( NULL ),
+     m_head( NULL ),
+     m_tail( NULL ),
+     m_pending( 0 )
+{
+}
+
+FDAnswerRouter::~FDAnswerRouter()
+{
+   if ( m_msg )
+   {
+      m_thread->_destroyMessage( m_msg );
+      m_msg = NULL;
+   }
+   m_thread = NULL;
+}
+
+Void FDAnswerRouter::init( _EThreadEventBase *thread, _EThreadEventMessageBase *msg )
+{
+   if ( m_msg )
+      m_thread->_destroyMessage( m_msg );
+
+   m_thread = thread;
+   m_msg = msg;
+}
+
+Void FDAnswerRouter::queueAnswer( FDMessageRequest *req, struct msg *ans )
+{
+   // called on a freeDiameter thread, so process the answer
+   // in place if the router has not been associated with a thread
+   if ( !m_thread )
+   {
+      req->deliverAnswer( &ans );
+      return;
+   }
+
+   Bool post;
+
+   req->m_answer = ans;
+   req->m_next = NULL;
+
+   {
+      EMutexLock l( m_mutex );
+
+      if ( m_tail )
+         m_tail->m_next = req;
+      else
+         m_head = req;
+      m_tail = req;
+
+      // only post the event if the thread has not been notified
+      post = m_pending++ == 0;
+   }
+
+   if ( post && !m_thread->_sendMessage( *m_msg ) )
+   {
+      // the thread was not notified, so the next answer must post the event
+      EMutexLock l( m_mutex );
+      m_pending = 0;
+   }
+}
+
+Int FDAnswerRouter::processAnswers()
+{
+   FDMessageRequest *req;
+   Int cnt = 0;
+
+   {
+      EMutexLock l( m_mutex );
+
+      req = m_head;
+      m_head = NULL;
+      m_tail = NULL;
+      m_pending = 0;
+   }
+
+   while ( req )
+   {
+      // the request is deleted after the answer has been processed
+      FDMessageRequest *next = req->m_next;
+      struct msg *ans = req->m_answer;
+
+      req->m_next = NULL;
+      req->m_answer = NULL;
+      req->deliverAnswer( &ans );
+
+      req = next;
+      cnt++;
+   }
+
+   return cnt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 FDCommand::FDCommand( FDDictionaryEntryCommand &de )
    : m_de( de )
 {
@@ -1660,6 +2190,200 @@ Void FDSession::init()
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+// the longest time a queued sender sleeps before checking for tokens again
+#define FD_THROTTLE_POLL_MS 10
+
+FDThrottle::FDThrottle()
+   : m_maxinflight( 0 ),
+     m_rate( 0.0 ),
+     m_burst( 0.0 ),
+     m_policy( TPFastFail ),
+     m_maxwait( 0 ),
+     m_requesttimeout( 30000 ),
+     m_inflight( 0 ),
+     m_rejected( 0 ),
+     m_tokens( 0.0 ),
+     m_lastrefill( 0 ),
+     m_reduction( 0 ),
+     m_reductionexpires( 0 ),
+     m_reductionseq( 0 ),
+     m_abatecnt( 0 ),
+     m_released( NULL )
+{
+}
+
+FDThrottle::~FDThrottle()
+{
+   if ( m_released )
+      delete m_released;
+}
+
+FDThrottle &FDThrottle::setRate( Double rate, Int burst )
+{
+   EMutexLock l( m_bucketmutex );
+
+   m_rate = rate > 0.0 ? rate : 0.0;
+   m_burst = burst > 0 ? burst : ( m_rate > 1.0 ? m_rate : 1.0 );
+   m_tokens = m_burst;
+   m_lastrefill = fdMonotonicMicroseconds();
+
+   return *this;
+}
+
+FDThrottle &FDThrottle::setPolicy( FDThrottlePolicy policy, Long maxwait )
+{
+   m_policy = policy;
+   m_maxwait = maxwait;
+
+   if ( m_policy == TPQueue && !m_released )
+      m_released = new EEvent();
+
+   return *this;
+}
+
+Bool FDThrottle::setReduction( Int percent, Long validity, ULongLong seqnum )
+{
+   // ignore a report unless it is newer than the one being applied (RFC 7683),
+   // so a repeated report does not extend the validity of the current one
+   if ( seqnum <= m_reductionseq.load( std::memory_order_relaxed ) && getReduction() != 0 )
+      return False;
+
+   m_reductionseq = seqnum;
+   m_reductionexpires = fdMonotonicMicroseconds() + (ULongLong)( validity > 0 ? validity : 0 ) * 1000;
+   m_reduction = percent < 0 ? 0 : percent > 100 ? 100 : percent;
+
+   return True;
+}
+
+Int FDThrottle::getReduction()
+{
+   Int reduction = m_reduction.load( std::memory_order_relaxed );
+
+   if ( reduction && fdMonotonicMicroseconds() >= m_reductionexpires.load( std::memory_order_relaxed ) )
+   {
+      // the report has expired
+      m_reduction = 0;
+      reduction = 0;
+   }
+
+   return reduction;
+}
+
+Bool FDThrottle::abate()
+{
+   Int reduction = getReduction();
+
+   if ( reduction == 0 )
+      return False;
+
+   // reject "reduction" out of every 100 requests, spread evenly
+   ULongLong n = m_abatecnt.fetch_add( 1, std::memory_order_relaxed );
+   return ( ( n + 1 ) * reduction ) / 100 != ( n * reduction ) / 100;
+}
+
+Bool FDThrottle::takeToken( Bool peek )
+{
+   if ( m_rate <= 0.0 )
+      return True;
+
+   EMutexLock l( m_bucketmutex );
+
+   ULongLong now = fdMonotonicMicroseconds();
+   m_tokens += ( now - m_lastrefill ) * m_rate / 1000000.0;
+   if ( m_tokens > m_burst )
+      m_tokens = m_burst;
+   m_lastrefill = now;
+
+   if ( m_tokens < 1.0 )
+      return False;
+
+   if ( !peek )
+      m_tokens -= 1.0;
+
+   return True;
+}
+
+Bool FDThrottle::isAvailable()
+{
+   return ( m_maxinflight <= 0 || getInflight() < m_maxinflight ) && takeToken( True );
+}
+
+Bool FDThrottle::tryAcquire()
+{
+   if ( m_maxinflight > 0 )
+   {
+      if ( m_inflight.fetch_add( 1, std::memory_order_relaxed ) >= m_maxinflight )
+      {
+         m_inflight.fetch_sub( 1, std::memory_order_relaxed );
+         return False;
+      }
+   }
+   else
+   {
+      m_inflight.fetch_add( 1, std::memory_order_relaxed );
+   }
+
+   if ( !takeToken( False ) )
+   {
+      m_inflight.fetch_sub( 1, std::memory_order_relaxed );
+      return False;
+   }
+
+   return True;
+}
+
+Bool FDThrottle::acquire()
+{
+   if ( abate() )
+   {
+      m_rejected.fetch_add( 1, std::memory_order_relaxed );
+      return False;
+   }
+
+   if ( tryAcquire() )
+      return True;
+
+   if ( m_policy == TPQueue && m_released && m_maxwait > 0 )
+   {
+      ULongLong expires = fdMonotonicMicroseconds() + (ULongLong)m_maxwait * 1000;
+
+      while ( True )
+      {
+         m_released->reset();
+
+         if ( tryAcquire() )
+            return True;
+
+         ULongLong now = fdMonotonicMicroseconds();
+         if ( now >= expires )
+            break;
+
+         ULongLong remaining = ( expires - now ) / 1000;
+         m_released->wait( remaining < FD_THROTTLE_POLL_MS ? (int)remaining + 1 : FD_THROTTLE_POLL_MS );
+      }
+   }
+
+   m_rejected.fetch_add( 1, std::memory_order_relaxed );
+   return False;
+}
+
+Void FDThrottle::consume()
+{
+   m_inflight.fetch_add( 1, std::memory_order_relaxed );
+   takeToken( False );
+}
+
+Void FDThrottle::release()
+{
+   m_inflight.fetch_sub( 1, std::memory_order_relaxed );
+
+   if ( m_released )
+      m_released->set();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 FDPeer::FDPeer()
 {
    init();
@@ -1801,6 +2525,21 @@ Void FDPeer::init()
 {
    m_port = 3868;
    m_peer = NULL;
+   m_latency = 0;
+}
+
+Void FDPeer::answerReceived( ULongLong latency )
+{
+   m_throttle.release();
+
+   // exponentially weighted moving average, alpha = 1/8
+   ULongLong cur = m_latency.load( std::memory_order_relaxed );
+   ULongLong val;
+   do
+   {
+      val = cur == 0 ? latency : cur - ( cur >> 3 ) + ( latency >> 3 );
+   }
+   while ( !m_latency.compare_exchange_weak( cur, val, std::memory_order_relaxed ) );
 }
 
 Void FDPeer::peercb( struct peer_info *pi, Void *data )
@@ -1854,6 +2593,34 @@ FDPeer *FDPeerList::getOpenPeer()
    return NULL;
 }
 
+FDPeer *FDPeerList::getLeastLoadedPeer()
+{
+   FDPeer *best = NULL;
+
+   for ( FDPeerList::iterator it = begin();
+         it != end();
+         ++it )
+   {
+      if ( (*it)->isOpen() && ( !best || (*it)->getLoad() < best->getLoad() ) )
+         best = *it;
+   }
+
+   return best;
+}
+
+FDPeer *FDPeerList::findPeer( DiamId_t diamid, size_t len )
+{
+   for ( FDPeerList::iterator it = begin();
+         it != end();
+         ++it )
+   {
+      if ( (*it)->isPeer( diamid, len ) )
+         return *it;
+   }
+
+   return NULL;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -1888,7 +2655,25 @@ FDExtractor::~FDExtractor()
 Void FDExtractor::add( FDExtractorBase &base )
 {
    FDExtractorKey k( base.getDictionaryEntry()->getVendorId(), base.getDictionaryEntry()->getAvpCode() );
-   m_entries[k] = &base;
+
+   // keep the entries sorted by vendor id and avp code
+   std::vector<FDExtractorEntry>::iterator it = std::lower_bound( m_entries.begin(), m_entries.end(), k,
+      []( const FDExtractorEntry &e, const FDExtractorKey &k ) { return e.first < k; } );
+
+   if ( it != m_entries.end() && !(k < it->first) )
+      it->second = &base;
+   else
+      m_entries.insert( it, FDExtractorEntry( k, &base ) );
+}
+
+FDExtractorBase *FDExtractor::findEntry( vendor_id_t vndid, avp_code_t avpcode )
+{
+   FDExtractorKey k( vndid, avpcode );
+
+   std::vector<FDExtractorEntry>::iterator it = std::lower_bound( m_entries.begin(), m_entries.end(), k,
+      []( const FDExtractorEntry &e, const FDExtractorKey &k ) { return e.first < k; } );
+
+   return it != m_entries.end() && !(k < it->first) ? it->second : NULL;
 }
 
 Bool FDExtractor::exists( Bool skipResolve )
@@ -1958,8 +2743,7 @@ Void FDExtractor::resolve()
          );
 
       struct avp_hdr *ah;
-      FDExtractorKey key;
-      std::map<FDExtractorKey,FDExtractorBase*>::iterator it;
+      FDExtractorBase *entry;
 
       while ( loopavp )
       {
@@ -1971,19 +2755,15 @@ Void FDExtractor::resolve()
                __FILE__, __LINE__, ret )
             );
    
-         // set the vendor id and avp code in the key
-         key.setVendor( ah->avp_vendor );
-         key.setAvpCode( ah->avp_code );
-      
          // lookup up the entry
-         if ( (it = m_entries.find(key)) != m_entries.end() )
+         if ( (entry = findEntry( ah->avp_vendor, ah->avp_code )) != NULL )
          {
 
-            switch ( it->second->getExtractorType() )
+            switch ( entry->getExtractorType() )
             {
                case etAvp:
                {
-                  FDExtractorAvp *a = (FDExtractorAvp*)it->second;
+                  FDExtractorAvp *a = (FDExtractorAvp*)entry;
                   a->setIndex( m_index++ );
                   a->setResolved();
                   a->setAvp( (struct avp *)loopavp );
@@ -1991,29 +2771,27 @@ Void FDExtractor::resolve()
                }
                case etAvpList:
                {
-                  FDExtractorAvpList *al = (FDExtractorAvpList*)it->second;
-                  FDExtractorAvp *a = new FDExtractorAvp( *this, *al->getDictionaryEntry() );
+                  FDExtractorAvpList *al = (FDExtractorAvpList*)entry;
+                  FDExtractorAvp *a = al->nextAvp();
                   a->setIndex( m_index++ );
                   a->setResolved();
                   a->setAvp( (struct avp *)loopavp );
-                  al->getList().push_back( a );
                   al->setResolved();
                   break;
                }
                case etExtractor:
                {
-                  FDExtractor *e = (FDExtractor*)it->second;
+                  FDExtractor *e = (FDExtractor*)entry;
                   e->setIndex( m_index++ );
                   e->setReference( loopavp );
                   break;
                }
                case etExtractorList:
                {
-                  FDExtractorList *el = (FDExtractorList*)it->second;
-                  FDExtractor *e = el->createExtractor();
+                  FDExtractorList *el = (FDExtractorList*)entry;
+                  FDExtractor *e = el->nextExtractor();
                   e->setIndex( m_index++ );
                   e->setReference( loopavp );
-                  el->getList().push_back( e );
                   el->setResolved();
                   break;
                }
@@ -2033,6 +2811,55 @@ Void FDExtractor::resolve()
 //   setResolved();
 }
 
+Void FDExtractor::reset()
+{
+   setResolved( false );
+   setIndex( -1 );
+   m_reference = NULL;
+   m_index = 1;
+
+   for ( std::vector<FDExtractorEntry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it )
+   {
+      switch ( it->second->getExtractorType() )
+      {
+         case etAvp:             { ((FDExtractorAvp*)it->second)->reset(); break; }
+         case etAvpList:         { ((FDExtractorAvpList*)it->second)->reset(); break; }
+         case etExtractor:       { ((FDExtractor*)it->second)->reset(); break; }
+         case etExtractorList:   { ((FDExtractorList*)it->second)->reset(); break; }
+      }
+   }
+}
+
+Void FDExtractor::resolveAll()
+{
+   resolve();
+
+   for ( std::vector<FDExtractorEntry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it )
+   {
+      switch ( it->second->getExtractorType() )
+      {
+         case etExtractor:
+         {
+            FDExtractor *e = (FDExtractor*)it->second;
+            if ( e->FDExtractorBase::exists() )
+               e->resolveAll();
+            break;
+         }
+         case etExtractorList:
+         {
+            FDExtractorList *el = (FDExtractorList*)it->second;
+            for ( std::list<FDExtractor*>::iterator eit = el->m_list.begin(); eit != el->m_list.end(); ++eit )
+               (*eit)->resolveAll();
+            break;
+         }
+         default:
+         {
+            break;
+         }
+      }
+   }
+}
+
 Void FDExtractor::dump()
 {
    if ( !getResolved() )
@@ -2085,6 +2912,38 @@ FDExtractorList::~FDExtractorList()
       delete *it;
       m_list.pop_front();
    }
+
+   while ( (it = m_free.begin()) != m_free.end() )
+   {
+      delete *it;
+      m_free.pop_front();
+   }
+}
+
+Void FDExtractorList::reset()
+{
+   setResolved( false );
+   setIndex( -1 );
+
+   for ( std::list<FDExtractor*>::iterator it = m_list.begin(); it != m_list.end(); ++it )
+      (*it)->reset();
+
+   m_free.splice( m_free.end(), m_list );
+}
+
+FDExtractor *FDExtractorList::nextExtractor()
+{
+   if ( m_free.empty() )
+   {
+      m_list.push_back( createExtractor() );
+   }
+   else
+   {
+      // move the list node along with the extractor, no allocation required
+      m_list.splice( m_list.end(), m_free, m_free.begin() );
+   }
+
+   return m_list.back();
 }
 
 Void FDExtractorList::addExtractor( FDExtractor *e )
@@ -2118,6 +2977,13 @@ FDExtractorAvp::~FDExtractorAvp()
 {
 }
 
+Void FDExtractorAvp::reset()
+{
+   setResolved( false );
+   setIndex( -1 );
+   m_avp.detach();
+}
+
 Bool FDExtractorAvp::exists()
 {
    if ( !getResolved() )
@@ -2159,6 +3025,38 @@ FDExtractorAvpList::~FDExtractorAvpList()
       delete *it;
       m_list.pop_front();
    }
+
+   while ( (it = m_free.begin()) != m_free.end() )
+   {
+      delete *it;
+      m_free.pop_front();
+   }
+}
+
+Void FDExtractorAvpList::reset()
+{
+   setResolved( false );
+   setIndex( -1 );
+
+   for ( std::list<FDExtractorAvp*>::iterator it = m_list.begin(); it != m_list.end(); ++it )
+      (*it)->reset();
+
+   m_free.splice( m_free.end(), m_list );
+}
+
+FDExtractorAvp *FDExtractorAvpList::nextAvp()
+{
+   if ( m_free.empty() )
+   {
+      m_list.push_back( new FDExtractorAvp( *m_parent, *getDictionaryEntry() ) );
+   }
+   else
+   {
+      // move the list node along with the extractor, no allocation required
+      m_list.splice( m_list.end(), m_free, m_free.begin() );
+   }
+
+   return m_list.back();
 }
 
 Bool FDExtractorAvpList::exists()
@@ -2202,6 +3100,13 @@ Bool FDHook::registerHook(UInt hookmask)
    return fd_hook_register( m_hookmask, FDHook::hook_cb, this, NULL, &m_hdl ) == 0;
 }
 
+Bool FDHook::registerHook(UInt hookmask, struct fd_hook_data_hdl *datahdl)
+{
+   m_hookmask = hookmask;
+
+   return fd_hook_register( m_hookmask, FDHook::hook_cb, this, datahdl, &m_hdl ) == 0;
+}
+
 Void FDHook::unregisterHook()
 {
    if (m_hdl)
@@ -2225,6 +3130,364 @@ Void FDHook::hook_cb(enum fd_hook_type type, struct msg * msg, struct peer_hdr *
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+// the per message data that freeDiameter associates with each request
+struct FDPeerLoadData
+{
+   ULongLong sent;
+   FDPeer *peer;
+};
+
+// releases the in-flight count of a request that will not be answered
+static Void fdPeerLoadAbandoned( FDPeerLoadData *req )
+{
+   if ( req && req->sent && req->peer )
+   {
+      req->peer->requestFailed();
+      req->sent = 0;
+      req->peer = NULL;
+   }
+}
+
+// called by freeDiameter when a request is freed, including requests that
+// timed out or were discarded without an answer being received
+static Void fdPeerLoadFini( struct fd_hook_permsgdata *pmd )
+{
+   fdPeerLoadAbandoned( (FDPeerLoadData*)pmd );
+}
+
+// the maximum number of equally scored candidates that are considered
+#define FD_LB_MAX_CANDIDATES 64
+
+FDPeerLoadBalancer::FDPeerLoadBalancer( FDPeerList &peers )
+   : m_peers( peers ),
+     m_datahdl( NULL ),
+     m_rthdl( NULL ),
+     m_seed( fdMonotonicMicroseconds() )
+{
+}
+
+FDPeerLoadBalancer::~FDPeerLoadBalancer()
+{
+   stop();
+}
+
+Bool FDPeerLoadBalancer::start( Int priority )
+{
+   // freeDiameter does not support unregistering a data handle, so it is reused
+   if ( !m_datahdl && fd_hook_data_register( sizeof(FDPeerLoadData), NULL, fdPeerLoadFini, &m_datahdl ) != 0 )
+      return False;
+
+   if ( !registerHook( HOOK_MASK( HOOK_MESSAGE_SENDING, HOOK_MESSAGE_RECEIVED, HOOK_MESSAGE_FAILOVER, HOOK_MESSAGE_DROPPED ), m_datahdl ) )
+      return False;
+
+   if ( fd_rt_out_register( rtOut, this, priority, &m_rthdl ) != 0 )
+   {
+      unregisterHook();
+      m_rthdl = NULL;
+      return False;
+   }
+
+   return True;
+}
+
+Void FDPeerLoadBalancer::stop()
+{
+   if ( m_rthdl )
+   {
+      fd_rt_out_unregister( m_rthdl, NULL );
+      m_rthdl = NULL;
+   }
+
+   unregisterHook();
+}
+
+Void FDPeerLoadBalancer::process(enum fd_hook_type type, struct msg * msg,
+   struct peer_hdr * peer, Void * other, struct fd_hook_permsgdata *pmd)
+{
+   struct msg_hdr *hdr = NULL;
+
+   // a dropped message may not be associated with a peer, so the peer that
+   // the request was counted against is taken from the per message data
+   if ( type == HOOK_MESSAGE_DROPPED )
+   {
+      if ( msg && !fd_msg_hdr( msg, &hdr ) && (hdr->msg_flags & CMD_FLAG_REQUEST) == CMD_FLAG_REQUEST )
+         fdPeerLoadAbandoned( (FDPeerLoadData*)pmd );
+      return;
+   }
+
+   if ( !msg || !peer || fd_msg_hdr( msg, &hdr ) )
+      return;
+
+   FDPeer *p = m_peers.findPeer( peer->info.pi_diamid, peer->info.pi_diamidlen );
+   if ( !p )
+      return;
+
+   Bool isRequest = (hdr->msg_flags & CMD_FLAG_REQUEST) == CMD_FLAG_REQUEST;
+
+   switch ( type )
+   {
+      case HOOK_MESSAGE_SENDING:
+      {
+         if ( isRequest && pmd )
+         {
+            ((FDPeerLoadData*)pmd)->sent = fdMonotonicMicroseconds();
+            ((FDPeerLoadData*)pmd)->peer = p;
+            p->requestSent();
+         }
+         break;
+      }
+      case HOOK_MESSAGE_RECEIVED:
+      {
+         if ( !isRequest )
+         {
+            FDPeerLoadData *req = (FDPeerLoadData*)fd_hook_get_request_pmd( m_datahdl, msg );
+
+            // only answers to requests that were counted are recorded
+            if ( req && req->sent )
+            {
+               ULongLong now = fdMonotonicMicroseconds();
+               p->answerReceived( now > req->sent ? now - req->sent : 0 );
+               req->sent = 0;
+               req->peer = NULL;
+            }
+         }
+         break;
+      }
+      case HOOK_MESSAGE_FAILOVER:
+      {
+         // the request will be resent to another peer
+         fdPeerLoadAbandoned( (FDPeerLoadData*)pmd );
+         break;
+      }
+      default:
+      {
+         break;
+      }
+   }
+}
+
+UInt FDPeerLoadBalancer::random()
+{
+   // splitmix64
+   ULongLong z = m_seed.fetch_add( 0x9e3779b97f4a7c15ULL, std::memory_order_relaxed ) + 0x9e3779b97f4a7c15ULL;
+   z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+   z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+   return (UInt)( z ^ ( z >> 31 ) );
+}
+
+int FDPeerLoadBalancer::rtOut( Void *cbdata, struct msg **pmsg, struct fd_list *candidates )
+{
+   FDPeerLoadBalancer *ths = (FDPeerLoadBalancer*)cbdata;
+   struct rtd_candidate *best[FD_LB_MAX_CANDIDATES];
+   FDPeer *peers[FD_LB_MAX_CANDIDATES];
+   Int cnt = 0;
+   int score = 0;
+
+   // collect the known peers that share the best positive score
+   for ( struct fd_list *li = candidates->next; li != candidates; li = li->next )
+   {
+      struct rtd_candidate *c = (struct rtd_candidate *)li;
+
+      if ( c->score <= 0 || c->score < score )
+         continue;
+
+      FDPeer *p = ths->m_peers.findPeer( c->diamid, c->diamidlen );
+      if ( !p )
+         continue;
+
+      // divert the request away from a peer that is at its limits or fully
+      // overloaded, a partial reduction is applied once the peer is chosen
+      if ( !p->getThrottle().isAvailable() || p->getThrottle().getReduction() >= 100 )
+      {
+         c->score = FD_SCORE_NO_DELIVERY;
+         continue;
+      }
+
+      if ( c->score > score )
+      {
+         score = c->score;
+         cnt = 0;
+      }
+
+      if ( cnt < FD_LB_MAX_CANDIDATES )
+      {
+         best[cnt] = c;
+         peers[cnt] = p;
+         cnt++;
+      }
+   }
+
+   while ( cnt > 0 )
+   {
+      Int choice = 0;
+
+      if ( cnt > 1 )
+      {
+         // power of two choices
+         Int a = ths->random() % cnt;
+         Int b = ths->random() % ( cnt - 1 );
+         if ( b >= a )
+            b++;
+
+         choice = peers[a]->getLoad() <= peers[b]->getLoad() ? a : b;
+      }
+
+      // the overload reduction counts this request against the chosen peer only
+      if ( !peers[choice]->getThrottle().abate() )
+      {
+         if ( cnt > 1 )
+            best[choice]->score += FD_SCORE_LOAD_BALANCE;
+         break;
+      }
+
+      // divert the request and choose again from the remaining peers
+      best[choice]->score = FD_SCORE_NO_DELIVERY;
+      cnt--;
+      best[choice] = best[cnt];
+      peers[choice] = peers[cnt];
+   }
+
+   return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// DOIC (RFC 7683) AVP codes
+#define FD_AVP_OC_OLR                  623
+#define FD_AVP_OC_SEQUENCE_NUMBER      624
+#define FD_AVP_OC_VALIDITY_DURATION    625
+#define FD_AVP_OC_REPORT_TYPE          626
+#define FD_AVP_OC_REDUCTION_PERCENTAGE 627
+
+#define FD_OC_HOST_REPORT              0
+#define FD_OC_REALM_REPORT             1
+#define FD_OC_DEFAULT_VALIDITY         30
+
+FDOverloadControl::OverloadHook FDOverloadControl::m_hook;
+FDPeerList *FDOverloadControl::m_peers = NULL;
+ERWLock FDOverloadControl::m_lock;
+std::map<UInt,FDThrottle*> FDOverloadControl::m_throttles;
+
+Void FDOverloadControl::init( FDPeerList *peers )
+{
+   m_peers = peers;
+   m_hook.registerHook( HOOK_MASK( HOOK_MESSAGE_RECEIVED ) );
+}
+
+Void FDOverloadControl::uninit()
+{
+   m_hook.unregisterHook();
+   m_peers = NULL;
+}
+
+FDThrottle &FDOverloadControl::getThrottle( UInt appid )
+{
+   FDThrottle *t = findThrottle( appid );
+   if ( t )
+      return *t;
+
+   EWRLock l( m_lock );
+
+   std::map<UInt,FDThrottle*>::iterator it = m_throttles.find( appid );
+   if ( it != m_throttles.end() )
+      return *it->second;
+
+   t = new FDThrottle();
+   m_throttles[appid] = t;
+
+   return *t;
+}
+
+FDThrottle *FDOverloadControl::findThrottle( UInt appid )
+{
+   ERDLock l( m_lock );
+
+   std::map<UInt,FDThrottle*>::iterator it = m_throttles.find( appid );
+   return it != m_throttles.end() ? it->second : NULL;
+}
+
+/// @cond DOXYGEN_EXCLUDE
+
+Void FDOverloadControl::OverloadHook::process(enum fd_hook_type type, struct msg * msg,
+   struct peer_hdr * peer, Void * other, struct fd_hook_permsgdata *pmd)
+{
+   struct msg_hdr *hdr = NULL;
+   struct avp *a = NULL;
+   struct avp_hdr *ah;
+   int ret;
+
+   if ( !msg || fd_msg_hdr( msg, &hdr ) || ( hdr->msg_flags & CMD_FLAG_REQUEST ) )
+      return;
+
+   // locate the OC-OLR AVP
+   for ( ret = fd_msg_browse_internal( msg, MSG_BRW_FIRST_CHILD, (msg_or_avp**)&a, NULL );
+         ret == 0 && a;
+         ret = fd_msg_browse_internal( a, MSG_BRW_NEXT, (msg_or_avp**)&a, NULL ) )
+   {
+      if ( fd_msg_avp_hdr( a, &ah ) == 0 && ah->avp_vendor == 0 && ah->avp_code == FD_AVP_OC_OLR )
+         break;
+   }
+
+   if ( ret != 0 || !a )
+      return;
+
+   struct fd_pei ei;
+   if ( fd_msg_parse_dict( a, fd_g_config->cnf_dict, &ei ) != 0 )
+      return;
+
+   ULongLong seqnum = 0;
+   Int reporttype = FD_OC_HOST_REPORT;
+   Int reduction = 0;
+   Long validity = FD_OC_DEFAULT_VALIDITY;
+   struct avp *child = NULL;
+
+   for ( ret = fd_msg_browse_internal( a, MSG_BRW_FIRST_CHILD, (msg_or_avp**)&child, NULL );
+         ret == 0 && child;
+         ret = fd_msg_browse_internal( child, MSG_BRW_NEXT, (msg_or_avp**)&child, NULL ) )
+   {
+      if ( fd_msg_avp_hdr( child, &ah ) != 0 || ah->avp_vendor != 0 || !ah->avp_value )
+         continue;
+
+      switch ( ah->avp_code )
+      {
+         case FD_AVP_OC_SEQUENCE_NUMBER:        { seqnum = ah->avp_value->u64; break; }
+         case FD_AVP_OC_REPORT_TYPE:            { reporttype = ah->avp_value->i32; break; }
+         case FD_AVP_OC_REDUCTION_PERCENTAGE:   { reduction = ah->avp_value->u32; break; }
+         case FD_AVP_OC_VALIDITY_DURATION:      { validity = ah->avp_value->u32; break; }
+         default:
+         {
+            break;
+         }
+      }
+   }
+
+   // a validity duration of zero ends the overload condition
+   if ( validity == 0 )
+      reduction = 0;
+
+   FDThrottle *throttle = NULL;
+
+   if ( reporttype == FD_OC_REALM_REPORT )
+   {
+      throttle = FDOverloadControl::findThrottle( hdr->msg_appl );
+   }
+   else if ( peer && m_peers )
+   {
+      FDPeer *p = m_peers->findPeer( peer->info.pi_diamid, peer->info.pi_diamidlen );
+      if ( p )
+         throttle = &p->getThrottle();
+   }
+
+   if ( throttle )
+      throttle->setReduction( reduction, validity * 1000, seqnum );
+}
+
+/// @endcond
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 Void FDUtility::splitDiameterFQDN( std::string &fqdn, std::string &host, std::string &realm )
 {
    size_t pos = fqdn.find( '.' );
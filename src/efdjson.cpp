@@ -26,6 +26,7 @@
 #include <iostream>
 #include <iomanip>
 #include <unordered_map>
+#include <vector>
 
 #include "freeDiameter/freeDiameter-host.h"
 #include "freeDiameter/libfdcore.h"
@@ -35,6 +36,7 @@
 
 #include "rapidjson/rapidjson.h"
 #include "rapidjson/document.h"
+#include "rapidjson/reader.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/stringbuffer.h"
@@ -131,33 +133,30 @@ public:
       m_baseentry = NULL;
       memset(&m_basedata, 0, sizeof(m_basedata));
       m_type = ADTUnknown;
+      m_derived = false;
    }
    ~AvpDictionaryEntry()
    {
    }
 
-   void init(const char *avp_name)
+   void init(struct dict_object *entry)
    {
       int ret = 0;
 
-      m_avp_name = avp_name;
-
-      /* get the dictionary entry for the AVP */
-      ret = fd_dict_search( fd_g_config->cnf_dict, DICT_AVP, AVP_BY_NAME_ALL_VENDORS, avp_name, &m_baseentry, ENOENT );
-      if (ret != 0)
-         throw runtimeInfo(
-            string_format("%s:%d - INFO - Unable to find AVP dictionary entry  for [%s]",
-            __FILE__, __LINE__, avp_name)
-         );
+      m_baseentry = entry;
 
       /* get the dictionary data for the AVP's dictionary entry */
       ret = fd_dict_getval( m_baseentry, &m_basedata );
       if (ret != 0)
          throw runtimeInfo(
-            string_format("%s:%d - INFO - Unable to retrieve the dictionary data for the [%s] dictionary entry",
-            __FILE__, __LINE__, avp_name)
+            string_format("%s:%d - INFO - Unable to retrieve the dictionary data for the AVP dictionary entry",
+            __FILE__, __LINE__)
          );
 
+      m_avp_name = m_basedata.avp_name;
+      m_type = getBaseType( m_basedata.avp_basetype );
+      m_derived = false;
+
       struct dictionary *dict = NULL;
       struct dict_object *derivedtype = NULL;
 
@@ -166,7 +165,7 @@ public:
       if (ret != 0)
          throw runtimeInfo(
             string_format("%s:%d - INFO - Unable to retrieve the dictionary for the [%s] dictionary entry",
-            __FILE__, __LINE__, avp_name)
+            __FILE__, __LINE__, m_avp_name.c_str())
          );
 
       /* get the dictionary entry associated with the derived type */
@@ -175,10 +174,10 @@ public:
       {
          struct dict_type_data derived_type_data;
 
-         ret = fd_dict_getval( derivedtype, &derived_type_data );
-
-         if (ret == 0)
+         if (fd_dict_getval( derivedtype, &derived_type_data ) == 0)
          {
+            m_derived = true;
+
             if      ( !strcmp( derived_type_data.type_name, "Enumerated" ) )        m_type = ADTEnumerated;
             else if ( !strcmp( derived_type_data.type_name, "Time" ) )              m_type = ADTTime;
             else if ( !strcmp( derived_type_data.type_name, "Address" ) )           m_type = ADTAddress;
@@ -186,75 +185,147 @@ public:
             else if ( !strcmp( derived_type_data.type_name, "DiameterIdentity" ) )  m_type = ADTDiameterIdentity;
             else if ( !strcmp( derived_type_data.type_name, "DiameterURI" ) )       m_type = ADTDiameterURI;
             else if ( !strcmp( derived_type_data.type_name, "IPFilterRule" ) )      m_type = ADTIPFilterRule;
-            else
-            {
-               switch ( m_basedata.avp_basetype )
-               {
-                  case AVP_TYPE_GROUPED:     { m_type = ADTGrouped; break; }
-                  case AVP_TYPE_INTEGER32:   { m_type = ADTI32; break; }
-                  case AVP_TYPE_INTEGER64:   { m_type = ADTI64; break; }
-                  case AVP_TYPE_UNSIGNED32:  { m_type = ADTU32; break; }
-                  case AVP_TYPE_UNSIGNED64:  { m_type = ADTU64; break; }
-                  case AVP_TYPE_FLOAT32:     { m_type = ADTF32; break; }
-                  case AVP_TYPE_FLOAT64:     { m_type = ADTF64; break; }
-                  case AVP_TYPE_OCTETSTRING: { m_type = ADTOctetString; break; }
-                  default:                   { m_type = ADTUnknown; break; }
-               }
-            }
-         }
-         else
-         {
-            switch ( m_basedata.avp_basetype )
-            {
-               case AVP_TYPE_GROUPED:     { m_type = ADTGrouped; break; }
-               case AVP_TYPE_INTEGER32:   { m_type = ADTI32; break; }
-               case AVP_TYPE_INTEGER64:   { m_type = ADTI64; break; }
-               case AVP_TYPE_UNSIGNED32:  { m_type = ADTU32; break; }
-               case AVP_TYPE_UNSIGNED64:  { m_type = ADTU64; break; }
-               case AVP_TYPE_FLOAT32:     { m_type = ADTF32; break; }
-               case AVP_TYPE_FLOAT64:     { m_type = ADTF64; break; }
-               case AVP_TYPE_OCTETSTRING: { m_type = ADTOctetString; break; }
-               default:                   { m_type = ADTUnknown; break; }
-            }
          }
       }
-      else
-      {
-         switch ( m_basedata.avp_basetype )
-         {
-            case AVP_TYPE_GROUPED:     { m_type = ADTGrouped; break; }
-            case AVP_TYPE_INTEGER32:   { m_type = ADTI32; break; }
-            case AVP_TYPE_INTEGER64:   { m_type = ADTI64; break; }
-            case AVP_TYPE_UNSIGNED32:  { m_type = ADTU32; break; }
-            case AVP_TYPE_UNSIGNED64:  { m_type = ADTU64; break; }
-            case AVP_TYPE_FLOAT32:     { m_type = ADTF32; break; }
-            case AVP_TYPE_FLOAT64:     { m_type = ADTF64; break; }
-            case AVP_TYPE_OCTETSTRING: { m_type = ADTOctetString; break; }
-            default:                   { m_type = ADTUnknown; break; }
-         }
-      }
-
    }
 
    const std::string &getAvpName() { return m_avp_name; }
+   uint32_t getAvpCode() { return m_basedata.avp_code; }
+   vendor_id_t getAvpVendor() { return m_basedata.avp_vendor; }
    struct dict_object *getBaseEntry() { return m_baseentry; }
    struct dict_avp_data &getBaseData() { return m_basedata; }
    AvpDataType getType() { return m_type; }
+   bool isDerived() { return m_derived; }
 
 private:
+   static AvpDataType getBaseType( enum dict_avp_basetype basetype )
+   {
+      switch ( basetype )
+      {
+         case AVP_TYPE_GROUPED:     return ADTGrouped;
+         case AVP_TYPE_INTEGER32:   return ADTI32;
+         case AVP_TYPE_INTEGER64:   return ADTI64;
+         case AVP_TYPE_UNSIGNED32:  return ADTU32;
+         case AVP_TYPE_UNSIGNED64:  return ADTU64;
+         case AVP_TYPE_FLOAT32:     return ADTF32;
+         case AVP_TYPE_FLOAT64:     return ADTF64;
+         case AVP_TYPE_OCTETSTRING: return ADTOctetString;
+         default:                   return ADTUnknown;
+      }
+   }
+
    std::string m_avp_name;
    struct dict_object *m_baseentry;
    struct dict_avp_data m_basedata;
    AvpDataType m_type;
+   bool m_derived;
 };
 
-static EMutexPrivate dictEntriesMutex;
-static std::unordered_map<std::string,AvpDictionaryEntry*> dictEntries;
+/*
+ * Caches the dictionary information for each AVP so that the dictionary
+ * is only searched the first time an AVP is encountered.  Entries can be
+ * located by AVP name (JSON to Diameter) or by the dictionary object
+ * returned by fd_msg_model() (Diameter to JSON).  The name lookup does not
+ * allocate any memory.  Entries are never removed.
+ */
+class AvpDictionaryCache
+{
+public:
+   static AvpDictionaryCache &getInstance()
+   {
+      static AvpDictionaryCache cache;
+      return cache;
+   }
+
+   AvpDictionaryEntry *find( const char *avp_name )
+   {
+      NameKey key( avp_name, strlen(avp_name) );
+
+      {
+         ERDLock l( m_lock );
+         auto it = m_byname.find( key );
+         if ( it != m_byname.end() )
+            return it->second;
+      }
+
+      /* get the dictionary entry for the AVP */
+      struct dict_object *model = NULL;
+      int ret = fd_dict_search( fd_g_config->cnf_dict, DICT_AVP, AVP_BY_NAME_ALL_VENDORS, avp_name, &model, ENOENT );
+      if (ret != 0)
+         throw runtimeInfo(
+            string_format("%s:%d - INFO - Unable to find AVP dictionary entry  for [%s]",
+            __FILE__, __LINE__, avp_name)
+         );
+
+      AvpDictionaryEntry *ade = find( model );
+
+      EWRLock l( m_lock );
+      NameKey entrykey( ade->getAvpName().c_str(), ade->getAvpName().length() );
+      if ( entrykey == key )
+         m_byname.insert( std::make_pair(entrykey, ade) );
+      return ade;
+   }
+
+   AvpDictionaryEntry *find( struct dict_object *model )
+   {
+      {
+         ERDLock l( m_lock );
+         auto it = m_bymodel.find( model );
+         if ( it != m_bymodel.end() )
+            return it->second;
+      }
+
+      AvpDictionaryEntry *ade = new AvpDictionaryEntry();
+      try
+      {
+         ade->init( model );
+      }
+      catch (...)
+      {
+         delete ade;
+         throw;
+      }
+
+      EWRLock l( m_lock );
+      auto result = m_bymodel.insert( std::make_pair(model, ade) );
+      if ( result.second == false )
+         delete ade;
+      return result.first->second;
+   }
+
+private:
+   struct NameKey
+   {
+      NameKey( const char *n, size_t l ) : name( n ), len( l ) {}
+      bool operator==( const NameKey &r ) const { return len == r.len && memcmp( name, r.name, len ) == 0; }
+      const char *name;
+      size_t len;
+   };
+
+   struct NameKeyHash
+   {
+      size_t operator()( const NameKey &k ) const
+      {
+         /* FNV-1a */
+         size_t h = 2166136261u;
+         for ( size_t i = 0; i < k.len; i++ )
+            h = (h ^ (unsigned char)k.name[i]) * 16777619u;
+         return h;
+      }
+   };
+
+   AvpDictionaryCache() {}
+
+   ERWLock m_lock;
+   std::unordered_map<NameKey,AvpDictionaryEntry*,NameKeyHash> m_byname;
+   std::unordered_map<struct dict_object*,AvpDictionaryEntry*> m_bymodel;
+};
 
 class AVP
 {
 public:
    AVP( const char *avp_name ) { _init(avp_name); }
+   AVP( AvpDictionaryEntry *ade ) { _init(ade); }
    AVP( const char *avp_name, int32_t v ) { _init(avp_name); set(v); }
    AVP( const char *avp_name, int64_t v ) { _init(avp_name); set(v); }
    AVP( const char *avp_name, uint32_t v ) { _init(avp_name); set(v); }
@@ -298,44 +369,19 @@ private:
 
    void _init( const char *avp_name )
    {
-      mName = avp_name;
-      mBaseEntry = NULL;
-      memset( &mBaseData, 0, sizeof(mBaseData) );
-      mType = ADTUnknown;
+      _init( AvpDictionaryCache::getInstance().find( avp_name ) );
+   }
+
+   void _init( AvpDictionaryEntry *ade )
+   {
+      mName = ade->getAvpName().c_str();
       mBuf = NULL;
       mAvp = NULL;
       memset( &mValue, 0, sizeof(mValue) );
 
-      /* check if an entry exists in dictEntries */
-      std::string an = avp_name;
-      auto it = dictEntries.find(an);
-      if (it == dictEntries.end())
-      {
-         EMutexLock l(dictEntriesMutex);
-
-         it = dictEntries.find(an);
-         if (it == dictEntries.end())
-         {
-            AvpDictionaryEntry *ade = new AvpDictionaryEntry();
-            ade->init(avp_name);
-            std::pair<std::string,AvpDictionaryEntry*> data(ade->getAvpName(), ade);
-            auto result = dictEntries.insert(data);
-            if (result.second == false)
-            {
-               delete ade;
-               throw runtimeInfo(
-                  string_format("%s:%d - WARN - Unable to insert AvpDictionaryEntry for [%s]",
-                  __FILE__, __LINE__, avp_name)
-               );
-            }
-
-            it = result.first;
-         }
-      }
-
-      mBaseEntry = it->second->getBaseEntry();
-      memcpy( &mBaseData, &it->second->getBaseData(), sizeof(mBaseData));
-      mType = it->second->getType();
+      mBaseEntry = ade->getBaseEntry();
+      memcpy( &mBaseData, &ade->getBaseData(), sizeof(mBaseData));
+      mType = ade->getType();
    }
 
    void _addTo( msg_or_avp *reference )
@@ -382,7 +428,7 @@ private:
    union avp_value mValue;
 };
 
-#define THROW_DATATYPE_MISMATCH() \
+#define THROW_DATATYPE_MISMATCH(jsontype) \
 { \
    throw runtimeInfo( string_format("%s:%d - INFO - Datatype mismatch for [%s] - expected datatype compatible with %s, JSON data type was %s", \
       __FILE__, __LINE__, name, \
@@ -402,13 +448,13 @@ private:
       avp.getType() == ADTDiameterURI ? "ADTDiameterURI" : \
       avp.getType() == ADTEnumerated ? "ADTEnumerated" : \
       avp.getType() == ADTIPFilterRule ? "ADTIPFilterRule" : "UNKNOWN", \
-      value.GetType() == RAPIDJSON_NAMESPACE::kNullType ? "kNullType" : \
-      value.GetType() == RAPIDJSON_NAMESPACE::kFalseType ? "kFalseType" : \
-      value.GetType() == RAPIDJSON_NAMESPACE::kTrueType ? "kTrueType" : \
-      value.GetType() == RAPIDJSON_NAMESPACE::kObjectType ? "kObjectType" : \
-      value.GetType() == RAPIDJSON_NAMESPACE::kArrayType ? "kArrayType" : \
-      value.GetType() == RAPIDJSON_NAMESPACE::kStringType ? "kStringType" : \
-      value.GetType() == RAPIDJSON_NAMESPACE::kNumberType ? "kNumber" : "Unknown") ); \
+      jsontype == RAPIDJSON_NAMESPACE::kNullType ? "kNullType" : \
+      jsontype == RAPIDJSON_NAMESPACE::kFalseType ? "kFalseType" : \
+      jsontype == RAPIDJSON_NAMESPACE::kTrueType ? "kTrueType" : \
+      jsontype == RAPIDJSON_NAMESPACE::kObjectType ? "kObjectType" : \
+      jsontype == RAPIDJSON_NAMESPACE::kArrayType ? "kArrayType" : \
+      jsontype == RAPIDJSON_NAMESPACE::kStringType ? "kStringType" : \
+      jsontype == RAPIDJSON_NAMESPACE::kNumberType ? "kNumber" : "Unknown") ); \
 }
 
 static bool isHexString( const char *s, int len )
@@ -461,289 +507,680 @@ static bool isHexString( const char *s, int len )
    return true;
 }
 
-static void fdJsonAddAvps( AVP &avp, const RAPIDJSON_NAMESPACE::Value &element, void (*errfunc)(const char*) );
-static void fdJsonAddAvps( msg_or_avp *reference, const RAPIDJSON_NAMESPACE::Value &element, void (*errfunc)(const char*) );
-
-static void fdJsonAddAvp( msg_or_avp *reference, const char *name, const RAPIDJSON_NAMESPACE::Value &value, void (*errfunc)(const char*) )
+/*
+ * A JSON number as reported by the SAX reader.  The Is*() methods follow
+ * the same rules as the equivalent RapidJSON DOM value methods.
+ */
+class JsonNumber
 {
-   AVP avp( name );
+public:
+   enum Kind { Int, Uint, Int64, Uint64, Double };
+
+   JsonNumber( int v ) : mKind( Int ) { mValue.i64 = v; }
+   JsonNumber( unsigned v ) : mKind( Uint ) { mValue.u64 = v; }
+   JsonNumber( int64_t v ) : mKind( Int64 ) { mValue.i64 = v; }
+   JsonNumber( uint64_t v ) : mKind( Uint64 ) { mValue.u64 = v; }
+   JsonNumber( double v ) : mKind( Double ) { mValue.d = v; }
 
-   switch (value.GetType())
+   bool IsInt() const
    {
-      case RAPIDJSON_NAMESPACE::kFalseType:
-      case RAPIDJSON_NAMESPACE::kTrueType:
+      switch ( mKind )
       {
-         throw runtimeInfo( string_format("%s:%d - INFO - Invalid format (true/false) for [%s] in JSON block, ignoring", __FILE__, __LINE__, name) );
-         break;
+         case Int:      return true;
+         case Uint:     return mValue.u64 <= (uint64_t)INT32_MAX;
+         case Int64:    return mValue.i64 >= INT32_MIN && mValue.i64 <= INT32_MAX;
+         case Uint64:   return mValue.u64 <= (uint64_t)INT32_MAX;
+         default:       return false;
       }
-      case RAPIDJSON_NAMESPACE::kNullType:
+   }
+   bool IsInt64() const
+   {
+      return mKind == Int || mKind == Int64 || mKind == Uint ||
+         (mKind == Uint64 && mValue.u64 <= (uint64_t)INT64_MAX);
+   }
+   bool IsUint() const
+   {
+      switch ( mKind )
       {
-         throw runtimeInfo( string_format("%s:%d - INFO - Invalid NULL for [%s] in JSON block, ignoring", __FILE__, __LINE__, name) );
-         break;
+         case Int:      return mValue.i64 >= 0;
+         case Uint:     return true;
+         case Int64:    return mValue.i64 >= 0 && mValue.i64 <= UINT32_MAX;
+         case Uint64:   return mValue.u64 <= UINT32_MAX;
+         default:       return false;
       }
-      case RAPIDJSON_NAMESPACE::kNumberType:
-      {
-         switch ( avp.getBaseType() )
-         {
-            case AVP_TYPE_INTEGER32: {
-               if (!value.IsInt()) THROW_DATATYPE_MISMATCH();
-               avp.set( value.GetInt() );
-               break;
-            }
-            case AVP_TYPE_INTEGER64: {
-               if (!value.IsInt64()) THROW_DATATYPE_MISMATCH();
-               avp.set( value.GetInt64() );
-               break;
-            }
-            case AVP_TYPE_UNSIGNED32: {
-               if (!value.IsUint()) THROW_DATATYPE_MISMATCH();
-               avp.set( value.GetUint() );
-               break;
-            }
-            case AVP_TYPE_UNSIGNED64: {
-               if (!value.IsUint64()) THROW_DATATYPE_MISMATCH();
-               avp.set( value.GetUint64() );
-               break;
-            }
-            case AVP_TYPE_FLOAT32: {
-               if (!value.IsFloat()) THROW_DATATYPE_MISMATCH();
-               avp.set( value.GetFloat() );
-               break;
-            }
-            case AVP_TYPE_FLOAT64: {
-               if (!value.IsDouble()) THROW_DATATYPE_MISMATCH();
-               avp.set( value.GetDouble() );
-               break;
-            }
-            default:
-            {
-               THROW_DATATYPE_MISMATCH();
-            }
-         }
+   }
+   bool IsUint64() const
+   {
+      return mKind == Uint || mKind == Uint64 ||
+         ((mKind == Int || mKind == Int64) && mValue.i64 >= 0);
+   }
+   bool IsDouble() const { return mKind == Double; }
+   bool IsFloat() const { return mKind == Double && mValue.d >= -3.4028234e38 && mValue.d <= 3.4028234e38; }
+
+   int32_t GetInt() const { return (int32_t)mValue.i64; }
+   int64_t GetInt64() const { return mValue.i64; }
+   uint32_t GetUint() const { return (uint32_t)mValue.u64; }
+   uint64_t GetUint64() const { return mValue.u64; }
+   float GetFloat() const { return (float)mValue.d; }
+   double GetDouble() const { return mValue.d; }
 
-         avp.addTo( reference );
+private:
+   Kind mKind;
+   union
+   {
+      int64_t i64;
+      uint64_t u64;
+      double d;
+   } mValue;
+};
 
+static void fdJsonSetNumber( AVP &avp, const char *name, const JsonNumber &value )
+{
+   switch ( avp.getBaseType() )
+   {
+      case AVP_TYPE_INTEGER32: {
+         if (!value.IsInt()) THROW_DATATYPE_MISMATCH(RAPIDJSON_NAMESPACE::kNumberType);
+         avp.set( value.GetInt() );
+         break;
+      }
+      case AVP_TYPE_INTEGER64: {
+         if (!value.IsInt64()) THROW_DATATYPE_MISMATCH(RAPIDJSON_NAMESPACE::kNumberType);
+         avp.set( value.GetInt64() );
+         break;
+      }
+      case AVP_TYPE_UNSIGNED32: {
+         if (!value.IsUint()) THROW_DATATYPE_MISMATCH(RAPIDJSON_NAMESPACE::kNumberType);
+         avp.set( value.GetUint() );
+         break;
+      }
+      case AVP_TYPE_UNSIGNED64: {
+         if (!value.IsUint64()) THROW_DATATYPE_MISMATCH(RAPIDJSON_NAMESPACE::kNumberType);
+         avp.set( value.GetUint64() );
+         break;
+      }
+      case AVP_TYPE_FLOAT32: {
+         if (!value.IsFloat()) THROW_DATATYPE_MISMATCH(RAPIDJSON_NAMESPACE::kNumberType);
+         avp.set( value.GetFloat() );
+         break;
+      }
+      case AVP_TYPE_FLOAT64: {
+         if (!value.IsDouble()) THROW_DATATYPE_MISMATCH(RAPIDJSON_NAMESPACE::kNumberType);
+         avp.set( value.GetDouble() );
          break;
       }
-      case RAPIDJSON_NAMESPACE::kStringType:
+      default:
       {
-         if ( avp.getBaseType() != AVP_TYPE_OCTETSTRING )
-            THROW_DATATYPE_MISMATCH();
-         
-         size_t rawlen = strlen( value.GetString() );
+         THROW_DATATYPE_MISMATCH(RAPIDJSON_NAMESPACE::kNumberType);
+      }
+   }
+}
 
-         if ( avp.getType() == ADTAddress )
-         {
-            sSS ss;
+static void fdJsonSetString( AVP &avp, const char *name, const char *value, size_t rawlen )
+{
+   if ( avp.getBaseType() != AVP_TYPE_OCTETSTRING )
+      THROW_DATATYPE_MISMATCH(RAPIDJSON_NAMESPACE::kStringType);
+
+   if ( avp.getType() == ADTAddress )
+   {
+      sSS ss;
 #pragma pack(push, 1)
-            union
-            {
-               struct
-               {
-                  uint16_t addressType;
-                  uint8_t buffer[18-sizeof(uint16_t)];
-               } address;
-               uint8_t raw[18];
-            } addr;
+      union
+      {
+         struct
+         {
+            uint16_t addressType;
+            uint8_t buffer[18-sizeof(uint16_t)];
+         } address;
+         uint8_t raw[18];
+      } addr;
 #pragma pack(pop)
 
-            if (inet_pton(AF_INET,value.GetString(),&((sSA4*)&ss)->sin_addr) == 1)
-            {
-               addr.address.addressType = htons(1);
-               memcpy(addr.address.buffer, &((sSA4*)&ss)->sin_addr.s_addr, 4);
-               //*(uint16_t *)abuf = htons(1);
-               //memcpy(abuf + 2, &((sSA4*)&ss)->sin_addr.s_addr, 4);
-               avp.set( addr.raw, 6 );
-            }
-            else if (inet_pton(AF_INET6,value.GetString(),&((sSA6*)&ss)->sin6_addr) == 1)
-            {
-               addr.address.addressType = htons(2);
-               memcpy(addr.address.buffer, &((sSA4*)&ss)->sin_addr.s_addr, 16);
-               //*(uint16_t *)abuf = htons(2);
-               //memcpy(abuf + 2, &((sSA6*)&ss)->sin6_addr.s6_addr, 16);
-               avp.set( addr.raw, 18 );
-            }
-            else
-            {
-               avp.set( (uint8_t*)value.GetString(), rawlen );
-            }
+      if (inet_pton(AF_INET,value,&((sSA4*)&ss)->sin_addr) == 1)
+      {
+         addr.address.addressType = htons(1);
+         memcpy(addr.address.buffer, &((sSA4*)&ss)->sin_addr.s_addr, 4);
+         avp.set( addr.raw, 6 );
+      }
+      else if (inet_pton(AF_INET6,value,&((sSA6*)&ss)->sin6_addr) == 1)
+      {
+         addr.address.addressType = htons(2);
+         memcpy(addr.address.buffer, &((sSA4*)&ss)->sin_addr.s_addr, 16);
+         avp.set( addr.raw, 18 );
+      }
+      else
+      {
+         avp.set( (uint8_t*)value, rawlen );
+      }
+   }
+   else if ( avp.getType() == ADTTime )
+   {
+      union {
+         uint32_t u;
+         uint8_t u8[ sizeof( uint32_t ) ];
+      } val;
+      ETime t;
+      ntp_time_t ntp;
+
+      t.ParseDateTime( value, false );
+
+      t.getNTPTime( ntp );
+
+      val.u = ntp.second;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      uint8_t u8;
+      u8 = val.u8[0]; val.u8[0] = val.u8[3]; val.u8[3] = u8;
+      u8 = val.u8[1]; val.u8[1] = val.u8[2]; val.u8[2] = u8;
+#endif
+
+      avp.set( val.u8, sizeof(uint32_t) );
+   }
+   else if ( avp.getType() == ADTOctetString )
+   {
+      if ( isHexString( value, rawlen ) )
+      {
+         /*
+          * hex string format is "0x" or "0X" followed by an even number of hex characters
+          * binlen is equal to the final length + 1
+          */
+         size_t binlen = rawlen / 2;
+
+         /*
+          * allocate space for the binary string
+          */
+         avp.allocBuffer( binlen - 1 );
+
+         /*
+          * grab a pointer to the hex character buffer
+          */
+         const uint8_t *p = (const uint8_t*)value;
+
+         /*
+          * create the binary string from the hex digit string
+          * start index at 1 (first hex digit divided by number of digits per byte, 2 / 2 = 1)
+          * to start at the first hex digit
+          */
+         for (size_t i = 1; i < binlen; i++)
+            avp.getBuffer().get()[i-1] = (HEX2BIN(p[i * 2] ) << 4) + HEX2BIN(p[i * 2 + 1]);
+
+         /*
+          * assign the string to the avp
+          */
+         avp.set( avp.getBuffer().get(), binlen - 1 );
+      }
+      else
+      {
+         avp.set( (uint8_t*)value, rawlen );
+      }
+   }
+   else // some variant of a standard string
+   {
+      avp.set( (uint8_t*)value, rawlen );
+   }
+}
+
+/*
+ * A node of a compiled JSON template.  Each node represents a JSON object
+ * and contains the ordered list of members (instructions) that were seen
+ * when the template was compiled, each with its resolved dictionary entry.
+ */
+struct JsonTemplateNode
+{
+   JsonTemplateNode( const char *n, size_t l, AvpDictionaryEntry *e )
+      : name( n, l ), entry( e )
+   {
+   }
+   ~JsonTemplateNode()
+   {
+      for ( auto child : children )
+         delete child;
+   }
+
+   JsonTemplateNode *findChild( const char *n, size_t l, size_t &cursor ) const
+   {
+      /* the members are usually in the same order as when compiled */
+      if ( cursor < children.size() )
+      {
+         JsonTemplateNode *child = children[cursor];
+         if ( child->name.length() == l && memcmp( child->name.data(), n, l ) == 0 )
+         {
+            cursor++;
+            return child;
          }
-         else if ( avp.getType() == ADTTime )
+      }
+
+      for ( size_t i = 0; i < children.size(); i++ )
+      {
+         JsonTemplateNode *child = children[i];
+         if ( child->name.length() == l && memcmp( child->name.data(), n, l ) == 0 )
          {
-            union {
-               uint32_t u;
-               uint8_t u8[ sizeof( uint32_t ) ];
-            } val;
-            ETime t;
-            ntp_time_t ntp;
+            cursor = i + 1;
+            return child;
+         }
+      }
 
-            t.ParseDateTime( value.GetString(), false );
+      return NULL;
+   }
 
-            t.getNTPTime( ntp );
+   std::string name;
+   AvpDictionaryEntry *entry;
+   std::vector<JsonTemplateNode*> children;
+};
 
-            val.u = ntp.second;
+/*
+ * SAX handler that compiles the shape of a JSON document into a tree of
+ * JsonTemplateNode objects.  Arrays do not create a node, each element is
+ * described by the node of the member that contains the array.
+ */
+class JsonTemplateCompiler : public RAPIDJSON_NAMESPACE::BaseReaderHandler<RAPIDJSON_NAMESPACE::UTF8<>, JsonTemplateCompiler>
+{
+public:
+   JsonTemplateCompiler( JsonTemplateNode *root, void (*errfunc)(const char*) )
+      : mRoot( root ),
+        mErrFunc( errfunc )
+   {
+   }
 
-      #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-            uint8_t u8;
-            u8 = val.u8[0]; val.u8[0] = val.u8[3]; val.u8[3] = u8;
-            u8 = val.u8[1]; val.u8[1] = val.u8[2]; val.u8[2] = u8;
-      #endif
+   bool Default() { return true; }
 
-            avp.set( val.u8, sizeof(uint32_t) );
-         }
-         else if ( avp.getType() == ADTOctetString )
+   bool Key( const char *str, RAPIDJSON_NAMESPACE::SizeType len, bool copy )
+   {
+      Frame &f = mStack.back();
+      size_t cursor = 0;
+
+      f.current = f.node ? f.node->findChild( str, len, cursor ) : NULL;
+      if ( !f.current && f.node )
+      {
+         AvpDictionaryEntry *ade = NULL;
+         try
          {
-            if ( isHexString( (const char *)value.GetString(), rawlen ) )
-            {
-               /*
-                * hex string format is "0x" or "0X" followed by an even number of hex characters
-                * binlen is equal to the final length + 1
-                */
-               size_t binlen = rawlen / 2;
-
-               /*
-                * allocate space for the binary string
-                */
-               avp.allocBuffer( binlen - 1 );
-
-               /*
-                * grab a pointer to the hex character buffer
-                */
-               const uint8_t *p = (const uint8_t*)value.GetString();
-
-               /*
-                * create the binary string from the hex digit string
-                * start index at 1 (first hex digit divided by number of digits per byte, 2 / 2 = 1)
-                * to start at the first hex digit
-                */
-               for (size_t i = 1; i < binlen; i++)
-                  avp.getBuffer().get()[i-1] = (HEX2BIN(p[i * 2] ) << 4) + HEX2BIN(p[i * 2 + 1]);
-
-               /*
-                * assign the string to the avp
-                */
-               avp.set( avp.getBuffer().get(), binlen - 1 );
-            }
-            else
-            {
-               avp.set( (uint8_t*)value.GetString(), rawlen );
-            }
+            ade = AvpDictionaryCache::getInstance().find( str );
          }
-         else // some variant of a standard string
+         catch (runtimeInfo &exi)
          {
-            avp.set( (uint8_t*)value.GetString(), rawlen );
+            if ( mErrFunc )
+               mErrFunc( exi.what() );
          }
 
-         /* add to the message/grouped avp */
-         avp.addTo( reference );
+         f.current = new JsonTemplateNode( str, len, ade );
+         f.node->children.push_back( f.current );
+      }
+
+      return true;
+   }
 
-         break;
+   bool StartObject()
+   {
+      if ( mStack.empty() )
+         mStack.push_back( Frame(mRoot, false) );
+      else
+         mStack.push_back( Frame(mStack.back().current, false) );
+      return true;
+   }
+
+   bool EndObject( RAPIDJSON_NAMESPACE::SizeType memberCount )
+   {
+      mStack.pop_back();
+      return true;
+   }
+
+   bool StartArray()
+   {
+      if ( mStack.empty() )
+         return false;
+      Frame f( mStack.back().node, true );
+      f.current = mStack.back().current;
+      mStack.push_back( f );
+      return true;
+   }
+
+   bool EndArray( RAPIDJSON_NAMESPACE::SizeType elementCount )
+   {
+      mStack.pop_back();
+      return true;
+   }
+
+private:
+   struct Frame
+   {
+      Frame( JsonTemplateNode *n, bool a ) : node( n ), current( NULL ), array( a ) {}
+      JsonTemplateNode *node;
+      JsonTemplateNode *current;
+      bool array;
+   };
+
+   JsonTemplateNode *mRoot;
+   void (*mErrFunc)(const char*);
+   std::vector<Frame> mStack;
+};
+
+/*
+ * SAX handler that creates the AVP's as the JSON document is read.  If a
+ * compiled template is supplied, the dictionary entry for each member is
+ * taken from the template, otherwise it is retrieved from the dictionary
+ * cache by name.
+ */
+class JsonAvpBuilder : public RAPIDJSON_NAMESPACE::BaseReaderHandler<RAPIDJSON_NAMESPACE::UTF8<>, JsonAvpBuilder>
+{
+public:
+   JsonAvpBuilder( msg_or_avp *msg, JsonTemplateNode *root, void (*errfunc)(const char*) )
+      : mMsg( msg ),
+        mRoot( root ),
+        mErrFunc( errfunc )
+   {
+   }
+
+   bool Null()
+   {
+      if ( !skipping() )
+         info( string_format("%s:%d - INFO - Invalid NULL for [%s] in JSON block, ignoring", __FILE__, __LINE__, name()) );
+      return true;
+   }
+
+   bool Bool( bool b )
+   {
+      if ( !skipping() )
+         info( string_format("%s:%d - INFO - Invalid format (true/false) for [%s] in JSON block, ignoring", __FILE__, __LINE__, name()) );
+      return true;
+   }
+
+   bool Int( int i ) { return number( JsonNumber(i) ); }
+   bool Uint( unsigned u ) { return number( JsonNumber(u) ); }
+   bool Int64( int64_t i ) { return number( JsonNumber(i) ); }
+   bool Uint64( uint64_t u ) { return number( JsonNumber(u) ); }
+   bool Double( double d ) { return number( JsonNumber(d) ); }
+
+   bool String( const char *str, RAPIDJSON_NAMESPACE::SizeType len, bool copy )
+   {
+      if ( skipping() )
+         return true;
+
+      try
+      {
+         AVP avp( entry() );
+         fdJsonSetString( avp, name(), str, len );
+         avp.addTo( mStack.back().ref );
       }
-      case RAPIDJSON_NAMESPACE::kArrayType:
+      catch (runtimeInfo &exi)
       {
-         /* iterate through array elements adding them to reference */
-         for (RAPIDJSON_NAMESPACE::Value::ConstValueIterator it = value.Begin();
-              it != value.End();
-              ++it)
-         {
-            fdJsonAddAvp( reference, name, *it, errfunc );
-         }
-         break;
+         info( exi.what() );
       }
-      case RAPIDJSON_NAMESPACE::kObjectType:
+
+      return true;
+   }
+
+   bool Key( const char *str, RAPIDJSON_NAMESPACE::SizeType len, bool copy )
+   {
+      Frame &f = mStack.back();
+
+      f.key.assign( str, len );
+      f.current = f.node ? f.node->findChild( str, len, f.cursor ) : NULL;
+
+      return true;
+   }
+
+   bool StartObject()
+   {
+      if ( mStack.empty() )
       {
-         avp.addTo( reference );
-         fdJsonAddAvps( avp, value, errfunc );
-         break;
+         mStack.push_back( Frame(mMsg, mRoot) );
+         return true;
       }
-      default:
+
+      Frame &parent = mStack.back();
+      Frame f( NULL, parent.current );
+
+      if ( !skipping() )
       {
-         throw runtimeInfo(
-            string_format("%s:%d - INFO - invalid JSON data type encountered in element [%s]",
-            __FILE__, __LINE__, name)
-         );
-         break;
+         try
+         {
+            AVP avp( entry() );
+
+            if ( avp.getBaseType() != AVP_TYPE_GROUPED )
+            {
+               const char *name = this->name();
+               THROW_DATATYPE_MISMATCH(RAPIDJSON_NAMESPACE::kObjectType);
+            }
+
+            avp.addTo( parent.ref );
+            f.ref = avp.getAvp();
+         }
+         catch (runtimeInfo &exi)
+         {
+            info( exi.what() );
+         }
       }
+
+      mStack.push_back( f );
+      return true;
    }
-}
 
-static void fdJsonAddAvps( AVP &avp, const RAPIDJSON_NAMESPACE::Value &element, void (*errfunc)(const char*) )
-{
-   fdJsonAddAvps( avp.getAvp(), element, errfunc );
-}
+   bool EndObject( RAPIDJSON_NAMESPACE::SizeType memberCount )
+   {
+      mStack.pop_back();
+      return true;
+   }
 
-static void fdJsonAddAvps( msg_or_avp *reference, const RAPIDJSON_NAMESPACE::Value &element, void (*errfunc)(const char*) )
-{
-   /* iterate through each of the child elements adding them to the reference */
-   for (RAPIDJSON_NAMESPACE::Value::ConstMemberIterator it = element.MemberBegin();
-        it != element.MemberEnd();
-        ++it)
+   bool StartArray()
+   {
+      if ( mStack.empty() )
+         return false;
+
+      /* the array elements are added to the parent using the member name */
+      Frame f( mStack.back() );
+      f.node = NULL;
+      mStack.push_back( f );
+      return true;
+   }
+
+   bool EndArray( RAPIDJSON_NAMESPACE::SizeType elementCount )
    {
+      mStack.pop_back();
+      return true;
+   }
+
+private:
+   struct Frame
+   {
+      Frame( msg_or_avp *r, JsonTemplateNode *n ) : ref( r ), node( n ), current( NULL ), cursor( 0 ) {}
+      msg_or_avp *ref;
+      JsonTemplateNode *node;
+      JsonTemplateNode *current;
+      size_t cursor;
+      std::string key;
+   };
+
+   bool skipping() { return mStack.empty() || mStack.back().ref == NULL; }
+   const char *name() { return mStack.back().key.c_str(); }
+
+   AvpDictionaryEntry *entry()
+   {
+      Frame &f = mStack.back();
+
+      if ( f.current && f.current->entry )
+         return f.current->entry;
+
+      return AvpDictionaryCache::getInstance().find( f.key.c_str() );
+   }
+
+   bool number( const JsonNumber &value )
+   {
+      if ( skipping() )
+         return true;
+
       try
       {
-         fdJsonAddAvp( reference, it->name.GetString(), it->value, errfunc );
+         AVP avp( entry() );
+         fdJsonSetNumber( avp, name(), value );
+         avp.addTo( mStack.back().ref );
       }
       catch (runtimeInfo &exi)
       {
-         errfunc( exi.what() );
+         info( exi.what() );
       }
+
+      return true;
    }
-}
 
-int fdJsonAddAvps( const char *json, msg_or_avp *msg, void (*errfunc)(const char*) )
+   void info( const std::string &msg ) { info( msg.c_str() ); }
+   void info( const char *msg )
+   {
+      if ( mErrFunc )
+         mErrFunc( msg );
+   }
+
+   msg_or_avp *mMsg;
+   JsonTemplateNode *mRoot;
+   void (*mErrFunc)(const char*);
+   std::vector<Frame> mStack;
+};
+
+static int fdJsonAddAvps( const char *json, msg_or_avp *msg, JsonTemplateNode *root, void (*errfunc)(const char*) )
 {
    int ret = FDJSON_SUCCESS;
-   RAPIDJSON_NAMESPACE::Document doc;
 
    if (!json) {
       errfunc( string_format("%s:%d - ERROR - Error parsing JSON string", __FILE__, __LINE__).c_str() );
       return FDJSON_JSON_PARSING_ERROR;
    }
 
-   if (doc.Parse<RAPIDJSON_NAMESPACE::kParseNoFlags>(json).HasParseError()) {
+   try
+   {
+      RAPIDJSON_NAMESPACE::Reader reader;
+      RAPIDJSON_NAMESPACE::StringStream ss( json );
+      JsonAvpBuilder builder( msg, root, errfunc );
+
+      if (reader.Parse<RAPIDJSON_NAMESPACE::kParseNoFlags>( ss, builder ).IsError()) {
+         errfunc( string_format("%s:%d - ERROR - Error parsing JSON string", __FILE__, __LINE__).c_str() );
+         ret = FDJSON_JSON_PARSING_ERROR;
+      }
+   }
+   catch (runtimeError &ex)
+   {
+      errfunc( ex.what() );
+      ret = FDJSON_EXCEPTION;
+   }
+
+   return ret;
+}
+
+int fdJsonAddAvps( const char *json, msg_or_avp *msg, void (*errfunc)(const char*) )
+{
+   return fdJsonAddAvps( json, msg, NULL, errfunc );
+}
+
+int fdJsonAddAvps( const FDJsonTemplate &tmpl, const char *json, msg_or_avp *msg, void (*errfunc)(const char*) )
+{
+   return fdJsonAddAvps( json, msg, tmpl.m_root, errfunc );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+FDJsonTemplate::FDJsonTemplate()
+   : m_root( NULL )
+{
+}
+
+FDJsonTemplate::FDJsonTemplate( const char *json, void (*errfunc)(const char *) )
+   : m_root( NULL )
+{
+   compile( json, errfunc );
+}
+
+FDJsonTemplate::~FDJsonTemplate()
+{
+   if ( m_root )
+      delete m_root;
+}
+
+int FDJsonTemplate::compile( const char *json, void (*errfunc)(const char *) )
+{
+   if ( m_root )
+   {
+      delete m_root;
+      m_root = NULL;
+   }
+
+   if (!json) {
       errfunc( string_format("%s:%d - ERROR - Error parsing JSON string", __FILE__, __LINE__).c_str() );
       return FDJSON_JSON_PARSING_ERROR;
    }
 
+   JsonTemplateNode *root = new JsonTemplateNode( "", 0, NULL );
+
    try
    {
-      for (RAPIDJSON_NAMESPACE::Value::ConstMemberIterator it = doc.MemberBegin();
-           it != doc.MemberEnd();
-           ++it)
-      {
-         fdJsonAddAvp( msg, it->name.GetString(), it->value, errfunc );
+      RAPIDJSON_NAMESPACE::Reader reader;
+      RAPIDJSON_NAMESPACE::StringStream ss( json );
+      JsonTemplateCompiler compiler( root, errfunc );
+
+      if (reader.Parse<RAPIDJSON_NAMESPACE::kParseNoFlags>( ss, compiler ).IsError()) {
+         delete root;
+         errfunc( string_format("%s:%d - ERROR - Error parsing JSON string", __FILE__, __LINE__).c_str() );
+         return FDJSON_JSON_PARSING_ERROR;
       }
    }
    catch (runtimeError &ex)
    {
+      delete root;
       errfunc( ex.what() );
-      ret = FDJSON_EXCEPTION;
+      return FDJSON_EXCEPTION;
    }
 
-   return ret;
+   m_root = root;
+
+   return FDJSON_SUCCESS;
 }
 
-std::string fdJsonBinaryToHex( const unsigned char *buffer, size_t len )
+/*
+ * RapidJSON output stream that appends directly to a caller supplied
+ * std::string, allowing the capacity of the string to be reused.
+ */
+class JsonStringStream
+{
+public:
+   typedef char Ch;
+
+   JsonStringStream( std::string &s ) : m_s( s ) {}
+
+   void Put( char c ) { m_s.push_back( c ); }
+   void Flush() {}
+
+private:
+   std::string &m_s;
+};
+
+typedef RAPIDJSON_NAMESPACE::Writer<JsonStringStream> JsonWriter;
+
+static void fdJsonWriteHex( JsonWriter &writer, const unsigned char *buffer, size_t len, std::vector<char> &scratch )
 {
    static const char *hexDigits = "0123456789ABCDEF";
-   std::stringstream ss;
+   size_t hexlen = len * 2 + 2;
+
+   if ( scratch.size() < hexlen )
+      scratch.resize( hexlen );
+
+   char *p = scratch.data();
 
    // add the 0x prefix
-   ss << "0x";
+   *p++ = '0';
+   *p++ = 'x';
 
-   // loop through the buffer
+   // convert each byte to 2 hex digits
    for ( size_t i = 0; i < len; i++ )
-      ss << hexDigits[UPPERNIBBLE(buffer[i])] << hexDigits[LOWERNIBBLE(buffer[i])];
+   {
+      *p++ = hexDigits[UPPERNIBBLE(buffer[i])];
+      *p++ = hexDigits[LOWERNIBBLE(buffer[i])];
+   }
 
-   // return the hex string
-   return ss.str();
+   writer.String( scratch.data(), hexlen );
 }
 
-static std::string fdJsonTimeToStr( struct dict_avp_data *dictData, const unsigned char *buffer, size_t len )
+static size_t fdJsonTimeToStr( struct dict_avp_data *dictData, const unsigned char *buffer, size_t len, char *str, size_t maxlen )
 {
    ETime t;
    ntp_time_t ntp;
-   EString ts;
 
    if ( len != 4 )
       throw runtimeInfo(
@@ -760,19 +1197,13 @@ static std::string fdJsonTimeToStr( struct dict_avp_data *dictData, const unsign
       );
 
    t.setNTPTime( ntp );
-   t.Format( ts, "%i", false );
+   t.Format( str, maxlen, "%i", false );
 
-   return ts;
+   return strlen( str );
 }
 
-static std::string fdJsonAddressToStr( struct dict_avp_data *dictData, const unsigned char *buffer, size_t len )
+static size_t fdJsonAddressToStr( struct dict_avp_data *dictData, const unsigned char *buffer, size_t len, char *str, size_t maxlen )
 {
-   sSS ss;
-   char str[INET6_ADDRSTRLEN];
-
-   // populate the sSS structure
-   memset( &ss, 0, sizeof(ss) );
-
    uint16_t addressType = ntohs( *(uint16_t *)buffer );
 
    switch ( addressType )
@@ -785,9 +1216,7 @@ static std::string fdJsonAddressToStr( struct dict_avp_data *dictData, const uns
                __FILE__, __LINE__, dictData->avp_name)
             );
 
-         ((sSA4*)&ss)->sin_family = AF_INET;
-         memcpy( &((sSA4*)&ss)->sin_addr.s_addr, &buffer[2], 4 );
-
+         inet_ntop( AF_INET, &buffer[2], str, maxlen );
          break;
       }
       case 2: // IPV6
@@ -798,9 +1227,7 @@ static std::string fdJsonAddressToStr( struct dict_avp_data *dictData, const uns
                __FILE__, __LINE__, dictData->avp_name)
             );
 
-         ((sSA6*)&ss)->sin6_family = AF_INET6;
-         memcpy( &((sSA6*)&ss)->sin6_addr.s6_addr, &buffer[2], 16 );
-
+         inet_ntop( AF_INET6, &buffer[2], str, maxlen );
          break;
       }
       default:
@@ -812,38 +1239,16 @@ static std::string fdJsonAddressToStr( struct dict_avp_data *dictData, const uns
       }
    }
 
-   // convert the address to a string
-   switch ( ss.ss_family )
-   {
-      case AF_INET:
-      {
-         inet_ntop( AF_INET, &((sSA4*)&ss)->sin_addr, str, sizeof( str ) );
-         break;
-      }
-      case AF_INET6:
-      {
-         inet_ntop( AF_INET6, &((sSA6*)&ss)->sin6_addr, str, sizeof( str ) );
-         break;
-      }
-      default:
-      {
-         break;
-      }
-   }
-
-   // return the value
-   return std::string( str );
+   return strlen( str );
 }
 
-static void fdJsonAddMembers( msg_or_avp *ref, RAPIDJSON_NAMESPACE::Value &object, RAPIDJSON_NAMESPACE::Document::AllocatorType &allocator )
+static void fdJsonWriteMembers( msg_or_avp *ref, JsonWriter &writer, std::vector<char> &scratch )
 {
    int ret;
    struct avp *a;
    struct avp_hdr *hdr;
    struct dict_object *dictEntry;
-   struct dict_avp_data dictData;
-   struct dict_avp_data derivedData;
-   bool isDerived = false;
+   AvpDictionaryCache &cache = AvpDictionaryCache::getInstance();
 
    if ( fd_msg_browse_internal( ref, MSG_BRW_FIRST_CHILD, (msg_or_avp**)&a, NULL ) != 0 )
       return;
@@ -861,130 +1266,98 @@ static void fdJsonAddMembers( msg_or_avp *ref, RAPIDJSON_NAMESPACE::Value &objec
                __FILE__, __LINE__, ret )
          );
 
-      // get the avp data
-      ret = fd_dict_getval( dictEntry, &dictData );
-      if ( ret != 0 )
-         throw runtimeError(
-            string_format("%s:%d - INFO - error fd_dict_getval() returned %d",
-               __FILE__, __LINE__, ret )
-         );
-
-      // the the derived type if applicable
-      if ( dictData.avp_basetype == AVP_TYPE_OCTETSTRING )
-      {
-         struct dictionary *dict = NULL;
-         struct dict_object *derivedtype = NULL;
-
-         /* get the dictionary associated with the AVP dictionary entry */
-         ret = fd_dict_getdict( dictEntry, &dict );
-         if ( ret != 0 )
-            throw runtimeInfo(
-               string_format("%s:%d - INFO - Unable to retrieve the dictionary for the [%s] dictionary entry",
-               __FILE__, __LINE__, dictData.avp_name)
-            );
+      // get the cached avp dictionary data and derived type
+      AvpDictionaryEntry *ade = cache.find( dictEntry );
+      struct dict_avp_data &dictData = ade->getBaseData();
 
-         /* get the dictionary entry associated with the derived type */
-         ret = fd_dict_search( dict, DICT_TYPE, TYPE_OF_AVP, dictEntry, &derivedtype, EINVAL );
-         if ( ret == 0 ) /* if found, then derived */
-            isDerived = fd_dict_getval( derivedtype, &derivedData ) == 0;
-      }
+      if ( fd_msg_avp_hdr ( a, &hdr ) != 0 )
+         throw runtimeInfo(
+            string_format("%s:%d - INFO - Unable to retrieve the AVP header for [%s]",
+            __FILE__, __LINE__, dictData.avp_name)
+         );
 
-      if ( fd_msg_avp_hdr ( a, &hdr ) == 0 )
+      switch ( dictData.avp_basetype )
       {
-         RAPIDJSON_NAMESPACE::Value avp_name;
-         avp_name.SetString( dictData.avp_name, allocator );
-
-         switch ( dictData.avp_basetype )
+         case AVP_TYPE_OCTETSTRING:
          {
-            case AVP_TYPE_OCTETSTRING:
+            writer.Key( ade->getAvpName().c_str(), ade->getAvpName().length() );
+            if ( ade->isDerived() )
             {
-               if ( isDerived )
+               char str[64];
+
+               if ( ade->getType() == ADTAddress )
+               {
+                  size_t len = fdJsonAddressToStr( &dictData, hdr->avp_value->os.data, hdr->avp_value->os.len, str, sizeof(str) );
+                  writer.String( str, len );
+               }
+               else if ( ade->getType() == ADTTime )
                {
-                  if ( !strcmp(derivedData.avp_name,"Address") )
-                  {
-                     std::string address = fdJsonAddressToStr( &dictData, hdr->avp_value->os.data, hdr->avp_value->os.len );
-                     RAPIDJSON_NAMESPACE::Value v;
-                     v.SetString( address.c_str(), address.length(), allocator );
-                     object.AddMember( avp_name, v, allocator );
-                  }
-                  else if ( !strcmp(derivedData.avp_name,"Time") )
-                  {
-                     std::string tm = fdJsonTimeToStr( &dictData, hdr->avp_value->os.data, hdr->avp_value->os.len );
-                     RAPIDJSON_NAMESPACE::Value v;
-                     v.SetString( tm.c_str(), tm.length(), allocator );
-                     object.AddMember( avp_name, v, allocator );
-                  }
-                  else
-                  {
-                     std::string str( (const char *)hdr->avp_value->os.data, hdr->avp_value->os.len );
-                     RAPIDJSON_NAMESPACE::Value v;
-                     v.SetString( str.c_str(), str.length(), allocator );
-                     object.AddMember( avp_name, v, allocator );
-                  }
+                  size_t len = fdJsonTimeToStr( &dictData, hdr->avp_value->os.data, hdr->avp_value->os.len, str, sizeof(str) );
+                  writer.String( str, len );
                }
                else
                {
-                  // convert each byte to 2 hex digits
-                  std::string hex = fdJsonBinaryToHex( hdr->avp_value->os.data, hdr->avp_value->os.len );
-                  RAPIDJSON_NAMESPACE::Value v;
-                  v.SetString( hex.c_str(), hex.length(), allocator );
-                  object.AddMember( avp_name, v, allocator );
+                  writer.String( (const char *)hdr->avp_value->os.data, hdr->avp_value->os.len );
                }
-               break;
-            }
-            case AVP_TYPE_INTEGER32:
-            {
-               object.AddMember( avp_name, hdr->avp_value->i32, allocator );
-               break;
-            }
-            case AVP_TYPE_INTEGER64:
-            {
-               object.AddMember( avp_name, hdr->avp_value->i64, allocator );
-               break;
             }
-            case AVP_TYPE_UNSIGNED32:
-            {
-               object.AddMember( avp_name, hdr->avp_value->u32, allocator );
-               break;
-            }
-            case AVP_TYPE_UNSIGNED64:
-            {
-               object.AddMember( avp_name, hdr->avp_value->u64, allocator );
-               break;
-            }
-            case AVP_TYPE_FLOAT32:
-            {
-               object.AddMember( avp_name, hdr->avp_value->f32, allocator );
-               break;
-            }
-            case AVP_TYPE_FLOAT64:
-            {
-               object.AddMember( avp_name, hdr->avp_value->f64, allocator );
-               break;
-            }
-            case AVP_TYPE_GROUPED:
-            {
-               RAPIDJSON_NAMESPACE::Value grouped( RAPIDJSON_NAMESPACE::kObjectType );
-               fdJsonAddMembers( a, grouped, allocator );
-               object.AddMember( avp_name, grouped, allocator );
-               break;
-            }
-            default:
+            else
             {
+               fdJsonWriteHex( writer, hdr->avp_value->os.data, hdr->avp_value->os.len, scratch );
             }
+            break;
+         }
+         case AVP_TYPE_INTEGER32:
+         {
+            writer.Key( ade->getAvpName().c_str(), ade->getAvpName().length() );
+            writer.Int( hdr->avp_value->i32 );
+            break;
+         }
+         case AVP_TYPE_INTEGER64:
+         {
+            writer.Key( ade->getAvpName().c_str(), ade->getAvpName().length() );
+            writer.Int64( hdr->avp_value->i64 );
+            break;
+         }
+         case AVP_TYPE_UNSIGNED32:
+         {
+            writer.Key( ade->getAvpName().c_str(), ade->getAvpName().length() );
+            writer.Uint( hdr->avp_value->u32 );
+            break;
+         }
+         case AVP_TYPE_UNSIGNED64:
+         {
+            writer.Key( ade->getAvpName().c_str(), ade->getAvpName().length() );
+            writer.Uint64( hdr->avp_value->u64 );
+            break;
+         }
+         case AVP_TYPE_FLOAT32:
+         {
+            writer.Key( ade->getAvpName().c_str(), ade->getAvpName().length() );
+            writer.Double( hdr->avp_value->f32 );
+            break;
+         }
+         case AVP_TYPE_FLOAT64:
+         {
+            writer.Key( ade->getAvpName().c_str(), ade->getAvpName().length() );
+            writer.Double( hdr->avp_value->f64 );
+            break;
+         }
+         case AVP_TYPE_GROUPED:
+         {
+            writer.Key( ade->getAvpName().c_str(), ade->getAvpName().length() );
+            writer.StartObject();
+            fdJsonWriteMembers( a, writer, scratch );
+            writer.EndObject();
+            break;
+         }
+         default:
+         {
          }
-      }
-      else
-      {
-         throw runtimeInfo(
-            string_format("%s:%d - INFO - Unable to retrieve the AVP header for [%s]",
-            __FILE__, __LINE__, dictData.avp_name)
-         );
       }
    } while ( fd_msg_browse_internal( a, MSG_BRW_NEXT, (msg_or_avp**)&a, NULL ) == 0 );
 }
 
-static std::string fdJsonGetName( msg_or_avp * ref )
+static const char *fdJsonGetName( msg_or_avp * ref )
 {
    int ret;
    msg_or_avp *parent;
@@ -1002,16 +1375,7 @@ static std::string fdJsonGetName( msg_or_avp * ref )
 
    if ( isAvp )
    {
-      struct dict_avp_data ad;
-
-      ret = fd_dict_getval( model, &ad );
-      if ( ret != 0 )
-         throw runtimeError(
-            string_format("%s:%d - ERROR - error fd_dict_getval() returned %d",
-               __FILE__, __LINE__, ret )
-         );
-
-      return std::string( ad.avp_name );
+      return AvpDictionaryCache::getInstance().find( model )->getAvpName().c_str();
    }
    else
    {
@@ -1024,41 +1388,40 @@ static std::string fdJsonGetName( msg_or_avp * ref )
                __FILE__, __LINE__, ret )
          );
 
-      return std::string( cd.cmd_name );
+      return cd.cmd_name;
    }
 }
 
 void fdJsonGetJSON( msg_or_avp *ref, std::string &json, void (*errfunc)(const char *) )
 {
-   RAPIDJSON_NAMESPACE::Document doc;
-   RAPIDJSON_NAMESPACE::Document::AllocatorType& allocator = doc.GetAllocator();
+   std::vector<char> scratch;
 
-   // define the document as an object
-   doc.SetObject();
+   /* the output is written directly to json, reusing any existing capacity */
+   json.clear();
 
    try
    {
-      RAPIDJSON_NAMESPACE::Value object( RAPIDJSON_NAMESPACE::kObjectType );
-
-      fdJsonAddMembers( ref, object, allocator );
-
-      std::string name = fdJsonGetName( ref );
-      RAPIDJSON_NAMESPACE::Value vname;
-      vname.SetString( name.c_str(), name.length(), allocator );
-
-      doc.AddMember( vname, object, allocator );
-
-      RAPIDJSON_NAMESPACE::StringBuffer sb;
-      RAPIDJSON_NAMESPACE::Writer<RAPIDJSON_NAMESPACE::StringBuffer> writer(sb);
-      doc.Accept(writer);
-
-      json = sb.GetString();
+      JsonStringStream os( json );
+      JsonWriter writer( os );
+
+      writer.StartObject();
+      writer.Key( fdJsonGetName( ref ) );
+      writer.StartObject();
+      fdJsonWriteMembers( ref, writer, scratch );
+      writer.EndObject();
+      writer.EndObject();
    }
    catch (runtimeError &ex)
    {
+      json.clear();
       errfunc( ex.what() );
       return;
    }
+   catch (...)
+   {
+      json.clear();
+      throw;
+   }
 }
 
 const char *fdJsonGetJSON( msg_or_avp *ref, void (*errfunc)(const char *) )
@@ -34,67 +34,67 @@ Void EMessage::unserialize(pVoid pBuffer, ULong &nOffset)
 
 Void EMessage::pack(Bool val, pVoid pBuffer, ULong &nOffset)
 {
-   *((Bool *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(Bool));
    nOffset += sizeof(Bool);
 }
 
 Void EMessage::pack(Char val, pVoid pBuffer, ULong &nOffset)
 {
-   *((Char *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(Char));
    nOffset += sizeof(Char);
 }
 
 Void EMessage::pack(UChar val, pVoid pBuffer, ULong &nOffset)
 {
-   *((UChar *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(UChar));
    nOffset += sizeof(UChar);
 }
 
 Void EMessage::pack(Short val, pVoid pBuffer, ULong &nOffset)
 {
-   *((Short *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(Short));
    nOffset += sizeof(Short);
 }
 
 Void EMessage::pack(UShort val, pVoid pBuffer, ULong &nOffset)
 {
-   *((UShort *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(UShort));
    nOffset += sizeof(UShort);
 }
 
 Void EMessage::pack(Long val, pVoid pBuffer, ULong &nOffset)
 {
-   *((Long *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(Long));
    nOffset += sizeof(Long);
 }
 
 Void EMessage::pack(ULong val, pVoid pBuffer, ULong &nOffset)
 {
-   *((ULong *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(ULong));
    nOffset += sizeof(ULong);
 }
 
 Void EMessage::pack(LongLong val, pVoid pBuffer, ULong &nOffset)
 {
-   *((LongLong *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(LongLong));
    nOffset += sizeof(LongLong);
 }
 
 Void EMessage::pack(ULongLong val, pVoid pBuffer, ULong &nOffset)
 {
-   *((ULongLong *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(ULongLong));
    nOffset += sizeof(ULongLong);
 }
 
 Void EMessage::pack(Float val, pVoid pBuffer, ULong &nOffset)
 {
-   *((Float *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(Float));
    nOffset += sizeof(Float);
 }
 
 Void EMessage::pack(Double val, pVoid pBuffer, ULong &nOffset)
 {
-   *((Double *)(&((pStr)pBuffer)[nOffset])) = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &val, sizeof(Double));
    nOffset += sizeof(Double);
 }
 
@@ -108,18 +108,19 @@ Void EMessage::pack(cpStr val, pVoid pBuffer, ULong &nOffset)
 
 Void EMessage::pack(ETimer &val, pVoid pBuffer, ULong &nOffset)
 {
-   *((epctime_t *)(&((pStr)pBuffer)[nOffset])) = val;
+   epctime_t t = val;
+   memcpy(&((pStr)pBuffer)[nOffset], &t, sizeof(epctime_t));
    nOffset += sizeof(epctime_t);
 }
 
 Void EMessage::pack(ETime &val, pVoid pBuffer, ULong &nOffset)
 {
-   //((timeval*)(&((pStr)pBuffer)[nOffset]))->tv_sec = val.getTimeVal().tv_sec;
-   *((LongLong *)(&((pStr)pBuffer)[nOffset])) = (LongLong)val.getTimeVal().tv_sec;
+   LongLong sec = (LongLong)val.getTimeVal().tv_sec;
+   memcpy(&((pStr)pBuffer)[nOffset], &sec, sizeof(LongLong));
    nOffset += sizeof(LongLong);
 
-   //((timeval*)(&((pStr)pBuffer)[nOffset]))->tv_usec = val.getTimeVal().tv_usec;
-   *((LongLong *)(&((pStr)pBuffer)[nOffset])) = (LongLong)val.getTimeVal().tv_usec;
+   LongLong usec = (LongLong)val.getTimeVal().tv_usec;
+   memcpy(&((pStr)pBuffer)[nOffset], &usec, sizeof(LongLong));
    nOffset += sizeof(LongLong);
 }
 
@@ -133,67 +134,67 @@ Void EMessage::pack(EString &val, pVoid pBuffer, ULong &nOffset)
 
 Void EMessage::unpack(Bool &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((Bool *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
 Void EMessage::unpack(Char &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((Char *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
 Void EMessage::unpack(UChar &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((UChar *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
 Void EMessage::unpack(Short &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((Short *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
 Void EMessage::unpack(UShort &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((UShort *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
 Void EMessage::unpack(Long &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((Long *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
 Void EMessage::unpack(ULong &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((ULong *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
 Void EMessage::unpack(LongLong &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((LongLong *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
 Void EMessage::unpack(ULongLong &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((ULongLong *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
 Void EMessage::unpack(Float &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((Float *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
 Void EMessage::unpack(Double &val, pVoid pBuffer, ULong &nOffset)
 {
-   val = *((Double *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&val, &((pStr)pBuffer)[nOffset], sizeof(val));
    nOffset += sizeof(val);
 }
 
@@ -209,17 +210,22 @@ Void EMessage::unpack(pStr val, pVoid pBuffer, ULong &nOffset)
 
 Void EMessage::unpack(ETimer &val, pVoid pBuffer, ULong &nOffset)
 {
-   val.Set(*((epctime_t *)(&((pStr)pBuffer)[nOffset])));
+   epctime_t t;
+   memcpy(&t, &((pStr)pBuffer)[nOffset], sizeof(epctime_t));
+   val.Set(t);
    nOffset += sizeof(epctime_t);
 }
 
 Void EMessage::unpack(ETime &val, pVoid pBuffer, ULong &nOffset)
 {
    timeval tv;
+   LongLong t;
 
-   tv.tv_sec = (time_t) * ((LongLong *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&t, &((pStr)pBuffer)[nOffset], sizeof(LongLong));
+   tv.tv_sec = (time_t)t;
    nOffset += sizeof(LongLong);
-   tv.tv_usec = (time_t) * ((LongLong *)(&((pStr)pBuffer)[nOffset]));
+   memcpy(&t, &((pStr)pBuffer)[nOffset], sizeof(LongLong));
+   tv.tv_usec = (time_t)t;
    nOffset += sizeof(LongLong);
 
    val.set(tv);
@@ -15,9 +15,11 @@
 */
 
 #include <stdlib.h>
+#include <string.h>
 #include <iostream>
 
 #include "epcdns.h"
+#include "ehash.h"
 
 using namespace EPCDNS;
 
@@ -803,6 +805,359 @@ const char *Utility::getDiameterProtocol( DiameterProtocolEnum protocol )
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+/// @cond DOXYGEN_EXCLUDE
+class FqdnBuffer
+{
+public:
+   FqdnBuffer( char *buf, size_t len )
+      : m_buf( buf ),
+        m_len( len ),
+        m_ofs( 0 ),
+        m_ok( buf != NULL && len > 0 )
+   {
+   }
+
+   FqdnBuffer &append( const char *s ) { return append( s, strlen(s) ); }
+   FqdnBuffer &append( const char *s, size_t n )
+   {
+      // leave room for the NULL terminator
+      if ( m_ok && m_ofs + n < m_len )
+      {
+         memcpy( &m_buf[m_ofs], s, n );
+         m_ofs += n;
+      }
+      else
+      {
+         m_ok = False;
+      }
+      return *this;
+   }
+
+   size_t finish()
+   {
+      if ( !m_ok )
+      {
+         if ( m_buf && m_len > 0 )
+            m_buf[0] = '\0';
+         return 0;
+      }
+      m_buf[m_ofs] = '\0';
+      return m_ofs;
+   }
+
+private:
+   char *m_buf;
+   size_t m_len;
+   size_t m_ofs;
+   Bool m_ok;
+};
+/// @endcond
+
+size_t Utility::home_network( char *buf, size_t len, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::home_network_gprs( char *buf, size_t len, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( plmn.getGprs(), plmn.getGprsLength() );
+
+   return b.finish();
+}
+
+size_t Utility::tai_fqdn( char *buf, size_t len, const char *lb, const char *hb, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "tac-lb", 6 )
+    .append( lb )
+    .append( ".tac-hb", 7 )
+    .append( hb )
+    .append( ".tac.epc.", 9 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::mme_fqdn( char *buf, size_t len, const char *mmec, const char *mmegi, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "mmec", 4 )
+    .append( mmec )
+    .append( ".mmegi", 6 )
+    .append( mmegi )
+    .append( ".mme.epc.", 9 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::mme_pool_fqdn( char *buf, size_t len, const char *mmegi, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "mmegi", 5 )
+    .append( mmegi )
+    .append( ".mme.epc.", 9 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::rai_fqdn( char *buf, size_t len, const char *rac, const char *lac, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "rac", 3 )
+    .append( rac )
+    .append( ".lac", 4 )
+    .append( lac )
+    .append( ".rac.epc.", 9 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::rnc_fqdn( char *buf, size_t len, const char *rnc, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "rnc", 3 )
+    .append( rnc )
+    .append( ".rnc.epc.", 9 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::sgsn_fqdn( char *buf, size_t len, const char *nri, const char *rac, const char *lac, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "nri", 3 )
+    .append( nri )
+    .append( ".rac", 4 )
+    .append( rac )
+    .append( ".lac", 4 )
+    .append( lac )
+    .append( ".rac.epc.", 9 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::epc_nodes_domain_fqdn( char *buf, size_t len, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "node.epc.", 9 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::epc_node_fqdn( char *buf, size_t len, const char *node, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( node )
+    .append( ".node.epc.", 10 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::nonemergency_epdg_oi_fqdn( char *buf, size_t len, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "epdg.epc.", 9 )
+    .append( plmn.getPublic(), plmn.getPublicLength() );
+
+   return b.finish();
+}
+
+size_t Utility::nonemergency_epdg_tai_fqdn( char *buf, size_t len, const char *lb, const char *hb, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "tac-lb", 6 )
+    .append( lb )
+    .append( ".tac-hb", 7 )
+    .append( hb )
+    .append( ".tac.epdg.epc.", 14 )
+    .append( plmn.getPublic(), plmn.getPublicLength() );
+
+   return b.finish();
+}
+
+size_t Utility::nonemergency_epdg_lac_fqdn( char *buf, size_t len, const char *lac, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "lac", 3 )
+    .append( lac )
+    .append( ".epdg.epc.", 10 )
+    .append( plmn.getPublic(), plmn.getPublicLength() );
+
+   return b.finish();
+}
+
+size_t Utility::nonemergency_epdg_visitedcountry_fqdn( char *buf, size_t len, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "epdg.epc.", 9 )
+    .append( plmn.getVisitedCountry(), plmn.getVisitedCountryLength() );
+
+   return b.finish();
+}
+
+size_t Utility::emergency_epdg_oi_fqdn( char *buf, size_t len, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "sos.epdg.epc.", 13 )
+    .append( plmn.getPublic(), plmn.getPublicLength() );
+
+   return b.finish();
+}
+
+size_t Utility::emergency_epdg_tai_fqdn( char *buf, size_t len, const char *lb, const char *hb, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "tac-lb", 6 )
+    .append( lb )
+    .append( ".tac-hb", 7 )
+    .append( hb )
+    .append( ".tac.sos.epdg.epc.", 18 )
+    .append( plmn.getPublic(), plmn.getPublicLength() );
+
+   return b.finish();
+}
+
+size_t Utility::emergency_epdg_lac_fqdn( char *buf, size_t len, const char *lac, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "lac", 3 )
+    .append( lac )
+    .append( ".sos.epdg.epc.", 14 )
+    .append( plmn.getPublic(), plmn.getPublicLength() );
+
+   return b.finish();
+}
+
+size_t Utility::emergency_epdg_visitedcountry_fqdn( char *buf, size_t len, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "sos.epdg.epc.", 13 )
+    .append( plmn.getVisitedCountry(), plmn.getVisitedCountryLength() );
+
+   return b.finish();
+}
+
+size_t Utility::global_enodeb_id_fqdn( char *buf, size_t len, const char *enb, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "enb", 3 )
+    .append( enb )
+    .append( ".enb.epc.", 9 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::local_homenetwork_fqdn( char *buf, size_t len, const char *lhn, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "lhn", 3 )
+    .append( lhn )
+    .append( ".lhn.epc.", 9 )
+    .append( plmn.getVisitedCountry(), plmn.getVisitedCountryLength() );
+
+   return b.finish();
+}
+
+size_t Utility::epc( char *buf, size_t len, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "epc.", 4 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::apn_fqdn( char *buf, size_t len, const char *apn, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( apn )
+    .append( ".apn.epc.", 9 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+size_t Utility::apn( char *buf, size_t len, const char *_apn, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( _apn )
+    .append( ".apn.", 5 )
+    .append( plmn.getGprs(), plmn.getGprsLength() );
+
+   return b.finish();
+}
+
+size_t Utility::diameter_fqdn( char *buf, size_t len, const PlmnSuffix &plmn )
+{
+   FqdnBuffer b( buf, len );
+
+   b.append( "diameter.epc.", 13 )
+    .append( plmn.getNetwork(), plmn.getNetworkLength() );
+
+   return b.finish();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+Void PlmnSuffix::set( const char *mnc, const char *mcc )
+{
+   m_networklen = snprintf( m_network, sizeof(m_network), "mnc%s.mcc%s.3gppnetwork.org", mnc, mcc );
+   m_publiclen = snprintf( m_public, sizeof(m_public), "mnc%s.mcc%s.pub.3gppnetwork.org", mnc, mcc );
+   m_visitedcountrylen = snprintf( m_visitedcountry, sizeof(m_visitedcountry), "mcc%s.visited-country.pub.3gppnetwork.org", mcc );
+   m_gprslen = snprintf( m_gprs, sizeof(m_gprs), "mnc%s.mcc%s.gprs", mnc, mcc );
+
+   // guard against truncation
+   m_networklen = std::min( m_networklen, sizeof(m_network) - 1 );
+   m_publiclen = std::min( m_publiclen, sizeof(m_public) - 1 );
+   m_visitedcountrylen = std::min( m_visitedcountrylen, sizeof(m_visitedcountry) - 1 );
+   m_gprslen = std::min( m_gprslen, sizeof(m_gprs) - 1 );
+}
+
+Void PlmnSuffix::set( const unsigned char *plmnid )
+{
+   PARSE_PLMNID( plmnid );
+   set( mnc, mcc );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 CanonicalNodeName::CanonicalNodeName()
    : m_topon( False )
 {
@@ -908,11 +1263,62 @@ Void NodeSelector::process(cpVoid data, AsyncNodeSelectorCallback cb)
 
 NodeSelectorResultList &NodeSelector::process(DNS::QueryPtr query, Bool cacheHit)
 {
-   std::list<AppProtocolEnum> supportedProtocols;
-
    // process the dns query results
    m_query = query;
 
+   if ( !m_cacheresults )
+   {
+      // do not append to a result list that is shared with the result cache
+      if ( m_sharedresults )
+      {
+         m_results.reset( new NodeSelectorResultList() );
+         m_sharedresults = False;
+      }
+
+      buildResults( *m_results );
+      return *m_results;
+   }
+
+   // check the result cache for results built from this dns query
+   EString key( getCriteriaKey() );
+   ULong hash = EHash::getHash( key.c_str(), key.length() );
+
+   NodeSelectorResultListPtr results = NodeSelectorResultCache::getInstance().lookup( hash, key, m_query );
+   if ( !results )
+   {
+      results.reset( new NodeSelectorResultList() );
+      buildResults( *results );
+      NodeSelectorResultCache::getInstance().update( hash, key, m_query, results );
+   }
+
+   m_results = results;
+   m_sharedresults = True;
+
+   return *m_results;
+}
+
+EString NodeSelector::getCriteriaKey()
+{
+   std::ostringstream key;
+
+   key << m_nsid << '|' << m_domain << '|' << (int)m_desiredService << '|';
+
+   for ( AppProtocolList::const_iterator it = m_desiredProtocols.begin(); it != m_desiredProtocols.end(); ++it )
+      key << (int)(*it)->getProtocol() << ',';
+   key << '|';
+
+   for ( UsageTypeList::const_iterator it = m_desiredUsageTypes.begin(); it != m_desiredUsageTypes.end(); ++it )
+      key << *it << ',';
+   key << '|';
+
+   for ( NetworkCapabilityList::const_iterator it = m_desiredNetworkCapabilities.begin(); it != m_desiredNetworkCapabilities.end(); ++it )
+      key << *it << ',';
+
+   return key.str();
+}
+
+Void NodeSelector::buildResults(NodeSelectorResultList &results)
+{
    // evaluate each answer to see if it matches the service/protocol requirements
    for (std::list<DNS::ResourceRecord*>::const_iterator rrit = m_query->getAnswers().begin();
         rrit != m_query->getAnswers().end();
@@ -1038,7 +1444,7 @@ NodeSelectorResultList &NodeSelector::process(DNS::QueryPtr query, Bool cacheHit
             nsr->getIPv6Hosts().shuffle();
 
             // add the nsr pointer to the list since at least 1 protocol matched
-            m_results.push_back( nsr );
+            results.push_back( nsr );
          }
          else
          {
@@ -1049,15 +1455,16 @@ NodeSelectorResultList &NodeSelector::process(DNS::QueryPtr query, Bool cacheHit
    }
 
    // sort the naptr list
-   m_results.sort( NodeSelectorResultList::sort_compare );
-      
-   return m_results;
+   results.sort( NodeSelectorResultList::sort_compare );
 }
 
 NodeSelector::NodeSelector()
+   : m_results( new NodeSelectorResultList() )
 {
    m_nsid = DNS::NS_DEFAULT;
    m_query = NULL;
+   m_cacheresults = False;
+   m_sharedresults = False;
 }
 
 NodeSelector::~NodeSelector()
@@ -1073,6 +1480,84 @@ NodeSelector::~NodeSelector()
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+NodeSelectorResultCache &NodeSelectorResultCache::getInstance()
+{
+   static NodeSelectorResultCache cache;
+   return cache;
+}
+
+NodeSelectorResultListPtr NodeSelectorResultCache::lookup( ULong hash, const EString &key, const DNS::QueryPtr &query )
+{
+   ERDLock l( m_lock );
+
+   auto it = m_entries.find( hash );
+   if ( it == m_entries.end() || it->second.key != key || it->second.query != query )
+      return NodeSelectorResultListPtr();
+
+   // the read lock is shared, so the recency stamp is updated atomically
+   it->second.used.store( m_clock.fetch_add( 1, std::memory_order_relaxed ), std::memory_order_relaxed );
+
+   return it->second.results;
+}
+
+Void NodeSelectorResultCache::update( ULong hash, const EString &key, const DNS::QueryPtr &query, const NodeSelectorResultListPtr &results )
+{
+   EWRLock l( m_lock );
+
+   if ( m_entries.find( hash ) == m_entries.end() )
+   {
+      while ( m_entries.size() >= m_maxentries )
+         evict();
+   }
+
+   Entry &e = m_entries[hash];
+   e.key = key;
+   e.query = query;
+   e.results = results;
+   e.used.store( m_clock.fetch_add( 1, std::memory_order_relaxed ), std::memory_order_relaxed );
+}
+
+Void NodeSelectorResultCache::evict()
+{
+   // the caller holds the write lock
+
+   // remove the entries built from expired dns queries
+   for ( auto it = m_entries.begin(); it != m_entries.end(); )
+   {
+      if ( !it->second.query || it->second.query->isExpired() )
+         it = m_entries.erase( it );
+      else
+         ++it;
+   }
+
+   if ( m_entries.size() < m_maxentries || m_entries.empty() )
+      return;
+
+   // remove the least recently used entry
+   auto lru = m_entries.begin();
+   for ( auto it = m_entries.begin(); it != m_entries.end(); ++it )
+   {
+      if ( it->second.used.load( std::memory_order_relaxed ) < lru->second.used.load( std::memory_order_relaxed ) )
+         lru = it;
+   }
+   m_entries.erase( lru );
+}
+
+Void NodeSelectorResultCache::clear()
+{
+   EWRLock l( m_lock );
+   m_entries.clear();
+}
+
+size_t NodeSelectorResultCache::size()
+{
+   ERDLock l( m_lock );
+   return m_entries.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 Bool NodeSelectorResultList::sort_compare( NodeSelectorResult*& first, NodeSelectorResult*& second )
 {
    if ( first->getOrder() < second->getOrder() )
@@ -1152,6 +1637,21 @@ ColocatedCandidate::ColocatedCandidate( NodeSelectorResult &candidate1, NodeSele
    m_cnn1.setName( m_candidate1.getHostname() );
    m_cnn2.setName( m_candidate2.getHostname() );
 
+   classify();
+}
+
+ColocatedCandidate::ColocatedCandidate( NodeSelectorResult &candidate1, NodeSelectorResult &candidate2,
+                                        const CanonicalNodeName &cnn1, const CanonicalNodeName &cnn2 )
+   : m_candidate1( candidate1 ),
+     m_candidate2( candidate2 ),
+     m_cnn1( cnn1 ),
+     m_cnn2( cnn2 )
+{
+   classify();
+}
+
+Void ColocatedCandidate::classify()
+{
    m_pairtype =
       m_cnn1.getName() == m_cnn2.getName() ? ptColocated :
       m_cnn1.getTopon() && m_cnn2.getTopon() ? ptTopologicalDistance : ptDNSPriority;
@@ -1164,21 +1664,12 @@ ColocatedCandidateList::ColocatedCandidateList( NodeSelectorResultList &nodelist
    : m_nodelist1( nodelist1 ),
      m_nodelist2( nodelist2 )
 {
-   // create all of the colocated candidate pairs (which also classifies them)
-   for ( NodeSelectorResultList::const_iterator it1 = m_nodelist1.begin();
-         it1 != m_nodelist1.end();
-         ++it1 )
-   {
-      for( NodeSelectorResultList::const_iterator it2 = m_nodelist2.begin();
-           it2 != m_nodelist2.end();
-           it2++ )
-      {
-         ColocatedCandidate *cc = new ColocatedCandidate( *(*it1), *(*it2) );
-         push_back( cc );
-      }
-   }
+   // the selector produces the candidate pairs already in sorted order
+   ColocatedCandidateSelector selector( m_nodelist1, m_nodelist2 );
+   ColocatedCandidate *cc;
 
-   sort( ColocatedCandidateList::sort_compare );
+   while ( (cc = selector.next()) )
+      push_back( cc );
 }
 
 ColocatedCandidateList::~ColocatedCandidateList()
@@ -1191,57 +1682,284 @@ ColocatedCandidateList::~ColocatedCandidateList()
    }
 }
 
-Bool ColocatedCandidateList::sort_compare( ColocatedCandidate*& first, ColocatedCandidate*& second )
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+ColocatedCandidateSelector::ColocatedCandidateSelector( NodeSelectorResultList &nodelist1, NodeSelectorResultList &nodelist2 )
 {
-   // sort by pairtype ascending
-   if ( (int)first->getPairType() < (int)second->getPairType() )
-      return True;
-   if ( (int)first->getPairType() > (int)second->getPairType() )
-      return False;
+   size_t idx;
 
-   // sort by the candidate1 order
-   if ( first->getCandidate1().getOrder() < second->getCandidate1().getOrder() )
-      return True;
-   if ( first->getCandidate1().getOrder() > second->getCandidate1().getOrder() )
-      return False;
+   // parse the canonical node names once per node
+   m_nodes1.reserve( nodelist1.size() );
+   idx = 0;
+   for ( NodeSelectorResultList::const_iterator it = nodelist1.begin(); it != nodelist1.end(); ++it )
+   {
+      m_nodes1.push_back( Node() );
+      Node &n = m_nodes1.back();
+      n.nsr = *it;
+      n.cnn.setName( (*it)->getHostname() );
+      n.index = idx++;
+      n.colocated = NULL;
+   }
+
+   m_nodes2.reserve( nodelist2.size() );
+   idx = 0;
+   for ( NodeSelectorResultList::const_iterator it = nodelist2.begin(); it != nodelist2.end(); ++it )
+   {
+      m_nodes2.push_back( Node() );
+      Node &n = m_nodes2.back();
+      n.nsr = *it;
+      n.cnn.setName( (*it)->getHostname() );
+      n.index = idx;
+      n.colocated = NULL;
+
+      // group the second list by canonical node name
+      m_names2[n.cnn.getName()].push_back( idx );
+      if ( n.cnn.getTopon() )
+         m_topon2.push_back( idx );
+      idx++;
+   }
 
-   // sort by the candidate1 preference
-   return first->getCandidate1().getPreference() < second->getCandidate1().getPreference();
+   // order the first list by order/preference (original position breaks ties)
+   std::sort( m_nodes1.begin(), m_nodes1.end(), node_compare );
+
+   for ( std::vector<Node>::iterator it = m_nodes1.begin(); it != m_nodes1.end(); ++it )
+   {
+      auto grp = m_names2.find( it->cnn.getName() );
+      if ( grp != m_names2.end() )
+         it->colocated = &grp->second;
+   }
+
+   reset();
+}
+
+Void ColocatedCandidateSelector::reset()
+{
+   m_pairtype = ColocatedCandidate::ptColocated;
+   m_pos1 = 0;
+   m_pos2 = 0;
+}
+
+ColocatedCandidate *ColocatedCandidateSelector::next()
+{
+   size_t idx1, idx2;
+
+   if ( !nextPair( idx1, idx2 ) )
+      return NULL;
+
+   Node &n1 = m_nodes1[idx1];
+   Node &n2 = m_nodes2[idx2];
+
+   return new ColocatedCandidate( *n1.nsr, *n2.nsr, n1.cnn, n2.cnn );
+}
+
+Bool ColocatedCandidateSelector::nextPair( size_t &idx1, size_t &idx2 )
+{
+   // the candidates are produced by pair type, then in candidate 1 order and
+   //  then in candidate 2 order, which is the ColocatedCandidateList ordering
+   while ( m_pairtype <= ColocatedCandidate::ptDNSPriority )
+   {
+      if ( m_pos1 >= m_nodes1.size() )
+      {
+         m_pairtype = (ColocatedCandidate::PairType)((int)m_pairtype + 1);
+         m_pos1 = 0;
+         m_pos2 = 0;
+         continue;
+      }
+
+      Node &n1 = m_nodes1[m_pos1];
+
+      switch ( m_pairtype )
+      {
+         case ColocatedCandidate::ptColocated:
+         {
+            if ( n1.colocated && m_pos2 < n1.colocated->size() )
+            {
+               idx1 = m_pos1;
+               idx2 = (*n1.colocated)[m_pos2++];
+               return True;
+            }
+            break;
+         }
+         case ColocatedCandidate::ptTopologicalDistance:
+         {
+            while ( n1.cnn.getTopon() && m_pos2 < m_topon2.size() )
+            {
+               size_t i2 = m_topon2[m_pos2++];
+               if ( m_nodes2[i2].cnn.getName() != n1.cnn.getName() )
+               {
+                  idx1 = m_pos1;
+                  idx2 = i2;
+                  return True;
+               }
+            }
+            break;
+         }
+         default:
+         {
+            while ( m_pos2 < m_nodes2.size() )
+            {
+               Node &n2 = m_nodes2[m_pos2++];
+               if ( n2.cnn.getName() != n1.cnn.getName() && !(n1.cnn.getTopon() && n2.cnn.getTopon()) )
+               {
+                  idx1 = m_pos1;
+                  idx2 = n2.index;
+                  return True;
+               }
+            }
+            break;
+         }
+      }
+
+      // move to the next node in the first list
+      m_pos1++;
+      m_pos2 = 0;
+   }
+
+   return False;
+}
+
+Bool ColocatedCandidateSelector::node_compare( const Node &first, const Node &second )
+{
+   if ( first.nsr->getOrder() != second.nsr->getOrder() )
+      return first.nsr->getOrder() < second.nsr->getOrder();
+
+   if ( first.nsr->getPreference() != second.nsr->getPreference() )
+      return first.nsr->getPreference() < second.nsr->getPreference();
+
+   return first.index < second.index;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+/// @cond DOXYGEN_EXCLUDE
+struct DiameterSelector::AsyncQuery
+{
+   DiameterSelector *selector;
+   ns_type type;
+   EString domain;
+   DiameterNaptrS *naptr;
+   DiameterHost *host;
+};
+/// @endcond
+
+static Bool addHostAddresses( DiameterHost &host, const char *name, const DNS::ResourceRecordList &rrl )
+{
+   Bool found = False;
+
+   // add all of the A/AAAA records for the host (any name if name is NULL)
+   for ( DNS::ResourceRecordList::const_iterator rr = rrl.begin(); rr != rrl.end(); ++rr )
+   {
+      if ( name && (*rr)->getName() != name )
+         continue;
+
+      switch ( (*rr)->getType() )
+      {
+         case ns_t_a:
+         {
+            host.addIPv4Address( ((DNS::RRecordA*)*rr)->getAddressString() );
+            found = True;
+            break;
+         }
+         case ns_t_aaaa:
+         {
+            host.addIPv6Address( ((DNS::RRecordAAAA*)*rr)->getAddressString() );
+            found = True;
+            break;
+         }
+         default:
+         {
+            break;
+         }
+      }
+   }
+
+   return found;
+}
+
+static DiameterSrv *createSrv( DNS::RRecordSRV *rrs, const DNS::ResourceRecordList &additional, Bool &resolved )
+{
+   DiameterSrv *ds = new DiameterSrv();
+
+   // set the SRV properties
+   ds->setPriority( rrs->getPriority() );
+   ds->setWeight( rrs->getWeight() );
+   ds->setPort( rrs->getPort() );
+   ds->getHost().setName( rrs->getTarget() );
+
+   // add the additional records that match the SRV hostname
+   resolved = addHostAddresses( ds->getHost(), rrs->getTarget().c_str(), additional );
+
+   // randomize the ip addresses
+   ds->getHost().getIPv4Addresses().shuffle();
+   ds->getHost().getIPv6Addresses().shuffle();
+
+   return ds;
+}
+
 DiameterSelector::DiameterSelector()
-   : m_application( dia_app_unknown ),
-     m_protocol( dia_protocol_unknown )
+   : m_nsid( DNS::NS_DEFAULT ),
+     m_application( dia_app_unknown ),
+     m_protocol( dia_protocol_unknown ),
+     m_pending( 0 ),
+     m_asynccb( NULL ),
+     m_asyncdata( NULL )
 {
 }
 
+Bool DiameterSelector::validate()
+{
+   // validate m_applciation, m_protocol and the realm
+   return m_application != dia_app_unknown &&
+          m_protocol != dia_protocol_unknown &&
+          !m_realm.empty();
+}
+
 DiameterNaptrList &DiameterSelector::process()
 {
-   // validate m_applciation
-   if ( m_application == dia_app_unknown )
+   if ( !validate() )
       return m_results;
 
-   // validate m_protocol
-   if ( m_protocol == dia_protocol_unknown )
-      return m_results;
+   // perform dns query
+   Bool cacheHit = False;
+   m_query = DNS::Cache::getInstance(m_nsid).query( ns_t_naptr, m_realm, cacheHit );
 
-   // validate realm
-   if ( m_realm.empty() )
-      return m_results;
+   processNaptr( m_query, NULL );
 
+   return m_results;
+}
+
+Void DiameterSelector::process(cpVoid data, AsyncDiameterSelectorCallback cb)
+{
+   m_asynccb = cb;
+   m_asyncdata = data;
+
+   if ( !validate() )
+   {
+      if ( m_asynccb )
+         (*m_asynccb)( *this, m_asyncdata );
+      return;
+   }
+
+   AsyncQueryList queries;
+
+   // the initial pending count keeps the lookup from completing until all
+   // of the queries have been submitted
+   m_pending = 1;
+   addFollowup( &queries, ns_t_naptr, m_realm, NULL, NULL );
+   beginAsyncQueries( queries );
+   endAsyncQuery();
+}
+
+Void DiameterSelector::processNaptr( DNS::QueryPtr query, AsyncQueryList *followups )
+{
    // construct the service string
    EString service( Utility::getDiameterService( m_application, m_protocol ) );
 
-   // perform dns query
-   Bool cacheHit = False;
-   m_query = DNS::Cache::getInstance().query( ns_t_naptr, m_realm, cacheHit );
-
    // evaluate each answer to see if it matches the service/protocol requirements
-   for ( std::list<DNS::ResourceRecord*>::const_iterator rrit = m_query->getAnswers().begin();
-         rrit != m_query->getAnswers().end();
+   for ( std::list<DNS::ResourceRecord*>::const_iterator rrit = query->getAnswers().begin();
+         rrit != query->getAnswers().end();
          ++rrit )
    {
       DNS::RRecordNAPTR* naptr = (DNS::RRecordNAPTR*)*rrit;
@@ -1272,31 +1990,11 @@ DiameterNaptrList &DiameterSelector::process()
             // set the host name
             a->getHost().setName( n->getReplacement() );
 
-            // add all of the A/AAAA records for the host
-            for ( DNS::ResourceRecordList::const_iterator rr = m_query->getAdditional().begin();
-                  rr != m_query->getAdditional().end();
-                  ++rr)
+            // add all of the A/AAAA records for the host, query for them if not present
+            if ( !addHostAddresses( a->getHost(), a->getHost().getName().c_str(), query->getAdditional() ) )
             {
-               if ( (*rr)->getName() == a->getHost().getName() )
-               {
-                  switch ( (*rr)->getType() )
-                  {
-                     case ns_t_a:
-                     {
-                        a->getHost().addIPv4Address( ((DNS::RRecordA*)*rr)->getAddressString() );
-                        break;
-                     }
-                     case ns_t_aaaa:
-                     {
-                        a->getHost().addIPv6Address( ((DNS::RRecordAAAA*)*rr)->getAddressString() );
-                        break;
-                     }
-                     default:
-                     {
-                        break;
-                     }
-                  }
-               }
+               addFollowup( followups, ns_t_a, a->getHost().getName(), NULL, &a->getHost() );
+               addFollowup( followups, ns_t_aaaa, a->getHost().getName(), NULL, &a->getHost() );
             }
 
             // randomize the ip addresses
@@ -1308,58 +2006,30 @@ DiameterNaptrList &DiameterSelector::process()
             DiameterNaptrS *s = (DiameterNaptrS*)n;
 
             // add all of the matching SRV records
-            for ( DNS::ResourceRecordList::const_iterator rr = m_query->getAdditional().begin();
-                  rr != m_query->getAdditional().end();
+            for ( DNS::ResourceRecordList::const_iterator rr = query->getAdditional().begin();
+                  rr != query->getAdditional().end();
                   ++rr)
             {
                if ( (*rr)->getType() == ns_t_srv &&  (*rr)->getName() == s->getReplacement() )
                {
-                  DNS::RRecordSRV *rrs = (DNS::RRecordSRV*)*rr;
-
-                  DiameterSrv *ds = new DiameterSrv();
+                  Bool resolved;
+                  DiameterSrv *ds = createSrv( (DNS::RRecordSRV*)*rr, query->getAdditional(), resolved );
 
-                  // set the SRV properties
-                  ds->setPriority( rrs->getPriority() );
-                  ds->setWeight( rrs->getWeight() );
-                  ds->setPort( rrs->getPort() );
-
-                  // loop through the additional records adding the hostname entries that match the SRV hostname
-                  for ( DNS::ResourceRecordList::const_iterator rr2 = m_query->getAdditional().begin();
-                        rr2 != m_query->getAdditional().end();
-                        ++rr2 )
+                  if ( !resolved )
                   {
-                     if ( (*rr2)->getName() == rrs->getTarget() )
-                     {
-                        ds->getHost().setName( (*rr2)->getName() );
-                        switch ( (*rr2)->getType() )
-                        {
-                           case ns_t_a:
-                           {
-                              ds->getHost().addIPv4Address( ((DNS::RRecordA*)*rr2)->getAddressString() );
-                              break;
-                           }
-                           case ns_t_aaaa:
-                           {
-                              ds->getHost().addIPv6Address( ((DNS::RRecordAAAA*)*rr2)->getAddressString() );
-                              break;
-                           }
-                           default:
-                           {
-                              break;
-                           }
-                        }
-                     }
+                     addFollowup( followups, ns_t_a, ds->getHost().getName(), NULL, &ds->getHost() );
+                     addFollowup( followups, ns_t_aaaa, ds->getHost().getName(), NULL, &ds->getHost() );
                   }
 
-                  // randomize the ip addresses
-                  ds->getHost().getIPv4Addresses().shuffle();
-                  ds->getHost().getIPv6Addresses().shuffle();
-
                   // add to the SRV collection
                   s->getSrvs().push_back( ds );
                }
             }
 
+            // query for the SRV records if they were not present
+            if ( s->getSrvs().empty() )
+               addFollowup( followups, ns_t_srv, s->getReplacement(), s, NULL );
+
             // sort the srv records
             s->getSrvs().sort_vector();
          }
@@ -1373,9 +2043,134 @@ DiameterNaptrList &DiameterSelector::process()
          m_results.push_back( n );
       }
    }
-   
+}
 
-   return m_results;
+Void DiameterSelector::processSrv( DiameterNaptrS &naptr, DNS::QueryPtr query, AsyncQueryList *followups )
+{
+   for ( DNS::ResourceRecordList::const_iterator rr = query->getAnswers().begin();
+         rr != query->getAnswers().end();
+         ++rr)
+   {
+      if ( (*rr)->getType() != ns_t_srv )
+         continue;
+
+      Bool resolved;
+      DiameterSrv *ds = createSrv( (DNS::RRecordSRV*)*rr, query->getAdditional(), resolved );
+
+      if ( !resolved )
+      {
+         addFollowup( followups, ns_t_a, ds->getHost().getName(), NULL, &ds->getHost() );
+         addFollowup( followups, ns_t_aaaa, ds->getHost().getName(), NULL, &ds->getHost() );
+      }
+
+      naptr.getSrvs().push_back( ds );
+   }
+}
+
+Void DiameterSelector::addFollowup( AsyncQueryList *followups, ns_type rtype, const std::string &domain, DiameterNaptrS *naptr, DiameterHost *host )
+{
+   // follow-up queries are only issued for asynchronous lookups
+   if ( !followups )
+      return;
+
+   AsyncQuery *aq = new AsyncQuery();
+   aq->selector = this;
+   aq->type = rtype;
+   aq->domain = domain;
+   aq->naptr = naptr;
+   aq->host = host;
+
+   followups->push_back( aq );
+}
+
+Void DiameterSelector::beginAsyncQueries( AsyncQueryList &queries )
+{
+   while ( !queries.empty() )
+   {
+      AsyncQuery *aq = queries.front();
+      queries.pop_front();
+
+      // the callback may be called (and aq deleted) before query() returns
+      ns_type rtype = aq->type;
+      EString domain( aq->domain );
+
+      atomic_inc( m_pending );
+      DNS::Cache::getInstance(m_nsid).query( rtype, domain, async_callback, aq );
+   }
+}
+
+Void DiameterSelector::endAsyncQuery()
+{
+   if ( atomic_dec_fetch( m_pending ) != 0 )
+      return;
+
+   finalizeResults();
+
+   if ( m_asynccb )
+      (*m_asynccb)( *this, m_asyncdata );
+}
+
+Void DiameterSelector::finalizeResults()
+{
+   // randomize the addresses and sort the SRV records added by the follow-up queries
+   for ( DiameterNaptrList::const_iterator it = m_results.begin(); it != m_results.end(); ++it )
+   {
+      if ( (*it)->getType() == dnt_hostname )
+      {
+         DiameterNaptrA *a = (DiameterNaptrA*)*it;
+         a->getHost().getIPv4Addresses().shuffle();
+         a->getHost().getIPv6Addresses().shuffle();
+      }
+      else if ( (*it)->getType() == dnt_service )
+      {
+         DiameterNaptrS *s = (DiameterNaptrS*)*it;
+         for ( DiameterSrvVector::const_iterator srv = s->getSrvs().begin(); srv != s->getSrvs().end(); ++srv )
+         {
+            (*srv)->getHost().getIPv4Addresses().shuffle();
+            (*srv)->getHost().getIPv6Addresses().shuffle();
+         }
+         s->getSrvs().sort_vector();
+      }
+   }
+}
+
+Void DiameterSelector::async_callback( DNS::QueryPtr q, Bool cacheHit, const void *data )
+{
+   AsyncQuery *aq = (AsyncQuery*)data;
+   DiameterSelector *ds = aq->selector;
+   AsyncQueryList followups;
+
+   if ( q && !q->getError() )
+   {
+      EMutexLock l( ds->m_mutex );
+
+      switch ( aq->type )
+      {
+         case ns_t_naptr:
+         {
+            ds->m_query = q;
+            ds->processNaptr( q, &followups );
+            break;
+         }
+         case ns_t_srv:
+         {
+            ds->processSrv( *aq->naptr, q, &followups );
+            break;
+         }
+         default:
+         {
+            addHostAddresses( *aq->host, NULL, q->getAnswers() );
+            break;
+         }
+      }
+   }
+
+   delete aq;
+
+   // issue the follow-up queries (outside of the lock since cached results
+   // will call this callback before returning)
+   ds->beginAsyncQueries( followups );
+   ds->endAsyncQuery();
 }
 
 Void DiameterSrvVector::sort_vector()
@@ -1433,8 +2228,9 @@ Void DiameterSrvVector::sort_vector()
                }
             }
 
-            // save the pointers in sorted order
-            DiameterSrvVector newsorted;
+            // save the pointers in sorted order (a plain vector so the
+            // DiameterSrv objects are not deleted when it goes out of scope)
+            std::vector<DiameterSrv*> newsorted;
             for ( size_t j = 0; j < sorted.size(); j++ )
                newsorted.push_back( at( sorted[j] ) );
 
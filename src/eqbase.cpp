@@ -18,6 +18,15 @@
 #include "eqbase.h"
 #include "eatomic.h"
 
+#include <climits>
+#include <cstring>
+#include <sched.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -44,12 +53,15 @@ Void EQueueMessage::unserialize(pVoid pBuffer, ULong &nOffset)
 
 /// @cond DOXYGEN_EXCLUDE
 
+// the process ID recorded in a claimed slot, a forked child updates it
+static Int s_pid = getpid();
+static Void refreshPid() { s_pid = getpid(); }
+static Int s_pidAtFork = pthread_atfork(NULL, NULL, refreshPid);
+
 EQueueBase::EQueueBase()
 {
    m_initialized = False;
    m_mode = ReadOnly;
-   memset(m_rBuffer, 0, sizeof(m_rBuffer));
-   memset(m_wBuffer, 0, sizeof(m_rBuffer));
 }
 
 EQueueBase::~EQueueBase()
@@ -69,8 +81,17 @@ Void EQueueBase::init(ULong nMsgSize,
    Char szName[EPC_FILENAME_MAX];
    epc_sprintf_s(szName, sizeof(szName), "%d", queueId);
 
+   // each slot must be able to hold a record header and keep the
+   // record headers aligned, the lock free queue keeps the record
+   // header with the slot state
+   if (!isLockFree() && nMsgSize < sizeof(equeuerecord_t))
+      nMsgSize = sizeof(equeuerecord_t);
+   nMsgSize = (nMsgSize + sizeof(Long) - 1) & ~(sizeof(Long) - 1);
+
    // calcuate the space required
-   int nSize = nMsgSize * nMsgCnt;
+   size_t nSize = (size_t)nMsgSize * nMsgCnt;
+   if (isLockFree())
+      nSize += sizeof(equeueslot_t) * nMsgCnt;
 
    // initialize the shared memory
    allocDataSpace(szName, 'A', nSize);
@@ -88,11 +109,19 @@ Void EQueueBase::init(ULong nMsgSize,
       msgHead() = 0;
       msgTail() = 0;
 
-      // initialize the control mutex and semaphores
-      initReadMutex();
+      // initialize the control mutex and semaphores, the lock free
+      // queue only uses the write mutex to open and close the queue
       initWriteMutex();
-      initSemFree(msgCnt());
-      initSemMsgs(0);
+      if (isLockFree())
+      {
+         initRing();
+      }
+      else
+      {
+         initReadMutex();
+         initSemFree(msgCnt());
+         initSemMsgs(0);
+      }
    }
 
    try
@@ -108,12 +137,21 @@ Void EQueueBase::init(ULong nMsgSize,
       numReaders() += (eMode == ReadOnly || eMode == ReadWrite) ? 1 : 0;
       numWriters() += (eMode == WriteOnly || eMode == ReadWrite) ? 1 : 0;
 
+      if (isLockFree())
+         openRing();
+
       m_initialized = True;
    }
    catch (EError &e)
    {
       throw;
    }
+
+   if (EQueueStatistics::getDefaultEnabled() && !m_stats.isEnabled())
+   {
+      EString name;
+      m_stats.enable(name.format("queue-%d", queueId).c_str());
+   }
 }
 
 /// @endcond
@@ -132,10 +170,13 @@ Void EQueueBase::destroy()
 
          if (refCnt() == 1)
          {
-            semFree().destroy();
-            semMsgs().destroy();
+            if (!isLockFree())
+            {
+               semFree().destroy();
+               semMsgs().destroy();
 
-            readMutex().destroy();
+               readMutex().destroy();
+            }
             destroyWriteMutex = True;
          }
          else
@@ -147,127 +188,622 @@ Void EQueueBase::destroy()
       if (destroyWriteMutex)
          writeMutex().destroy();
 
+      m_stats.disable();
       m_initialized = False;
    }
 }
 
 Bool EQueueBase::push(EQueueMessage &msg, Bool wait)
 {
-   ULong length;
-   Int i;
-
    if (m_mode == ReadOnly)
       throw EQueueBaseError_NotOpenForWriting();
 
+   if (isLockFree())
+      return pushRing(msg, wait);
+
    // get the message length
-   length = sizeof(ULong);
+   ULong length = 0;
    msg.getLength(length);
 
-   // calculate the number of slots required to package the message
-   int nSlots = (length / msgSize()) + (((length % msgSize()) > 0) ? 1 : 0);
+   // calculate the number of slots required for the record
+   Int nSlots = (sizeof(equeuerecord_t) + length + msgSize() - 1) / msgSize();
+   if (nSlots > msgCnt())
+      throw EQueueBaseError_MessageTooLarge();
+
+   equeuerecord_t *rec;
 
-   // reserve slots for the message
-   for (i = 0; i < nSlots; i++)
    {
-      if (!semFree().Decrement(wait))
+      // lock the object if necessary
+      EMutexLock l(writeMutex(), multipleWriters());
+
+      // a record is never split, if it will not fit before the end of
+      // the data area the remaining slots are filled with a padding record
+      if (msgHead() + nSlots > msgCnt())
       {
-         // the required number of slots are not available
-         // "un" reserve the slots that were allocated
-         for (; i > 0; i--)
-            semFree().Increment();
-         return False;
+         Int nPad = msgCnt() - msgHead();
+         if (!reserve(nPad, wait))
+            return False;
+
+         equeuerecord_t *pad = record(msgHead());
+         pad->m_slots = nPad;
+         pad->m_length = 0;
+         pad->m_msgType = 0;
+         commit(pad, RecordPadding);
+         semMsgs().Increment();
+
+         msgHead() = 0;
       }
+
+      if (!reserve(nSlots, wait))
+         return False;
+
+      // the reader will wait at this record until it has been committed
+      rec = record(msgHead());
+      commit(rec, RecordFree);
+      rec->m_slots = nSlots;
+      rec->m_length = length;
+      rec->m_msgType = msg.getMsgType();
+      rec->m_enqueued = enqueueTime();
+
+      msgHead() += nSlots;
+      if (msgHead() >= msgCnt())
+         msgHead() = 0;
+   }
+
+   // serialize the message heirarchy directly into the queue
+   try
+   {
+      ULong offset = 0;
+      msg.serialize(recordData(rec), offset);
+   }
+   catch (...)
+   {
+      // the slots have been reserved, so the reader must skip them
+      commit(rec, RecordPadding);
+      semMsgs().Increment();
+      throw;
+   }
+
+   commit(rec, RecordCommitted);
+   semMsgs().Increment();
+
+   if (m_stats.isEnabled())
+   {
+      Long nFree = semFree().currCount();
+      m_stats.recordPush(msgCnt() - (nFree > 0 ? nFree : 0));
    }
 
-   ULong msgOfs = 0;
-   ULong amtWritten = 0;
+   return True;
+}
 
-   // lock the object if necessary
-   EMutexLock l(writeMutex(), multipleWriters());
+EQueueMessage *EQueueBase::pop(Bool wait)
+{
+   if (m_mode == WriteOnly)
+      throw EQueueBaseError_NotOpenForReading();
 
-   length = sizeof(ULong);
-   // serizlize the message heirarchy
-   msg.serialize(m_wBuffer, length);
-   // set the message length
-   //*((ULong*)m_wBuffer) = length;  the avoid strict-aliasing rules warning
-   pULong pulBuffer = (pULong)m_wBuffer;
-   *pulBuffer = length;
+   if (isLockFree())
+      return popRing(wait);
 
-   int dataOfs = msgHead() * msgSize();
-   for (i = 0; i < nSlots; i++)
+   while (True)
    {
-      int len = (length - amtWritten) > msgSize() ? msgSize() : length - amtWritten;
-      memcpy(&data()[dataOfs], &m_wBuffer[msgOfs], len);
+      // the reader is only timed when it has to wait for a message
+      ETimer idle(0);
+      Bool timed = m_stats.isEnabled() && wait && semMsgs().currCount() <= 0;
+      if (timed)
+         idle.Start();
 
-      amtWritten += len;
+      if (!semMsgs().Decrement(wait))
+         return NULL;
 
-      msgHead()++;
+      if (timed)
+         m_stats.recordIdle(idle.MicroSeconds());
 
-      msgOfs += msgSize();
+      EMutexLock l(readMutex(), multipleReaders());
 
-      if (msgHead() >= msgCnt())
+      equeuerecord_t *rec = record(msgTail());
+
+      // a writer that reserved this record before the record that was
+      // committed may still be serializing the message
+      Int state;
+      while ((state = __atomic_load_n(&rec->m_state, __ATOMIC_ACQUIRE)) == RecordFree)
+         sched_yield();
+
+      if (state == RecordPadding)
       {
-         msgHead() = 0;
-         dataOfs = 0;
+         release(rec);
+         continue;
       }
-      else
+
+      // unserialize the message in place
+      epctime_t enqueued = rec->m_enqueued;
+      EQueueMessage *pMsg = allocMessage(rec->m_msgType);
+      if (pMsg)
       {
-         dataOfs += msgSize();
+         try
+         {
+            ULong offset = 0;
+            pMsg->unserialize(recordData(rec), offset);
+         }
+         catch (...)
+         {
+            release(rec);
+            delete pMsg;
+            throw;
+         }
       }
+
+      release(rec);
+
+      if (pMsg)
+         recordResidency(enqueued);
+
+      return pMsg;
    }
+}
 
-   semMsgs().Increment();
+/// @cond DOXYGEN_EXCLUDE
+
+Bool EQueueBase::reserve(Int nSlots, Bool wait)
+{
+   // the writer is only timed when it has to wait for free slots
+   ETimer blocked(0);
+   Bool timed = m_stats.isEnabled() && wait && semFree().currCount() < nSlots;
+   if (timed)
+      blocked.Start();
+
+   for (Int i = 0; i < nSlots; i++)
+   {
+      if (!semFree().Decrement(wait))
+      {
+         // the required number of slots are not available
+         // "un" reserve the slots that were allocated
+         semFree().Increment(i);
+         return False;
+      }
+   }
+
+   if (timed)
+      m_stats.recordBlocked(blocked.MicroSeconds());
 
    return True;
 }
 
-EQueueMessage *EQueueBase::pop(Bool wait)
+Void EQueueBase::release(equeuerecord_t *rec)
 {
-   ULong length;
-   ULong offset;
+   Int nSlots = rec->m_slots;
 
-   if (m_mode == WriteOnly)
-      throw EQueueBaseError_NotOpenForReading();
+   msgTail() += nSlots;
+   if (msgTail() >= msgCnt())
+      msgTail() = 0;
 
-   if (!semMsgs().Decrement(wait))
-      return NULL;
+   semFree().Increment(nSlots);
+}
 
-   EMutexLock l(readMutex(), multipleReaders());
+Void EQueueBase::initRing()
+{
+   equeuering_t *r = ring();
+
+   r->m_writePos = 0;
+   r->m_readPos = 0;
+   r->m_msgsFutex = 0;
+   r->m_msgsWaiters = 0;
+   r->m_freeFutex = 0;
+   r->m_freeWaiters = 0;
+   r->m_pidNamespace = 0;
+   r->m_mixedNamespaces = 0;
+
+   // a slot is free when the sequence matches the position being written
+   // and is committed when the sequence is one more than the position
+   for (ULongLong pos = 0; pos < (ULongLong)msgCnt(); pos++)
+   {
+      equeueslot_t *s = ringSlot(pos);
+      memset(s, 0, sizeof(*s));
+      s->m_seq = pos;
+      s->m_writerPos = ~0ULL;
+   }
+}
 
+Void EQueueBase::openRing()
+{
+   // called while holding the write mutex, a process ID can only be checked
+   // by a process in the same PID namespace
+   struct stat st;
+   ULongLong ns = stat("/proc/self/ns/pid", &st) == 0 ? (ULongLong)st.st_ino : ~0ULL;
+
+   equeuering_t *r = ring();
+   if (r->m_pidNamespace == 0)
+      r->m_pidNamespace = ns;
+   else if (r->m_pidNamespace != ns)
+      __atomic_store_n(&r->m_mixedNamespaces, 1, __ATOMIC_RELEASE);
+}
+
+Bool EQueueBase::pushRing(EQueueMessage &msg, Bool wait)
+{
    // get the message length
-   length = *(ULong *)&data()[msgTail() * msgSize()];
+   ULong length = 0;
+   msg.getLength(length);
+
+   // calculate the number of slots required for the record
+   Int nSlots = length == 0 ? 1 : (length + msgSize() - 1) / msgSize();
+   if (nSlots > msgCnt())
+      throw EQueueBaseError_MessageTooLarge();
+
+   equeuering_t *r = ring();
+   ULongLong cnt = msgCnt();
+
+   // checking if a process is running is a system call, so an owner is only
+   // checked after spinning on its claim or after a wait has timed out
+   Int spins = 0;
+   Bool check = False;
 
-   // get the message
-   ULong amt = 0;
    while (True)
    {
-      int len = (length - amt) > msgSize() ? msgSize() : length - amt;
+      Int futex = __atomic_load_n(&r->m_freeFutex, __ATOMIC_ACQUIRE);
+      ULongLong pos = __atomic_load_n(&r->m_writePos, __ATOMIC_RELAXED);
+
+      // a record is never split, if it will not fit before the end of
+      // the data area the remaining slots are claimed as a padding record
+      Int nClaim = cnt - pos % cnt;
+      Bool padding = nClaim < nSlots;
+      if (!padding)
+         nClaim = nSlots;
+
+      // each of the slots must be free for this pass through the queue
+      Bool full = False;
+      Bool retry = False;
+      for (Int i = 0; i < nClaim && !full && !retry; i++)
+      {
+         ULongLong p = pos + i;
+         equeueslot_t *s = ringSlot(p);
+         ULongLong seq = __atomic_load_n(&s->m_seq, __ATOMIC_ACQUIRE);
 
-      memcpy(&m_rBuffer[amt], &data()[msgTail() * msgSize()], len);
-      amt += len;
+         if (seq == p)
+            continue;
 
-      msgTail()++;
-      if (msgTail() >= msgCnt())
-         msgTail() = 0;
+         if (seq > p)
+         {
+            // another writer has claimed the slot
+            retry = True;
+         }
+         else if (check && __atomic_load_n(&r->m_readPos, __ATOMIC_ACQUIRE) > p - cnt && recoverReader(p - cnt))
+         {
+            // the reader that claimed the record in the slot died before
+            // releasing the slots, which have now been released
+            retry = True;
+         }
+         else
+         {
+            full = True;
+         }
+      }
 
-      semFree().Increment();
+      if (retry)
+         continue;
 
-      if (amt >= length)
-         break;
+      if (full)
+      {
+         if (!wait)
+         {
+            // check for a dead reader once before failing
+            if (check)
+               return False;
+            check = True;
+            continue;
+         }
+         if (m_stats.isEnabled())
+         {
+            ETimer blocked;
+            check = !waitRing(r->m_freeFutex, r->m_freeWaiters, futex);
+            m_stats.recordBlocked(blocked.MicroSeconds());
+         }
+         else
+         {
+            check = !waitRing(r->m_freeFutex, r->m_freeWaiters, futex);
+         }
+         continue;
+      }
+
+      // the claim token is stored in the first slot before the write
+      // position is advanced, so every claim can be traced to its owner
+      equeueslot_t *s = ringSlot(pos);
+      ULongLong token = claimToken(s_pid, False, pos);
+      ULongLong owner = __atomic_load_n(&s->m_owner, __ATOMIC_ACQUIRE);
+
+      if (owner != 0)
+      {
+         // a token for another pass was left by a writer that lost the race
+         // for the write position, and a token for this pass belongs to a
+         // writer that is about to advance it, clear either if the write
+         // position has not moved and the owner cannot finish the claim
+         if (__atomic_load_n(&r->m_writePos, __ATOMIC_ACQUIRE) == pos &&
+             (!tokenMatches(owner, pos) || (++spins >= RingOwnerSpins && ownerGone(owner))))
+            __atomic_compare_exchange_n(&s->m_owner, &owner, 0, False, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+         continue;
+      }
+
+      if (!__atomic_compare_exchange_n(&s->m_owner, &owner, token, False, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+         continue;
+
+      // the release makes the token visible to any process that sees the
+      // new write position
+      if (!__atomic_compare_exchange_n(&r->m_writePos, &pos, pos + nClaim, False, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      {
+         // the token was stored after the slot was reused by a later pass
+         owner = token;
+         __atomic_compare_exchange_n(&s->m_owner, &owner, 0, False, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+         continue;
+      }
+
+      // record the size of the claim and the first slot of the record in
+      // each slot, the first slot is written last so that a reader only
+      // uses the size once it has been recorded
+      s->m_slots = nClaim;
+      for (Int i = nClaim - 1; i >= 0; i--)
+         __atomic_store_n(&ringSlot(pos + i)->m_writerPos, pos, __ATOMIC_RELEASE);
+
+      if (padding)
+      {
+         s->m_state = RecordPadding;
+         s->m_length = 0;
+         s->m_msgType = 0;
+         commitRing(s, pos);
+         signalRing(r->m_msgsFutex, r->m_msgsWaiters, 1);
+         continue;
+      }
+
+      s->m_state = RecordCommitted;
+      s->m_length = length;
+      s->m_msgType = msg.getMsgType();
+      s->m_enqueued = enqueueTime();
+
+      // serialize the message heirarchy directly into the queue
+      try
+      {
+         ULong offset = 0;
+         msg.serialize(ringData(pos), offset);
+      }
+      catch (...)
+      {
+         // the slots have been claimed, so the reader must skip them
+         s->m_state = RecordPadding;
+         commitRing(s, pos);
+         signalRing(r->m_msgsFutex, r->m_msgsWaiters, 1);
+         throw;
+      }
+
+      // a claim is only skipped when its owner is gone, so the commit
+      // cannot fail while this process is running
+      commitRing(s, pos);
+
+      signalRing(r->m_msgsFutex, r->m_msgsWaiters, 1);
+
+      if (m_stats.isEnabled())
+      {
+         // the read position is loaded first so it cannot pass the write position
+         ULongLong readPos = __atomic_load_n(&r->m_readPos, __ATOMIC_ACQUIRE);
+         m_stats.recordPush(__atomic_load_n(&r->m_writePos, __ATOMIC_ACQUIRE) - readPos);
+      }
+
+      return True;
+   }
+}
+
+EQueueMessage *EQueueBase::popRing(Bool wait)
+{
+   equeuering_t *r = ring();
+
+   // checking if a process is running is a system call, so an owner is only
+   // checked after spinning on its claim or after a wait has timed out
+   Int spins = 0;
+   Bool check = False;
+
+   while (True)
+   {
+      Int futex = __atomic_load_n(&r->m_msgsFutex, __ATOMIC_ACQUIRE);
+      ULongLong pos = __atomic_load_n(&r->m_readPos, __ATOMIC_RELAXED);
+      equeueslot_t *s = ringSlot(pos);
+      ULongLong seq = __atomic_load_n(&s->m_seq, __ATOMIC_ACQUIRE);
+
+      if (seq == pos + 1)
+      {
+         // the record has been committed, take the claim token from the
+         // writer, or from a reader that died before advancing the read
+         // position, before advancing the read position
+         ULongLong owner = __atomic_load_n(&s->m_owner, __ATOMIC_ACQUIRE);
+         if (tokenReader(owner) && tokenMatches(owner, pos) &&
+             (__atomic_load_n(&r->m_readPos, __ATOMIC_ACQUIRE) != pos || ++spins < RingOwnerSpins || !ownerGone(owner)))
+            continue;
+
+         ULongLong token = claimToken(s_pid, True, pos);
+         if (!__atomic_compare_exchange_n(&s->m_owner, &owner, token, False, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            continue;
+
+         Int nSlots = s->m_slots;
+         ULongLong expected = pos;
+         if (!__atomic_compare_exchange_n(&r->m_readPos, &expected, pos + nSlots, False, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+         {
+            // the record was claimed before the token was taken, give it back
+            __atomic_compare_exchange_n(&s->m_owner, &token, owner, False, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            continue;
+         }
+
+         if (s->m_state != RecordCommitted)
+         {
+            releaseRing(pos, nSlots, True);
+            continue;
+         }
+
+         // unserialize the message in place
+         epctime_t enqueued = s->m_enqueued;
+         EQueueMessage *pMsg = allocMessage(s->m_msgType);
+         if (pMsg)
+         {
+            try
+            {
+               ULong offset = 0;
+               pMsg->unserialize(ringData(pos), offset);
+            }
+            catch (...)
+            {
+               releaseRing(pos, nSlots, True);
+               delete pMsg;
+               throw;
+            }
+         }
+
+         releaseRing(pos, nSlots, True);
+
+         if (pMsg)
+            recordResidency(enqueued);
+
+         return pMsg;
+      }
+
+      if (seq > pos + 1)
+      {
+         // another reader has claimed the record
+         continue;
+      }
+
+      if (seq == pos && __atomic_load_n(&r->m_writePos, __ATOMIC_ACQUIRE) > pos)
+      {
+         // a writer has claimed the slot, if the writer died before
+         // committing the record, skip the slots that it claimed
+         ULongLong owner = __atomic_load_n(&s->m_owner, __ATOMIC_ACQUIRE);
+         Bool gone = False;
+         Int nSlots = 1;
+
+         if (!tokenMatches(owner, pos))
+         {
+            // every claim stores its token before the write position passes
+            // it, so this slot follows the first slot of a claim that has
+            // already been skipped without knowing its size
+            gone = True;
+         }
+         else if (check && !tokenReader(owner) && ownerGone(owner))
+         {
+            gone = True;
+            if (__atomic_load_n(&s->m_writerPos, __ATOMIC_ACQUIRE) == pos)
+               nSlots = s->m_slots;
+         }
+
+         if (gone)
+         {
+            if (__atomic_compare_exchange_n(&r->m_readPos, &pos, pos + nSlots, False, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+               releaseRing(pos, nSlots, False);
+            continue;
+         }
+      }
+
+      if (!wait)
+      {
+         // check for a dead writer once before failing
+         if (check)
+            return NULL;
+         check = True;
+         continue;
+      }
+
+      if (m_stats.isEnabled())
+      {
+         ETimer idle;
+         check = !waitRing(r->m_msgsFutex, r->m_msgsWaiters, futex);
+         m_stats.recordIdle(idle.MicroSeconds());
+      }
+      else
+      {
+         check = !waitRing(r->m_msgsFutex, r->m_msgsWaiters, futex);
+      }
    }
+}
 
-   // unserialize the message
-   EQueueMessage msg;
+Void EQueueBase::releaseRing(ULongLong pos, Int nSlots, Bool committed)
+{
+   equeuering_t *r = ring();
+   ULongLong cnt = msgCnt();
 
-   offset = sizeof(ULong); // skip over the message length
-   msg.unserialize(m_rBuffer, offset);
+   // the claim token is cleared before the first slot is made available
+   __atomic_store_n(&ringSlot(pos)->m_owner, 0, __ATOMIC_RELAXED);
 
-   EQueueMessage *pMsg = allocMessage(msg.getMsgType());
-   if (pMsg)
+   // make the slots available for the next pass through the queue, a
+   // slot that a writer has already released is left alone
+   for (Int i = 0; i < nSlots; i++)
    {
-      offset = sizeof(ULong); // skip over the message length
-      pMsg->unserialize(m_rBuffer, offset);
+      ULongLong p = pos + i;
+      ULongLong seq = i == 0 && committed ? p + 1 : p;
+      __atomic_compare_exchange_n(&ringSlot(p)->m_seq, &seq, p + cnt, False, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
    }
 
-   return pMsg;
+   signalRing(r->m_freeFutex, r->m_freeWaiters, INT_MAX);
+}
+
+Bool EQueueBase::recoverReader(ULongLong pos)
+{
+   // find the first slot of the record that the slot belongs to, the claim
+   // token of the reader that advanced the read position past it is there
+   ULongLong cnt = msgCnt();
+   ULongLong start = __atomic_load_n(&ringSlot(pos)->m_writerPos, __ATOMIC_ACQUIRE);
+   if (start > pos || pos - start >= cnt)
+      start = pos;
+
+   equeueslot_t *s = ringSlot(start);
+   ULongLong owner = __atomic_load_n(&s->m_owner, __ATOMIC_ACQUIRE);
+   if (!tokenMatches(owner, start) || !tokenReader(owner) || !ownerGone(owner))
+      return False;
+
+   // release every slot of the record at once, the token is cleared last
+   // so that a writer waiting on any of the slots can find the record
+   ULongLong nSlots = s->m_slots;
+   if (nSlots <= pos - start || nSlots > cnt)
+      nSlots = pos - start + 1;
+   for (ULongLong i = nSlots; i-- > 0;)
+   {
+      ULongLong p = start + i;
+      ULongLong seq = i == 0 ? p + 1 : p;
+      __atomic_compare_exchange_n(&ringSlot(p)->m_seq, &seq, p + cnt, False, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+   }
+   __atomic_compare_exchange_n(&s->m_owner, &owner, 0, False, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+
+   signalRing(ring()->m_freeFutex, ring()->m_freeWaiters, INT_MAX);
+   return True;
+}
+
+Bool EQueueBase::ownerGone(ULongLong token)
+{
+   // a process ID is only meaningful in the PID namespace of the process,
+   // so a claim is never considered abandoned if the namespaces differ
+   Int pid = (Int)(token >> 32);
+   if (pid == s_pid || __atomic_load_n(&ring()->m_mixedNamespaces, __ATOMIC_ACQUIRE))
+      return False;
+
+   return kill(pid, 0) == -1 && errno == ESRCH;
 }
+
+Bool EQueueBase::waitRing(Int &futex, Int &waiters, Int expected)
+{
+   // the wait is limited so that a process that died while holding a
+   // claim is detected even if no other process wakes this one
+   __sync_add_and_fetch(&waiters, 1);
+   Bool woken = EFutex::wait(futex, expected, RingRecoveryInterval);
+   __sync_sub_and_fetch(&waiters, 1);
+   return woken;
+}
+
+Void EQueueBase::signalRing(Int &futex, Int &waiters, Int count)
+{
+   __sync_add_and_fetch(&futex, 1);
+   if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST) > 0)
+      EFutex::wake(futex, count);
+}
+
+Void EQueueBase::recordResidency(epctime_t enqueued)
+{
+   // the residency is only known if the writer recorded the time
+   if (!m_stats.isEnabled() || enqueued == 0)
+      return;
+
+   epctime_t usec = ETimer(enqueued).MicroSeconds();
+   m_stats.recordPop(usec > 0 ? usec : 0);
+}
+
+/// @endcond
@@ -107,7 +107,7 @@ Void EQueuePrivate::initSemMsgs(UInt initialCount)
    m_semMsgs.init(initialCount);
 }
 
-Void EQueuePrivate::allocDataSpace(cpStr sFile, Char cId, Int nSize)
+Void EQueuePrivate::allocDataSpace(cpStr sFile, Char cId, size_t nSize)
 {
    m_pData = (pChar)malloc(nSize);
    memset(m_pData, 0, nSize);
@@ -136,7 +136,7 @@ Void EQueuePublic::initSemMsgs(UInt initialCount)
    s.detach();
 }
 
-Void EQueuePublic::allocDataSpace(cpStr sFile, Char cId, Int nSize)
+Void EQueuePublic::allocDataSpace(cpStr sFile, Char cId, size_t nSize)
 {
    m_sharedmem.init(sFile, cId, nSize + sizeof(esharedqueue_ctrl_t));
    m_pCtrl = (esharedqueue_ctrl_t *)m_sharedmem.getDataPtr();
@@ -0,0 +1,148 @@
+/*
+* Copyright (c) 2020 Sprint
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "einternal.h"
+#include "eqstats.h"
+
+#define RAPIDJSON_NAMESPACE eqstatsrapidjson
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+using namespace RAPIDJSON_NAMESPACE;
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+Bool EQueueStatistics::m_defaultEnabled = False;
+ERWLock EQueueStatistics::m_lock;
+std::list<EQueueStatistics *> EQueueStatistics::m_registry;
+
+EQueueStatistics::EQueueStatistics()
+   : m_enabled(False)
+{
+   reset();
+}
+
+EQueueStatistics::~EQueueStatistics()
+{
+   disable();
+}
+
+Void EQueueStatistics::enable(cpStr name)
+{
+   EWRLock l(m_lock);
+   m_name = name;
+   if (!m_enabled.load(std::memory_order_relaxed))
+   {
+      m_registry.push_back(this);
+      m_enabled.store(True, std::memory_order_release);
+   }
+}
+
+Void EQueueStatistics::disable()
+{
+   EWRLock l(m_lock);
+   if (m_enabled.load(std::memory_order_relaxed))
+   {
+      m_registry.remove(this);
+      m_enabled.store(False, std::memory_order_release);
+   }
+}
+
+Void EQueueStatistics::reset()
+{
+   m_pushes = 0;
+   m_pops = 0;
+   m_highWater = 0;
+   m_blockedCount = 0;
+   m_blockedTime = 0;
+   m_idleCount = 0;
+   m_idleTime = 0;
+   m_residency.reset();
+}
+
+EString &EQueueStatistics::toJson(EString &json) const
+{
+   StringBuffer buf;
+   Writer<StringBuffer> writer(buf);
+
+   writer.StartObject();
+   writer.String("name");          writer.String(m_name.c_str());
+   writer.String("pushes");        writer.Uint64(getPushes());
+   writer.String("pops");          writer.Uint64(getPops());
+   writer.String("highwater");     writer.Uint64(getHighWater());
+   writer.String("blockedcount");  writer.Uint64(getBlockedCount());
+   writer.String("blockedtime");   writer.Uint64(getBlockedTime());
+   writer.String("idlecount");     writer.Uint64(getIdleCount());
+   writer.String("idletime");      writer.Uint64(getIdleTime());
+
+   const EHistogram &h = getResidency();
+   writer.String("residency");
+   writer.StartObject();
+   writer.String("count");  writer.Uint64(h.getCount());
+   writer.String("avg");    writer.Double(h.getAverage());
+   writer.String("max");    writer.Uint64(h.getMax());
+   writer.String("p50");    writer.Uint64(h.getPercentile(50.0));
+   writer.String("p90");    writer.Uint64(h.getPercentile(90.0));
+   writer.String("p99");    writer.Uint64(h.getPercentile(99.0));
+   writer.String("buckets");
+   writer.StartArray();
+   for (Int i = 0; i < EHistogram::Buckets; i++)
+   {
+      if (h.getBucketCount(i) == 0)
+         continue;
+      writer.StartObject();
+      writer.String("le");     writer.Uint64(EHistogram::getBucketLimit(i));
+      writer.String("count");  writer.Uint64(h.getBucketCount(i));
+      writer.EndObject();
+   }
+   writer.EndArray();
+   writer.EndObject();
+
+   writer.EndObject();
+
+   json.assign(buf.GetString(), buf.GetSize());
+   return json;
+}
+
+EString &EQueueStatistics::getMetricsJson(EString &json)
+{
+   StringBuffer buf;
+   Writer<StringBuffer> writer(buf);
+
+   writer.StartArray();
+   {
+      ERDLock l(m_lock);
+      for (auto stats : m_registry)
+      {
+         EString s;
+         stats->toJson(s);
+         writer.RawValue(s.c_str(), s.length(), kObjectType);
+      }
+   }
+   writer.EndArray();
+
+   json.assign(buf.GetString(), buf.GetSize());
+   return json;
+}
+
+Void EQueueStatistics::loadDefaults(EGetOpt &options)
+{
+   options.setPrefix(SECTION_TOOLS);
+   m_defaultEnabled = options.get(MEMBER_QUEUE_STATISTICS, false);
+   options.setPrefix("");
+}
@@ -21,7 +21,10 @@
 #include <fcntl.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <unistd.h>
+#include <linux/mempolicy.h>
 
 #include "eshmem.h"
 #include "einternal.h"
@@ -52,29 +55,79 @@ ESharedMemoryError_UnableToCreateKeyFile::ESharedMemoryError_UnableToCreateKeyFi
    appendLastOsError();
 }
 
+ESharedMemoryError_PathTooLong::ESharedMemoryError_PathTooLong(cpStr pszDir, cpStr pszName)
+{
+   setSevere();
+   setTextf("The shared memory path for [%s] in [%s] exceeds %d characters", pszName, pszDir, EPC_FILENAME_MAX);
+}
+
 /// @endcond
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+ESharedMemory::Backend ESharedMemory::m_defaultBackend = ESharedMemory::SystemV;
+Bool ESharedMemory::m_defaultHugePages = False;
+Bool ESharedMemory::m_defaultPopulate = False;
+Int ESharedMemory::m_defaultNumaNode = -1;
+EString ESharedMemory::m_hugePageDir = "/dev/hugepages";
+
+Void ESharedMemory::loadDefaults(EGetOpt &options)
+{
+   options.setPrefix(SECTION_TOOLS "/" SECTION_SHARED_MEMORY);
+   EString backend = options.get(MEMBER_SHMEM_BACKEND, "sysv");
+   Bool hugePages = options.get(MEMBER_SHMEM_HUGE_PAGES, false);
+   Bool populate = options.get(MEMBER_SHMEM_POPULATE, false);
+   Int numaNode = options.get(MEMBER_SHMEM_NUMA_NODE, -1);
+   m_hugePageDir = options.get(MEMBER_SHMEM_HUGE_PAGE_DIRECTORY, m_hugePageDir.c_str());
+   options.setPrefix("");
+
+   setDefaults(backend == "posix" ? Posix : SystemV, hugePages, populate, numaNode);
+}
+
+Void ESharedMemory::setDefaults(Backend backend, Bool hugePages, Bool populate, Int numaNode)
+{
+   m_defaultBackend = backend;
+   m_defaultHugePages = hugePages;
+   m_defaultPopulate = populate;
+   m_defaultNumaNode = numaNode;
+}
+
 ESharedMemory::ESharedMemory()
     : m_pShMem(NULL),
       m_pData(NULL),
       m_pCtrl(NULL),
-      m_shmid(-1)
+      m_shmid(-1),
+      m_backend(m_defaultBackend),
+      m_hugePages(m_defaultHugePages),
+      m_populate(m_defaultPopulate),
+      m_numaNode(m_defaultNumaNode),
+      m_size(0)
 {
+   m_szPath[0] = '\0';
 }
 
-ESharedMemory::ESharedMemory(cpStr file, Int id, Int size)
+ESharedMemory::ESharedMemory(cpStr file, Int id, size_t size)
     : m_pShMem(NULL),
       m_pData(NULL),
       m_pCtrl(NULL),
-      m_shmid(-1)
+      m_shmid(-1),
+      m_backend(m_defaultBackend),
+      m_hugePages(m_defaultHugePages),
+      m_populate(m_defaultPopulate),
+      m_numaNode(m_defaultNumaNode),
+      m_size(0)
 {
+   m_szPath[0] = '\0';
    init(file, id, size);
 }
 
 ESharedMemory::~ESharedMemory()
+{
+   detach();
+}
+
+Void ESharedMemory::detach()
 {
    Bool bDestroy = False;
 
@@ -92,30 +145,78 @@ ESharedMemory::~ESharedMemory()
 
    if (bDestroy)
       getMutex().destroy();
+   m_pCtrl = NULL;
+   m_pData = NULL;
 
    if (m_pShMem)
    {
-      shmdt((char *)m_pShMem);
+      if (m_backend == SystemV)
+         shmdt((char *)m_pShMem);
+      else
+         munmap(m_pShMem, m_size);
       m_pShMem = NULL;
    }
 
-   if (m_shmid != -1 && bDestroy)
+   if (m_shmid != -1)
    {
-      shmctl(m_shmid, IPC_RMID, NULL);
+      if (bDestroy)
+         shmctl(m_shmid, IPC_RMID, NULL);
       m_shmid = -1;
    }
+
+   if (m_szPath[0])
+   {
+      if (bDestroy)
+      {
+         if (m_hugePages)
+            unlink(m_szPath);
+         else
+            shm_unlink(m_szPath);
+      }
+      m_szPath[0] = '\0';
+   }
 }
 
-Void ESharedMemory::init(cpStr file, Int id, Int size)
+Void ESharedMemory::init(cpStr file, Int id, size_t size)
 {
-   longinteger_t liSize;
-
-   liSize.quadPart = sizeof(eshmemctrl_t) + size;
+   m_size = sizeof(eshmemctrl_t) + size;
 
    // create the object names
    epc_sprintf_s(m_szShMem, sizeof(m_szShMem), "shmem_%s_%d", file, id);
    epc_sprintf_s(m_szMutex, sizeof(m_szMutex), "shmem_mutex_%s_%d", file, id);
 
+   // huge page mappings must be a multiple of the huge page size
+   if (m_hugePages)
+   {
+      size_t hpsize = getHugePageSize();
+      m_size = (m_size + hpsize - 1) & ~(hpsize - 1);
+   }
+
+   if (m_backend == SystemV)
+      initSystemV(file, id);
+   else
+      initPosix();
+
+   applyPolicy();
+
+   // assign the control block and data pointers
+   m_pCtrl = (eshmemctrl_t *)m_pShMem;
+   m_pData = (pVoid)((pChar)m_pShMem + sizeof(eshmemctrl_t));
+
+   // initialize the control structure
+   new(&m_pCtrl->s_mutex) EMutexPrivate();
+
+   // lock the control mutex
+   EMutexLock l(getMutex());
+
+   // increment the usage counter
+   m_pCtrl->s_usageCnt++;
+}
+
+/// @cond DOXYGEN_EXCLUDE
+
+Void ESharedMemory::initSystemV(cpStr file, Int id)
+{
    Char szFile[EPC_FILENAME_MAX];
 
    snprintf(szFile, sizeof(szFile), "%s/%s", P_tmpdir, m_szShMem);
@@ -136,7 +237,7 @@ Void ESharedMemory::init(cpStr file, Int id, Int size)
    //ELOGINFO(ELOG_SHAREDMEMORY, "File [%s], Key %0x%x, Size %d", szFile, m_key, size);
 
    // get the shared memory handle
-   m_shmid = shmget(m_key, liSize.li.lowPart, 0666 | IPC_CREAT);
+   m_shmid = shmget(m_key, m_size, 0666 | IPC_CREAT | (m_hugePages ? SHM_HUGETLB : 0));
    if (m_shmid == -1)
    {
       EString s;
@@ -151,24 +252,124 @@ Void ESharedMemory::init(cpStr file, Int id, Int size)
       m_pShMem = NULL;
       throw ESharedMemoryError_UnableToMap();
    }
+}
 
-   // assign the control block and data pointers
-   m_pCtrl = (eshmemctrl_t *)m_pShMem;
-   m_pData = (pVoid)((pChar)m_pShMem + sizeof(eshmemctrl_t));
+Void ESharedMemory::initPosix()
+{
+   // huge pages are allocated from a file on a hugetlbfs mount since
+   // MAP_HUGETLB is not supported for shm_open() objects
+   int fd, len;
+   if (m_hugePages)
+      len = snprintf(m_szPath, sizeof(m_szPath), "%s/%s", m_hugePageDir.c_str(), m_szShMem);
+   else
+      len = snprintf(m_szPath, sizeof(m_szPath), "/%s", m_szShMem);
+
+   // a truncated path could name a different object
+   if (len < 0 || (size_t)len >= sizeof(m_szPath))
+   {
+      m_szPath[0] = '\0';
+      throw ESharedMemoryError_PathTooLong(m_hugePages ? m_hugePageDir.c_str() : "/", m_szShMem);
+   }
 
-   // initialize the control structure
-   new(&m_pCtrl->s_mutex) EMutexPrivate();
+   if (m_hugePages)
+      fd = open(m_szPath, O_CREAT | O_RDWR, 0666);
+   else
+      fd = shm_open(m_szPath, O_CREAT | O_RDWR, 0666);
 
-   // lock the control mutex
-   EMutexLock l(getMutex());
+   if (fd == -1)
+   {
+      m_szPath[0] = '\0';
+      throw ESharedMemoryError_UnableToCreate(m_szShMem);
+   }
 
-   // increment the usage counter
-   m_pCtrl->s_usageCnt++;
+   // only grow the object, another process may already be using it
+   struct stat st;
+   if (fstat(fd, &st) == -1 || ((size_t)st.st_size < m_size && ftruncate(fd, m_size) == -1))
+   {
+      close(fd);
+      throw ESharedMemoryError_UnableToCreate(m_szPath);
+   }
+
+   // the pages are populated by applyPolicy() after the NUMA policy is set
+   m_pShMem = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+
+   if (m_pShMem == MAP_FAILED)
+   {
+      m_pShMem = NULL;
+      throw ESharedMemoryError_UnableToMap();
+   }
+}
+
+Void ESharedMemory::applyPolicy()
+{
+   // the policy is only a hint, so failures are ignored
+   unsigned long nodemask = 0;
+   if (m_numaNode >= 0 && m_numaNode < (Int)(sizeof(nodemask) * 8))
+   {
+      nodemask = 1UL << m_numaNode;
+      syscall(SYS_mbind, m_pShMem, m_size, MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8, 0);
+   }
+
+   // populate after mbind() so the policy applies to the prefaulted pages
+   if (m_populate)
+   {
+#ifdef MADV_POPULATE_WRITE
+      if (madvise(m_pShMem, m_size, MADV_POPULATE_WRITE) == 0)
+         return;
+#endif
+      // touch each page, reading leaves the contents of an existing segment intact
+      size_t pgsize = (size_t)sysconf(_SC_PAGESIZE);
+      for (size_t ofs = 0; ofs < m_size; ofs += pgsize)
+         (Void)*(volatile Char *)((pChar)m_pShMem + ofs);
+   }
 }
 
+size_t ESharedMemory::getHugePageSize()
+{
+   size_t hpsize = 2 * 1024 * 1024;
+
+   FILE *fp = fopen("/proc/meminfo", "r");
+   if (fp)
+   {
+      Char line[128];
+      unsigned long kb;
+      while (fgets(line, sizeof(line), fp))
+      {
+         if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1)
+         {
+            hpsize = kb * 1024;
+            break;
+         }
+      }
+      fclose(fp);
+   }
+
+   return hpsize;
+}
+
+/// @endcond
+
 Int ESharedMemory::getUsageCount()
 {
    if (m_pCtrl == NULL)
       throw ESharedMemoryError_NotInitialized();
    return m_pCtrl->s_usageCnt;
 }
+
+Void ESharedMemory::incUsageCount()
+{
+   if (m_pCtrl == NULL)
+      throw ESharedMemoryError_NotInitialized();
+   EMutexLock l(getMutex());
+   m_pCtrl->s_usageCnt++;
+}
+
+Void ESharedMemory::decUsageCount()
+{
+   if (m_pCtrl == NULL)
+      throw ESharedMemoryError_NotInitialized();
+   EMutexLock l(getMutex());
+   if (m_pCtrl->s_usageCnt > 1)
+      m_pCtrl->s_usageCnt--;
+}
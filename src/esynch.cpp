@@ -17,6 +17,10 @@
 
 #include <poll.h>
 #include <errno.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
 
 #include "einternal.h"
 #include "esynch.h"
@@ -84,6 +88,34 @@ ESemaphoreError_UnableToIncrement::ESemaphoreError_UnableToIncrement()
 
 /// @cond DOXYGEN_EXCLUDE
 
+EEventFdError_UnableToCreate::EEventFdError_UnableToCreate()
+{
+   setSevere();
+   setText("Error creating eventfd ");
+   appendLastOsError();
+}
+
+EEventFdError_UnableToRead::EEventFdError_UnableToRead()
+{
+   setSevere();
+   setText("Error reading eventfd ");
+   appendLastOsError();
+}
+
+EEventFdError_UnableToWrite::EEventFdError_UnableToWrite()
+{
+   setSevere();
+   setText("Error writing eventfd ");
+   appendLastOsError();
+}
+
+/// @endcond
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/// @cond DOXYGEN_EXCLUDE
+
 ESynchObjectsError_UnableToAllocateSynchObject::ESynchObjectsError_UnableToAllocateSynchObject(Int err)
 {
    setSevere();
@@ -101,8 +133,20 @@ ESynchObjects _synchObjCtrl;
 ESynchObjects *ESynchObjects::m_pThis = NULL;
 /// @endcond
 
+static cpStr semaphoreTableName = "ESynchObjectSemaphores";
+static cpStr mutexTableName = "ESynchObjectMutexes";
+
 Void ESynchObjects::ESynchObjectsSharedMemory::onDestroy()
 {
+   // the last process is detaching from the control block, so release the
+   // references the control block holds, each segment is then removed when
+   // this process detaches from it
+   esynchcontrol_t *pCtrl = (esynchcontrol_t *)getDataPtr();
+   if (pCtrl && pCtrl->m_initialized)
+   {
+      ESynchObjectTable<ESemaphoreDataPublic>::destroy(semaphoreTableName, &pCtrl->m_semaphoreCtrl);
+      ESynchObjectTable<EMutexDataPublic>::destroy(mutexTableName, &pCtrl->m_mutexCtrl);
+   }
 }
 
 Void ESynchObjects::ESynchObjectsSharedMemory::setSynchObjectsPtr(ESynchObjects *p)
@@ -111,15 +155,189 @@ Void ESynchObjects::ESynchObjectsSharedMemory::setSynchObjectsPtr(ESynchObjects
 }
 
 /// @cond DOXYGEN_EXCLUDE
+template <class T>
+ESynchObjects::ESynchObjectTable<T>::ESynchObjectTable(cpStr name)
+   : m_name(name),
+     m_pCtrl(NULL)
+{
+   memset(m_segments, 0, sizeof(m_segments));
+}
+
+template <class T>
+Void ESynchObjects::ESynchObjectTable<T>::init(_esynchcontrol_t *pCtrl)
+{
+   m_pCtrl = pCtrl;
+}
+
+template <class T>
+Void ESynchObjects::ESynchObjectTable<T>::create(Int nObjects)
+{
+   // the segment size is a power of 2 so that an index can be split
+   // into a segment and an offset without dividing
+   Int shift = 4;
+   while ((1 << shift) < nObjects)
+      shift++;
+
+   new(&m_pCtrl->m_mutex) EMutexPrivate();
+   m_pCtrl->m_max = 0;
+   m_pCtrl->m_segSize = 1 << shift;
+   m_pCtrl->m_segShift = shift;
+   m_pCtrl->m_segments = 0;
+   m_pCtrl->m_head = 0xffffffffULL;
+   m_pCtrl->m_currused = 0;
+   m_pCtrl->m_maxused = 0;
+
+   // the configured number of objects are allocated up front
+   if (nObjects > 0)
+      grow(m_pCtrl->m_head);
+}
+
+template <class T>
+Void ESynchObjects::ESynchObjectTable<T>::attachAll()
+{
+   Int segments = __atomic_load_n(&m_pCtrl->m_segments, __ATOMIC_ACQUIRE);
+   for (Int seg = 0; seg < segments; seg++)
+   {
+      if (!__atomic_load_n(&m_segments[seg], __ATOMIC_ACQUIRE))
+         attach(seg);
+   }
+}
+
+template <class T>
+Void ESynchObjects::ESynchObjectTable<T>::destroy(cpStr name, _esynchcontrol_t *pCtrl)
+{
+   // a segment that this process has not attached is removed when the
+   // temporary object is destroyed
+   for (Int seg = 0; seg < pCtrl->m_segments; seg++)
+   {
+      ESharedMemory shmem(name, seg + 1, sizeof(T) * pCtrl->m_segSize);
+      shmem.decUsageCount();
+   }
+   pCtrl->m_segments = 0;
+}
+
+template <class T>
+Int ESynchObjects::ESynchObjectTable<T>::allocate()
+{
+   while (True)
+   {
+      ULongLong head = __atomic_load_n(&m_pCtrl->m_head, __ATOMIC_ACQUIRE);
+      Int idx = (Int)(UInt)head;
+
+      if (idx == -1)
+      {
+         if (!grow(head))
+            return -1;
+         continue;
+      }
+
+      // the next index may be stale if another thread allocated the object,
+      // the tag will cause the exchange to fail if that happened
+      Int next = __atomic_load_n(&get(idx).nextIndex(), __ATOMIC_RELAXED);
+      ULongLong newHead = (((head >> 32) + 1) << 32) | (UInt)next;
+
+      if (__atomic_compare_exchange_n(&m_pCtrl->m_head, &head, newHead, True, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      {
+         Long used = atomic_inc(m_pCtrl->m_currused);
+         Long maxused = __atomic_load_n(&m_pCtrl->m_maxused, __ATOMIC_RELAXED);
+         while (used > maxused && !__atomic_compare_exchange_n(&m_pCtrl->m_maxused, &maxused, used, True, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            ;
+         return idx;
+      }
+   }
+}
+
+template <class T>
+Void ESynchObjects::ESynchObjectTable<T>::release(Int idx)
+{
+   T &obj = get(idx);
+   ULongLong head = __atomic_load_n(&m_pCtrl->m_head, __ATOMIC_RELAXED);
+   ULongLong newHead;
+
+   do
+   {
+      __atomic_store_n(&obj.nextIndex(), (Int)(UInt)head, __ATOMIC_RELAXED);
+      newHead = (((head >> 32) + 1) << 32) | (UInt)idx;
+   } while (!__atomic_compare_exchange_n(&m_pCtrl->m_head, &head, newHead, True, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+   atomic_dec(m_pCtrl->m_currused);
+}
+
+template <class T>
+pChar ESynchObjects::ESynchObjectTable<T>::attach(Int seg)
+{
+   EMutexLock l(m_attachMutex);
+
+   if (!m_segments[seg])
+   {
+      m_shmem[seg].reset(new ESharedMemory(m_name, seg + 1, sizeof(T) * m_pCtrl->m_segSize));
+      __atomic_store_n(&m_segments[seg], (pChar)m_shmem[seg]->getDataPtr(), __ATOMIC_RELEASE);
+   }
+
+   return m_segments[seg];
+}
+
+template <class T>
+Bool ESynchObjects::ESynchObjectTable<T>::grow(ULongLong head)
+{
+   // growing the table is serialized between all processes
+   EMutexLock l(m_pCtrl->m_mutex);
+
+   // another thread may have added a segment or released an object
+   if (__atomic_load_n(&m_pCtrl->m_head, __ATOMIC_ACQUIRE) != head)
+      return True;
+
+   Int seg = m_pCtrl->m_segments;
+   if (seg >= MaxSegments)
+      return False;
+
+   // the control block holds a reference to the new segment, so the
+   // segment is not removed when the processes that attached it exit
+   T *objs = (T *)attach(seg);
+   m_shmem[seg]->incUsageCount();
+
+   // link the objects in the new segment together
+   Int base = seg << m_pCtrl->m_segShift;
+   Int last = m_pCtrl->m_segSize - 1;
+   for (Int ofs = 0; ofs < last; ofs++)
+   {
+      objectId(objs[ofs]) = base + ofs + 1;
+      objs[ofs].nextIndex() = base + ofs + 1;
+   }
+   objectId(objs[last]) = base + last + 1;
+
+   m_pCtrl->m_max += m_pCtrl->m_segSize;
+   __atomic_store_n(&m_pCtrl->m_segments, seg + 1, __ATOMIC_RELEASE);
+
+   // push the new objects onto the free list
+   ULongLong newHead;
+   head = __atomic_load_n(&m_pCtrl->m_head, __ATOMIC_RELAXED);
+   do
+   {
+      __atomic_store_n(&objs[last].nextIndex(), (Int)(UInt)head, __ATOMIC_RELAXED);
+      newHead = (((head >> 32) + 1) << 32) | (UInt)base;
+   } while (!__atomic_compare_exchange_n(&m_pCtrl->m_head, &head, newHead, True, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+   return True;
+}
+
+template class ESynchObjects::ESynchObjectTable<ESemaphoreDataPublic>;
+template class ESynchObjects::ESynchObjectTable<EMutexDataPublic>;
+
 ESynchObjects::ESynchObjects()
+   : m_semaphores(semaphoreTableName),
+     m_mutexes(mutexTableName)
 {
    m_pCtrl = NULL;
-   m_pSemaphores = NULL;
-   m_pMutexes = NULL;
+   m_pPubQueues = NULL;
 }
 
 ESynchObjects::~ESynchObjects()
 {
+   // detach from the control block while the tables still hold their
+   // segments, so the last process can release the segments
+   m_pCtrl = NULL;
+   m_sharedmem.detach();
 }
 
 Void ESynchObjects::init(EGetOpt &options)
@@ -141,66 +359,39 @@ Void ESynchObjects::init(EGetOpt &options)
    UInt nPublicQueues = options.getCount(SECTION_PUBLIC_QUEUE);
    options.setPrefix("");
 
+   // the semaphores and mutexes are stored in separate segments
    m_sharedmem.init("ESynchObjectPublicStorage", 'A',
                     sizeof(Bool) +             // initialization flag
                     sizeof(esynchcontrol_t) + // synch control block
-                    //sizeof(esynchcontrol_t) + // semaphore control block
-                    //sizeof(esynchcontrol_t) + // mutex control block
-                    //sizeof(esynchcontrol_t) + // condition variable control block
-                    sizeof(ESemaphoreDataPublic) * nSemaphores +
-                    sizeof(EMutexDataPublic) * nMutexes +                    // storage for mutex objects
                     sizeof(epublicqueuedef_t) * (nPublicQueues + 1) // storage for public queue definitions
    );
 
+   m_sharedmem.setSynchObjectsPtr(this);
    m_pCtrl = (esynchcontrol_t *)m_sharedmem.getDataPtr();
 
-   m_pSemaphores = (ESemaphoreDataPublic *)((pChar)m_pCtrl + sizeof(*m_pCtrl));
-   m_pMutexes = (EMutexDataPublic *)((pChar)m_pSemaphores + (sizeof(ESemaphoreDataPublic) * nSemaphores));
-   m_pPubQueues = (epublicqueuedef_t *)((pChar)m_pMutexes + (sizeof(EMutexDataPublic) * nMutexes));
+   m_pPubQueues = (epublicqueuedef_t *)((pChar)m_pCtrl + sizeof(*m_pCtrl));
+
+   m_semaphores.init(&m_pCtrl->m_semaphoreCtrl);
+   m_mutexes.init(&m_pCtrl->m_mutexCtrl);
 
    if (!m_pCtrl->m_initialized)
    {
       m_pCtrl->m_sequence = 0;
 
-      new(&m_pCtrl->m_semaphoreCtrl.m_mutex) EMutexPrivate();
-      new(&m_pCtrl->m_mutexCtrl.m_mutex) EMutexPrivate();
-
-      EMutexLock ls(m_pCtrl->m_semaphoreCtrl.m_mutex);
-      EMutexLock lm(m_pCtrl->m_mutexCtrl.m_mutex);
-
-      m_pCtrl->m_semaphoreCtrl.m_max = nSemaphores;
-      m_pCtrl->m_semaphoreCtrl.m_head = 0;
-      m_pCtrl->m_semaphoreCtrl.m_currused = 0;
-      m_pCtrl->m_semaphoreCtrl.m_maxused = 0;
-
-      m_pCtrl->m_mutexCtrl.m_max = nMutexes;
-      m_pCtrl->m_mutexCtrl.m_head = 0;
-      m_pCtrl->m_mutexCtrl.m_currused = 0;
-      m_pCtrl->m_mutexCtrl.m_maxused = 0;
-
-      Int ofs;
-
-      for (ofs = 1; ofs < m_pCtrl->m_semaphoreCtrl.m_max; ofs++)
-      {
-         m_pSemaphores[ofs - 1].semIndex() = ofs;
-         m_pSemaphores[ofs - 1].nextIndex() = ofs;
-      }
-      m_pSemaphores[ofs - 1].semIndex() = ofs;
-      m_pSemaphores[ofs - 1].nextIndex() = -1;
-
-      for (ofs = 1; ofs < m_pCtrl->m_mutexCtrl.m_max; ofs++)
-      {
-         m_pMutexes[ofs - 1].mutexId() = ofs; //setMutexId(ofs);
-         m_pMutexes[ofs - 1].nextIndex() = ofs; //setNextIndex(ofs);
-      }
-      m_pMutexes[ofs - 1].mutexId() = ofs; //setMutexId(ofs);
-      m_pMutexes[ofs - 1].nextIndex() = ofs; //setNextIndex(-1);
+      // the configured number of objects is the size of the first segment,
+      // additional segments of the same size are added as needed
+      m_semaphores.create(nSemaphores);
+      m_mutexes.create(nMutexes);
 
       memset(m_pPubQueues, 0, sizeof(epublicqueuedef_t) * (nPublicQueues + 1));
 
       m_pCtrl->m_initialized = True;
    }
 
+   // keep every existing segment attached for the life of the process
+   m_semaphores.attachAll();
+   m_mutexes.attachAll();
+
    m_pThis = this;
 
    ////////////////////////////////////////////////////////////////////////////
@@ -246,74 +437,30 @@ Void ESynchObjects::logObjectUsage()
 
 Int ESynchObjects::nextSemaphore()
 {
-   ESynchObjects *pso = getSynchObjCtrlPtr();
-   esynchcontrol_t *pctrl = pso->m_pCtrl;
-   
-   EMutexLock l(pctrl->m_semaphoreCtrl.m_mutex);
-
-   if (pctrl->m_semaphoreCtrl.m_head == -1)
+   Int idx = getSynchObjCtrlPtr()->m_semaphores.allocate();
+   if (idx == -1)
       throw ESemaphoreError_UnableToAllocateSemaphore();
 
-   Int ofs = pctrl->m_semaphoreCtrl.m_head;
-   pctrl->m_semaphoreCtrl.m_head =
-       pso->m_pSemaphores[pctrl->m_semaphoreCtrl.m_head].nextIndex();
-
-   pctrl->m_semaphoreCtrl.m_currused++;
-   if (pctrl->m_semaphoreCtrl.m_currused > pctrl->m_semaphoreCtrl.m_maxused)
-      pctrl->m_semaphoreCtrl.m_maxused = pctrl->m_semaphoreCtrl.m_currused;
-
-   return ofs + 1;
+   return idx + 1;
 }
 
 Int ESynchObjects::nextMutex()
 {
-   ESynchObjects *pso = getSynchObjCtrlPtr();
-   esynchcontrol_t *pctrl = pso->m_pCtrl;
-   
-   EMutexLock l(pctrl->m_mutexCtrl.m_mutex);
-
-   if (pctrl->m_mutexCtrl.m_head == -1)
+   Int idx = getSynchObjCtrlPtr()->m_mutexes.allocate();
+   if (idx == -1)
       throw EMutexError_UnableToAllocateMutex();
 
-   Int ofs = pctrl->m_mutexCtrl.m_head;
-   pctrl->m_mutexCtrl.m_head =
-       pso->m_pMutexes[pctrl->m_mutexCtrl.m_head].nextIndex();
-
-   pctrl->m_mutexCtrl.m_currused++;
-   if (pctrl->m_mutexCtrl.m_currused > pctrl->m_mutexCtrl.m_maxused)
-      pctrl->m_mutexCtrl.m_maxused = pctrl->m_mutexCtrl.m_currused;
-
-   return ofs + 1;
+   return idx + 1;
 }
 
 Void ESynchObjects::freeSemaphore(Int nSemId)
 {
-   ESynchObjects *pso = getSynchObjCtrlPtr();
-   esynchcontrol_t *pctrl = pso->m_pCtrl;
-   
-   EMutexLock l(pctrl->m_semaphoreCtrl.m_mutex);
-
-   nSemId--;
-
-   pso->m_pSemaphores[nSemId].nextIndex() = pctrl->m_semaphoreCtrl.m_head;
-   pctrl->m_semaphoreCtrl.m_head = nSemId;
-
-   pctrl->m_semaphoreCtrl.m_currused--;
+   getSynchObjCtrlPtr()->m_semaphores.release(nSemId - 1);
 }
 
 Void ESynchObjects::freeMutex(Int nMutexId)
 {
-   ESynchObjects *pso = getSynchObjCtrlPtr();
-   esynchcontrol_t *pctrl = pso->m_pCtrl;
-   
-   EMutexLock l(pctrl->m_mutexCtrl.m_mutex);
-
-   nMutexId--;
-
-   pso->m_pMutexes[nMutexId].nextIndex() = pctrl->m_mutexCtrl.m_head;
-   pctrl->m_mutexCtrl.m_head = nMutexId;
-
-   pctrl->m_mutexCtrl.m_currused--;
+   getSynchObjCtrlPtr()->m_mutexes.release(nMutexId - 1);
 }
 /// @endcond
 
@@ -471,18 +618,26 @@ Bool ESemaphoreData::Decrement(Bool wait)
    if (!initialized())
       throw ESemaphoreError_NotInitialized();
 
-   Long val = atomic_dec(m_currCount);
-   if (val < 0)
+   if (!wait)
    {
-      if (wait)
+      // the count is never taken below zero without waiting, otherwise an
+      // increment made before the count was restored would post the
+      // semaphore for a waiter that does not exist
+      Long val = m_currCount;
+      while (val > 0)
       {
-         if (sem_wait(&m_sem) != 0)
-         {
-            atomic_inc(m_currCount);
-            return False;
-         }
+         Long prev = atomic_cas(m_currCount, val, val - 1);
+         if (prev == val)
+            return True;
+         val = prev;
       }
-      else
+      return False;
+   }
+
+   Long val = atomic_dec(m_currCount);
+   if (val < 0)
+   {
+      if (sem_wait(&m_sem) != 0)
       {
          atomic_inc(m_currCount);
          return False;
@@ -508,6 +663,29 @@ Bool ESemaphoreData::Increment()
    return True;
 }
 
+Bool ESemaphoreData::Increment(Long count)
+{
+   if (!initialized())
+      throw ESemaphoreError_NotInitialized();
+
+   if (count <= 0)
+      return True;
+
+   Long val = __sync_add_and_fetch(&m_currCount, count);
+
+   // one waiter was blocked for each negative count that has been cleared
+   Long waiters = val >= count ? 0 : val < 0 ? count : count - val;
+   for (; waiters > 0; waiters--)
+   {
+      if (sem_post(&m_sem) != 0)
+      {
+         __sync_sub_and_fetch(&m_currCount, waiters);
+         throw ESemaphoreError_UnableToIncrement();
+      }
+   }
+   return True;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Public Semaphore Classes
 ////////////////////////////////////////////////////////////////////////////////
@@ -649,77 +827,128 @@ void ERWLock::leave()
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-EEvent::EEvent( bool state )
-   : m_buf()
+EEventFd::EEventFd()
+   : m_signaled(0)
+{
+   m_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+   if (m_fd == -1)
+      throw EEventFdError_UnableToCreate();
+}
+
+EEventFd::~EEventFd()
+{
+   if (m_fd != -1)
+   {
+      close(m_fd);
+      m_fd = -1;
+   }
+}
+
+Bool EEventFd::signal()
+{
+   // only the first signal after a reset writes to the eventfd
+   if (__atomic_exchange_n(&m_signaled, 1, __ATOMIC_SEQ_CST))
+      return False;
+
+   ULongLong val = 1;
+   if (write(m_fd, &val, sizeof(val)) == -1 && errno != EAGAIN)
+      throw EEventFdError_UnableToWrite();
+
+   return True;
+}
+
+ULongLong EEventFd::reset()
+{
+   // the eventfd is drained before the signaled indication is cleared, if
+   // the indication were cleared first the read could consume the write of
+   // a signal that followed, leaving the object signaled with nothing to
+   // wake the consumer
+   ULongLong val = 0;
+   if (read(m_fd, &val, sizeof(val)) == -1)
+   {
+      if (errno != EAGAIN)
+         throw EEventFdError_UnableToRead();
+      val = 0;
+   }
+
+   __atomic_store_n(&m_signaled, 0, __ATOMIC_SEQ_CST);
+
+   return val;
+}
+
+Bool EEventFd::wait(Int ms)
 {
-   m_pipefd[0] = -1;
-   m_pipefd[1] = -1;
+   struct pollfd fds[] = { { .fd = m_fd, .events = POLLIN } };
+
+   while (True)
+   {
+      int result = poll(fds, 1, ms);
+      if (result > 0)
+         return True;
+      if (result == -1 && errno == EINTR)
+         continue;
+      return False;
+   }
+}
 
-   int result = pipe2( m_pipefd, O_NONBLOCK );
-   if ( result == -1 )
-      throw EError( EError::Warning, "Error createing pipe (EEvent)" );
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
 
+EEvent::EEvent( bool state )
+{
    if ( state )
       set();
 }
 
 EEvent::~EEvent()
 {
-   closepipe();
 }
 
 void EEvent::set()
 {
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-result"
-   write( m_pipefd[1], &m_buf, 1 );
-#pragma GCC diagnostic pop
+   m_event.signal();
 }
 
 void EEvent::reset()
 {
-   while ( read(m_pipefd[0], &m_buf, sizeof(m_buf)) > 0 );
+   m_event.reset();
 }
 
 bool EEvent::wait( int ms )
 {
-   bool rval = false;
-   struct pollfd fds[] = { { .fd = m_pipefd[0], .events = POLLRDNORM } };
-
-   while (true)
-   {
-      int result = poll( fds, 1, ms );
-      if ( result > 0 ) // event set
-      {
-         rval = true;
-      }
-      else if ( result == 0 )
-      {
-         // timeout
-      }
-      else
-      {
-         if (errno == EINTR)
-            continue;
-      }
-      break;
-   }
-
-   return rval;
+   return m_event.wait( ms );
 }
 
-void EEvent::closepipe()
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+Bool EFutex::wait(Int &word, Int expected, Int ms)
 {
-   if ( m_pipefd[0] != -1 )
+   struct timespec ts;
+   struct timespec *pts = NULL;
+
+   if (ms >= 0)
    {
-      close( m_pipefd[0] );
-      m_pipefd[0] = -1;
+      ts.tv_sec = ms / 1000;
+      ts.tv_nsec = (ms % 1000) * 1000000;
+      pts = &ts;
    }
-   if ( m_pipefd[1] != -1 )
+
+   // the futex is not private since it may be in shared memory
+   while (syscall(SYS_futex, &word, FUTEX_WAIT, expected, pts, NULL, 0) == -1)
    {
-      close( m_pipefd[1] );
-      m_pipefd[1] = -1;
+      if (errno == EINTR)
+         continue;
+      return errno != ETIMEDOUT;
    }
+
+   return True;
+}
+
+Int EFutex::wake(Int &word, Int count)
+{
+   long result = syscall(SYS_futex, &word, FUTEX_WAKE, count, NULL, NULL, 0);
+   return result < 0 ? 0 : (Int)result;
 }
 
 ////////////////////////////////////////////////////////////////////////////////